@@ -1,5 +1,8 @@
 #ifndef __LIBPLUTO__
 #define __LIBPLUTO__
+#include <stdio.h>
+#include <stddef.h>
+
 #include "isl/union_set.h"
 #include "isl/union_map.h"
 
@@ -168,6 +171,43 @@ struct plutoOptions{
 
     /* fast linear independence check */
     int flic;
+
+    /* Number of threads for compile-time work that can be done in
+     * parallel (building per-dependence constraints, solving decoupled
+     * blocks of the scheduling ILP); 1 is serial */
+    int nthreads;
+
+    /* Remove redundant constraints with an LP after every Fourier-Motzkin
+     * step of the Farkas multiplier elimination (slow; off by default) */
+    int lpredun;
+
+    /* Reduce the scheduling ILP before solving it (substitute fixed and
+     * equality-defined variables, turn single-variable rows into bounds,
+     * drop implied rows) */
+    int presolve;
+
+    /* Race isl and PIP on each scheduling ILP and take the first answer */
+    int portfolio;
+
+    /* Write every lexmin and emptiness query to a file in this directory
+     * (to be replayed by ilp_bench); NULL: don't */
+    char *ilp_capture_dir;
+
+    /* Schedule consecutive statements of a loop body with identical
+     * domains (and in the same SCC) together */
+    int cluster;
+
+    /* Write a compile-time profile (phase times, solver calls) in JSON
+     * to this file; NULL: don't profile */
+    char *profile;
+
+    /* Directory caching transformations across runs, keyed by the SCoP,
+     * options, and input files; NULL: no caching */
+    char *cache_dir;
+
+    /* With cache_dir, also cache the generated code and reuse it verbatim
+     * on a hit (skipping dependence analysis as well) */
+    int cache_output;
 };
 typedef struct plutoOptions PlutoOptions;
 
@@ -186,12 +226,129 @@ PlutoOptions *pluto_options_alloc();
 void pluto_options_free(PlutoOptions *);
 
 
+/* The functions below may be called concurrently from different threads as
+ * long as each call has its own options and its own isl context (isl
+ * contexts can't be shared across threads) */
 __isl_give isl_union_map *pluto_schedule(isl_union_set *domains,
         isl_union_map *dependences,
         PlutoOptions *options);
 
 int pluto_schedule_osl(osl_scop_p scop, 
         PlutoOptions *options_l);
+
+/* A band of permutable loops (or, with width 1, a parallel loop) of a
+ * schedule returned by libpluto: schedule dimensions depth to
+ * depth+width-1 (0-indexed) of statements S_<stmts[0]>, ...,
+ * S_<stmts[nstmts-1]> */
+struct plutoBandInfo {
+    int depth;
+    int width;
+
+    int *stmts;
+    int nstmts;
+};
+typedef struct plutoBandInfo PlutoBandInfo;
+
+/* A loop of a schedule returned by libpluto: schedule dimension depth
+ * (0-indexed) of statements S_<stmts[0]>, ..., S_<stmts[nstmts-1]> */
+struct plutoLoopInfo {
+    int depth;
+
+    int *stmts;
+    int nstmts;
+
+    /* Index in PlutoScheduleInfo bands of the permutable band the loop
+     * is in; -1 if it's in none */
+    int band;
+
+    /* Carries no dependence */
+    int is_parallel;
+
+    /* Carries dependences, but is in a permutable band along with other
+     * loops: parallel in a wavefront (pipelined) */
+    int is_pipelined;
+
+    /* Parallel and innermost */
+    int is_vectorizable;
+
+    /* Tile size for a loop over tiles (for L2 tiles, in L1 tiles); 0 for
+     * any other loop; -1 if it differs across the statements */
+    int tile_size;
+};
+typedef struct plutoLoopInfo PlutoLoopInfo;
+
+/* Band and loop information of a schedule */
+struct plutoScheduleInfo {
+    /* Outermost permutable bands */
+    PlutoBandInfo *bands;
+    int nbands;
+
+    /* Outermost parallel loops (only with options->parallel) */
+    PlutoBandInfo *ploops;
+    int nploops;
+
+    /* All loops of the schedule */
+    PlutoLoopInfo *loops;
+    int nloops;
+};
+typedef struct plutoScheduleInfo PlutoScheduleInfo;
+
+/* Same as pluto_schedule, and also returns the band and loop information
+ * of the schedule in *info (NULL on failure); to be freed with
+ * pluto_schedule_info_free */
+__isl_give isl_union_map *pluto_schedule_with_info(isl_union_set *domains,
+        isl_union_map *dependences, PlutoScheduleInfo **info,
+        PlutoOptions *options);
+void pluto_schedule_info_print(FILE *fp, const PlutoScheduleInfo *info);
+void pluto_schedule_info_free(PlutoScheduleInfo *info);
+
+/* In-memory cache of schedules, keyed by the domains, dependences and
+ * options passed to pluto_schedule_cached; entries are evicted least
+ * recently used first to keep the cache within a size in bytes. A cache
+ * may be shared by threads calling pluto_schedule_cached concurrently */
+typedef struct plutoScheduleCache PlutoScheduleCache;
+
+PlutoScheduleCache *pluto_schedule_cache_alloc(size_t max_bytes);
+void pluto_schedule_cache_free(PlutoScheduleCache *cache);
+void pluto_schedule_cache_get_stats(PlutoScheduleCache *cache,
+        long *num_lookups, long *num_hits, size_t *size);
+
+__isl_give isl_union_map *pluto_schedule_cached(PlutoScheduleCache *cache,
+        isl_union_set *domains, isl_union_map *dependences,
+        PlutoScheduleInfo **info, PlutoOptions *options);
+
+/*
+ * Flat interchange format of pluto_schedule_flat: a single array of int64s
+ * (host byte order) that can be built and read from C or through ctypes
+ * without going through isl. A system of constraints ("cst" below) is
+ *
+ *   nrows, ncols, then nrows rows of 1+ncols values each: 1 if the row is
+ *   an equality (= 0), 0 if an inequality (>= 0), followed by the
+ *   coefficients, in the order variables, parameters, constant
+ *
+ * Input:
+ *   PLUTO_FLAT_VERSION, length of the buffer (in int64s), nstmts, npar, ndeps
+ *   for each statement S_0, S_1, ...:
+ *       dim, npieces, then npieces csts over [iterators, params, 1]
+ *       (the domain is their union)
+ *   for each dependence:
+ *       src, dest, then a cst over [src iterators, dest iterators, params, 1]
+ *
+ * Output:
+ *   PLUTO_FLAT_VERSION, length, nstmts, npar
+ *   for each statement:
+ *       nout, nexist, then the schedule: a cst over [nout schedule
+ *       dimensions, nexist existentially quantified (tile space)
+ *       variables, iterators, params, 1]
+ *       nrows, ncols, nrows divisors, then the nrows x ncols remapping
+ *       matrix (row-major) as returned by pluto_schedule_str
+ *   nploops, then for each parallel loop (only with options->parallel):
+ *       depth (0-indexed), nstmts, the statement ids
+ */
+#define PLUTO_FLAT_VERSION 1
+
+int64 *pluto_schedule_flat(const int64 *input, PlutoOptions *options);
+void pluto_flat_free(int64 *buf);
 #if defined(__cplusplus)
 }
 #endif
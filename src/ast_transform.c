@@ -79,7 +79,7 @@ void pluto_mark_parallel(struct clast_stmt *root, const PlutoProg *prog,
                 loops[j]->parallel = CLAST_PARALLEL_NOT;
                 char *private_vars = malloc(128);
                 strcpy(private_vars, "lbv,ubv");
-                if (options->parallel) {
+                if (pluto_options->parallel) {
                     IF_DEBUG(printf("Marking %s parallel\n", loops[j]->iterator););
                     loops[j]->parallel = CLAST_PARALLEL_OMP;
                     int depth = ploops[i]->depth+1;
@@ -0,0 +1,556 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ *
+ * Copyright (C) 2007-2012 Uday Bondhugula
+ *
+ * This file is part of Pluto.
+ *
+ * Pluto is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the file
+ * `LICENSE' in the top-level directory of this distribution.
+ *
+ * cache.c
+ *
+ * On-disk cache of transformations (<dir>/<key name>.sched) and generated
+ * code (<dir>/<key name>.pluto.c) for --cache-dir
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "osl/scop.h"
+#include "osl/generic.h"
+#include "osl/interface.h"
+#include "osl/extensions/coordinates.h"
+
+#include "pluto.h"
+#include "math_support.h"
+#include "program.h"
+#include "version.h"
+#include "cache.h"
+
+/* Bump when the format of a cache entry or what goes into the key changes */
+#define PLUTO_CACHE_VERSION 2
+
+/* Files in the working directory that Pluto reads when present */
+static const char *key_input_files[] = {"tile.sizes", ".fst", ".precut",
+    "skipdeps.txt", "codegen.context"};
+
+
+/* 64-bit FNV-1a hash of buf */
+static unsigned long long hash_buf(const char *buf, long len)
+{
+    long i;
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (i=0; i<len; i++) {
+        hash ^= (unsigned char) buf[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+static void key_print_file(FILE *keyfp, const char *name)
+{
+    int c;
+    FILE *fp = fopen(name, "r");
+
+    if (!fp) {
+        fprintf(keyfp, "%s: none\n", name);
+        return;
+    }
+
+    fprintf(keyfp, "%s:\n", name);
+    while ((c = fgetc(fp)) != EOF) {
+        fputc(c, keyfp);
+    }
+    fprintf(keyfp, "\n");
+    fclose(fp);
+}
+
+
+#define KEY_OPTION(name) fprintf(keyfp, #name " %d\n", options->name)
+
+/*
+ * Key for the result of optimizing scop with 'options' (whose cache_dir is
+ * where the entries go): the SCoP as
+ * printed by openscop minus its <coordinates> (source file name and line
+ * numbers don't affect the result), every option that can change the
+ * transformation or the generated code, and the input files Pluto reads
+ * from the working directory. Debugging/reporting options and solver
+ * options that only change how the same answers are found (presolve,
+ * portfolio) are left out. The entries are named by a hash of this text,
+ * and the text itself is stored in them and compared on lookup.
+ *
+ * Returns 0 on success, 1 if the key couldn't be built; key->text is to be
+ * freed with pluto_cache_key_clear
+ */
+int pluto_cache_key(osl_scop_p scop, const PlutoOptions *options,
+        PlutoCacheKey *key)
+{
+    int i;
+    osl_generic_p *ext, coordinates;
+    FILE *keyfp;
+
+    key->text = NULL;
+    key->len = 0;
+    key->dir = NULL;
+
+    if (options->cache_dir == NULL) return 1;
+
+    keyfp = tmpfile();
+    if (!keyfp) return 1;
+
+    fprintf(keyfp, "pluto %s cache %d\n", PLUTO_VERSION, PLUTO_CACHE_VERSION);
+
+    /* Print the SCoP with the coordinates extension unlinked */
+    coordinates = NULL;
+    for (ext=&scop->extension; *ext != NULL; ext=&(*ext)->next) {
+        if (!strcmp((*ext)->interface->URI, OSL_URI_COORDINATES)) {
+            coordinates = *ext;
+            *ext = coordinates->next;
+            break;
+        }
+    }
+    osl_scop_print(keyfp, scop);
+    if (coordinates) {
+        coordinates->next = *ext;
+        *ext = coordinates;
+    }
+
+    KEY_OPTION(tile);
+    KEY_OPTION(intratileopt);
+    KEY_OPTION(lbtile);
+    KEY_OPTION(partlbtile);
+    KEY_OPTION(parallel);
+    KEY_OPTION(innerpar);
+    KEY_OPTION(unroll);
+    KEY_OPTION(ufactor);
+    KEY_OPTION(prevector);
+    KEY_OPTION(rar);
+    KEY_OPTION(fuse);
+    KEY_OPTION(scancount);
+    KEY_OPTION(codegen_context);
+    KEY_OPTION(forceparallel);
+    KEY_OPTION(multipar);
+    KEY_OPTION(l2tile);
+    KEY_OPTION(ft);
+    KEY_OPTION(lt);
+    KEY_OPTION(polyunroll);
+    KEY_OPTION(identity);
+    KEY_OPTION(bee);
+    KEY_OPTION(cloogf);
+    KEY_OPTION(cloogl);
+    KEY_OPTION(cloogsh);
+    KEY_OPTION(cloogbacktrack);
+    KEY_OPTION(isldep);
+    KEY_OPTION(candldep);
+    KEY_OPTION(isldepaccesswise);
+    KEY_OPTION(isldepcoalesce);
+    KEY_OPTION(lastwriter);
+    KEY_OPTION(nodepbound);
+    KEY_OPTION(coeff_bound);
+    KEY_OPTION(scalpriv);
+    KEY_OPTION(readscop);
+    KEY_OPTION(pipsolve);
+    KEY_OPTION(islsolve);
+    KEY_OPTION(glpk);
+    KEY_OPTION(iss);
+    KEY_OPTION(flic);
+    KEY_OPTION(lpredun);
+    KEY_OPTION(cluster);
+
+    for (i=0; i<sizeof(key_input_files)/sizeof(key_input_files[0]); i++) {
+        key_print_file(keyfp, key_input_files[i]);
+    }
+
+    key->len = ftell(keyfp);
+    if (key->len <= 0) {
+        fclose(keyfp);
+        return 1;
+    }
+    key->text = (char *) malloc(key->len);
+    rewind(keyfp);
+    if (fread(key->text, 1, key->len, keyfp) != (size_t) key->len) {
+        fclose(keyfp);
+        pluto_cache_key_clear(key);
+        return 1;
+    }
+    fclose(keyfp);
+
+    sprintf(key->name, "%016llx", hash_buf(key->text, key->len));
+    key->dir = strdup(options->cache_dir);
+
+    return 0;
+}
+
+
+void pluto_cache_key_clear(PlutoCacheKey *key)
+{
+    free(key->text);
+    free(key->dir);
+    key->text = NULL;
+    key->len = 0;
+    key->dir = NULL;
+}
+
+
+/* Header of a cache entry: its kind and format version, and the key text
+ * it was stored under */
+static void cache_write_header(FILE *fp, const char *kind,
+        const PlutoCacheKey *key)
+{
+    fprintf(fp, "%s %d\n%ld\n", kind, PLUTO_CACHE_VERSION, key->len);
+    fwrite(key->text, 1, key->len, fp);
+    fprintf(fp, "\n");
+}
+
+
+/* Does the entry fp is opened on start with the header for this kind and
+ * key? On a match, fp is left at the entry's contents */
+static int cache_check_header(FILE *fp, const char *kind,
+        const PlutoCacheKey *key)
+{
+    int version, match;
+    long len;
+    char magic[32];
+    char *text;
+
+    if (fscanf(fp, "%31s %d %ld", magic, &version, &len) != 3
+            || strcmp(magic, kind) || version != PLUTO_CACHE_VERSION
+            || len != key->len || fgetc(fp) != '\n') {
+        return 0;
+    }
+
+    text = (char *) malloc(len);
+    match = fread(text, 1, len, fp) == (size_t) len
+        && !memcmp(text, key->text, len) && fgetc(fp) == '\n';
+    free(text);
+
+    return match;
+}
+
+
+/* Path of the cache entry for key with this suffix */
+static char *cache_entry_path(const PlutoCacheKey *key, const char *suffix)
+{
+    char *path = (char *) malloc(strlen(key->dir)
+            + strlen(key->name) + strlen(suffix) + 2);
+    sprintf(path, "%s/%s%s", key->dir, key->name, suffix);
+    return path;
+}
+
+
+/* Open a temporary file in the cache directory of key that becomes the
+ * entry at path once committed with cache_entry_commit; readers never see
+ * partial entries */
+static FILE *cache_entry_create(const PlutoCacheKey *key, const char *path,
+        char **tmp_path)
+{
+    FILE *fp;
+
+    if (mkdir(key->dir, 0755) == -1 && errno != EEXIST) {
+        fprintf(stderr, "[pluto] WARNING: can't create cache directory '%s'\n",
+                key->dir);
+        return NULL;
+    }
+
+    *tmp_path = (char *) malloc(strlen(path) + 32);
+    sprintf(*tmp_path, "%s.tmp%ld", path, (long) getpid());
+
+    fp = fopen(*tmp_path, "w");
+    if (!fp) {
+        fprintf(stderr, "[pluto] WARNING: can't write to cache directory '%s'\n",
+                key->dir);
+        free(*tmp_path);
+    }
+
+    return fp;
+}
+
+
+/* Returns 0 on success */
+static int cache_entry_commit(FILE *fp, const char *path, char *tmp_path)
+{
+    int ret = 0;
+
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        ret = 1;
+    }
+    free(tmp_path);
+
+    return ret;
+}
+
+
+/*
+ * Entry format: the header, and then what pluto_auto_transform leaves in
+ * prog, i.e., the number of statements and hyperplanes, the hyperplane
+ * properties, and, for each statement, its transformation, hyperplane
+ * types, and the hyperplane evicted for concurrent start (diamond tiling)
+ * if any
+ *
+ * Returns 0 on success, 1 if the entry couldn't be written
+ */
+int pluto_cache_store_schedule(const PlutoProg *prog, const PlutoCacheKey *key)
+{
+    int i, j, ret;
+    char *path, *tmp_path;
+    FILE *fp;
+
+    path = cache_entry_path(key, ".sched");
+    fp = cache_entry_create(key, path, &tmp_path);
+    if (!fp) {
+        free(path);
+        return 1;
+    }
+
+    cache_write_header(fp, "pluto-schedule", key);
+    fprintf(fp, "%d %d\n", prog->nstmts, prog->num_hyperplanes);
+
+    for (i=0; i<prog->num_hyperplanes; i++) {
+        fprintf(fp, "%d %d %d %d %d\n", prog->hProps[i].dep_prop,
+                prog->hProps[i].type, prog->hProps[i].band_num,
+                prog->hProps[i].unroll, prog->hProps[i].prevec);
+    }
+
+    for (i=0; i<prog->nstmts; i++) {
+        Stmt *stmt = prog->stmts[i];
+        pluto_matrix_print(fp, stmt->trans);
+        for (j=0; j<stmt->trans->nrows; j++) {
+            fprintf(fp, "%d ", stmt->hyp_types[j]);
+        }
+        fprintf(fp, "\n%d %d\n", stmt->evicted_hyp != NULL,
+                stmt->evicted_hyp_pos);
+        if (stmt->evicted_hyp) {
+            pluto_matrix_print(fp, stmt->evicted_hyp);
+        }
+    }
+
+    ret = cache_entry_commit(fp, path, tmp_path);
+
+    if (ret == 0) {
+        IF_DEBUG(printf("[pluto] Transformation stored in cache: %s\n", path););
+    }
+
+    free(path);
+
+    return ret;
+}
+
+
+/* Read a matrix with the given number of columns; NULL if the entry doesn't
+ * have one */
+static PlutoMatrix *cache_read_matrix(FILE *fp, int ncols)
+{
+    int i, j, nrows, nc;
+    PlutoMatrix *mat;
+
+    if (fscanf(fp, "%d %d", &nrows, &nc) != 2 || nrows < 0 || nc != ncols) {
+        return NULL;
+    }
+
+    mat = pluto_matrix_alloc(nrows, ncols);
+    for (i=0; i<nrows; i++) {
+        for (j=0; j<ncols; j++) {
+            if (fscanf(fp, "%lld", &mat->val[i][j]) != 1) {
+                pluto_matrix_free(mat);
+                return NULL;
+            }
+        }
+    }
+
+    return mat;
+}
+
+
+/*
+ * Restore the transformation cached for key into prog (in place of
+ * pluto_auto_transform). Returns 1 on a hit, 0 if there is no usable
+ * entry, in which case prog is left untouched
+ */
+int pluto_cache_restore_schedule(PlutoProg *prog, const PlutoCacheKey *key)
+{
+    int i, j, nstmts, num_hyperplanes, ok;
+    char *path;
+    FILE *fp;
+
+    path = cache_entry_path(key, ".sched");
+    fp = fopen(path, "r");
+    free(path);
+    if (!fp) return 0;
+
+    if (!cache_check_header(fp, "pluto-schedule", key)
+            || fscanf(fp, "%d %d", &nstmts, &num_hyperplanes) != 2
+            || nstmts != prog->nstmts || num_hyperplanes < 0) {
+        fclose(fp);
+        return 0;
+    }
+
+    HyperplaneProperties *hProps = (HyperplaneProperties *)
+        malloc(PLMAX(1, num_hyperplanes)*sizeof(HyperplaneProperties));
+    PlutoMatrix *trans[PLMAX(1, nstmts)], *evicted_hyp[PLMAX(1, nstmts)];
+    PlutoHypType *hyp_types[PLMAX(1, nstmts)];
+    int evicted_hyp_pos[PLMAX(1, nstmts)];
+
+    ok = 1;
+    for (i=0; i<num_hyperplanes && ok; i++) {
+        int dep_prop, type, unroll;
+        ok = fscanf(fp, "%d %d %d %d %d", &dep_prop, &type,
+                &hProps[i].band_num, &unroll, &hProps[i].prevec) == 5;
+        hProps[i].dep_prop = dep_prop;
+        hProps[i].type = type;
+        hProps[i].unroll = unroll;
+    }
+
+    for (i=0; i<nstmts; i++) {
+        trans[i] = NULL;
+        hyp_types[i] = NULL;
+        evicted_hyp[i] = NULL;
+    }
+
+    for (i=0; i<nstmts && ok; i++) {
+        Stmt *stmt = prog->stmts[i];
+        int has_evicted;
+        int ncols = stmt->dim + prog->npar + 1;
+
+        trans[i] = cache_read_matrix(fp, ncols);
+        if (!trans[i] || trans[i]->nrows != num_hyperplanes) {
+            ok = 0;
+            break;
+        }
+        hyp_types[i] = (PlutoHypType *) malloc(PLMAX(1, trans[i]->nrows)
+                *sizeof(PlutoHypType));
+        for (j=0; j<trans[i]->nrows && ok; j++) {
+            int type;
+            ok = fscanf(fp, "%d", &type) == 1;
+            hyp_types[i][j] = type;
+        }
+        if (!ok || fscanf(fp, "%d %d", &has_evicted, &evicted_hyp_pos[i]) != 2) {
+            ok = 0;
+            break;
+        }
+        if (has_evicted) {
+            evicted_hyp[i] = cache_read_matrix(fp, ncols);
+            ok = (evicted_hyp[i] != NULL);
+        }
+    }
+    fclose(fp);
+
+    if (!ok) {
+        IF_DEBUG(printf("[pluto] Ignoring invalid cache entry for %s\n", key->name););
+        for (i=0; i<nstmts; i++) {
+            if (trans[i]) pluto_matrix_free(trans[i]);
+            if (evicted_hyp[i]) pluto_matrix_free(evicted_hyp[i]);
+            free(hyp_types[i]);
+        }
+        free(hProps);
+        return 0;
+    }
+
+    for (i=0; i<nstmts; i++) {
+        Stmt *stmt = prog->stmts[i];
+        pluto_matrix_free(stmt->trans);
+        free(stmt->hyp_types);
+        if (stmt->evicted_hyp) pluto_matrix_free(stmt->evicted_hyp);
+        stmt->trans = trans[i];
+        stmt->hyp_types = hyp_types[i];
+        stmt->evicted_hyp = evicted_hyp[i];
+        stmt->evicted_hyp_pos = evicted_hyp_pos[i];
+    }
+    free(prog->hProps);
+    prog->hProps = hProps;
+    prog->num_hyperplanes = num_hyperplanes;
+
+    return 1;
+}
+
+
+static int copy_file(FILE *from, FILE *to)
+{
+    char buf[BUFSIZ];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), from)) > 0) {
+        if (fwrite(buf, 1, n, to) != n) return 0;
+    }
+
+    return !ferror(from);
+}
+
+
+/* Write the code cached for key to out_file; returns 1 on a hit */
+int pluto_cache_restore_output(const PlutoCacheKey *key, const char *out_file)
+{
+    int ok;
+    char *path;
+    FILE *from, *to;
+
+    path = cache_entry_path(key, ".pluto.c");
+    from = fopen(path, "r");
+    free(path);
+    if (!from) return 0;
+
+    if (!cache_check_header(from, "pluto-output", key)) {
+        fclose(from);
+        return 0;
+    }
+
+    to = fopen(out_file, "w");
+    if (!to) {
+        fclose(from);
+        return 0;
+    }
+
+    ok = copy_file(from, to);
+    fclose(from);
+    fclose(to);
+
+    return ok;
+}
+
+
+/* Returns 0 on success, 1 if the entry couldn't be written */
+int pluto_cache_store_output(const PlutoCacheKey *key, const char *out_file)
+{
+    int ret;
+    char *path, *tmp_path;
+    FILE *from, *to;
+
+    from = fopen(out_file, "r");
+    if (!from) return 1;
+
+    ret = 1;
+    path = cache_entry_path(key, ".pluto.c");
+    to = cache_entry_create(key, path, &tmp_path);
+    if (to) {
+        cache_write_header(to, "pluto-output", key);
+        if (copy_file(from, to)) {
+            ret = cache_entry_commit(to, path, tmp_path);
+        }else{
+            fclose(to);
+            remove(tmp_path);
+            free(tmp_path);
+        }
+    }
+    fclose(from);
+    free(path);
+
+    return ret;
+}
@@ -0,0 +1,56 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ *
+ * Copyright (C) 2007 Uday Bondhugula
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the
+ * top-level directory of this program (`COPYING')
+ *
+ */
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include "osl/scop.h"
+
+#include "pluto.h"
+
+/*
+ * On-disk cache (--cache-dir) of transformations and of generated code,
+ * keyed by the input SCoP, the options that affect the result, and the
+ * tile.sizes/.fst/.precut/skipdeps.txt/codegen.context files in the working
+ * directory
+ */
+typedef struct pluto_cache_key {
+    /* Everything the result depends on; stored in the entries, and
+     * compared on lookup */
+    char *text;
+    long len;
+
+    /* Name of the entries: 16 hex digits of a hash of text */
+    char name[17];
+
+    /* Cache directory the entries are in (options->cache_dir) */
+    char *dir;
+} PlutoCacheKey;
+
+int pluto_cache_key(osl_scop_p scop, const PlutoOptions *options,
+        PlutoCacheKey *key);
+void pluto_cache_key_clear(PlutoCacheKey *key);
+
+int pluto_cache_restore_schedule(PlutoProg *prog, const PlutoCacheKey *key);
+int pluto_cache_store_schedule(const PlutoProg *prog, const PlutoCacheKey *key);
+
+int pluto_cache_restore_output(const PlutoCacheKey *key, const char *out_file);
+int pluto_cache_store_output(const PlutoCacheKey *key, const char *out_file);
+
+#endif
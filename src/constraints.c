@@ -26,11 +26,16 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "math_support.h"
 #include "constraints.h"
 #include "pluto.h"
+#include "profile.h"
 
 #include "piplib/piplib64.h"
 
@@ -223,9 +228,12 @@ void pluto_constraints_resize_single(PlutoConstraints *cst, int nrows, int ncols
  * with all \lambda_i >= 0
  *
  * Eliminate Farkas multipliers by FM and return constraints in c_1, c_2, ...
+ * 'ss' (can be NULL) is the solver session of the caller (see
+ * fourier_motzkin_eliminate_last)
  *
  * */
-PlutoConstraints *farkas_lemma_affine(const PlutoConstraints *dom, const PlutoMatrix *phi)
+PlutoConstraints *farkas_lemma_affine(const PlutoConstraints *dom,
+        const PlutoMatrix *phi, PlutoSolverSession *ss)
 {
     int i, j;
 
@@ -286,14 +294,11 @@ PlutoConstraints *farkas_lemma_affine(const PlutoConstraints *dom, const PlutoMa
         farkas->val[idom->ncols+j][farkas_offset + j] = 1;
     }
 
-    for (i=0; i<idom->nrows; i++) {
-        int best_elim = pluto_constraints_best_elim_candidate(farkas, idom->nrows-i);
-        IF_MORE_DEBUG(printf("[farkas_lemma_affine] eliminating multiplier %d (c_%c) from %d constraints\n", i, 'i'+best_elim, farkas->nrows));
-        fourier_motzkin_eliminate_smart(farkas, best_elim);
-        // printf("After eliminating c_%c\n", 'i'+best_elim);
-        // printf("%d rows\n", farkas->nrows);
-        // pluto_constraints_compact_print(stdout, farkas);
-    }
+    IF_MORE_DEBUG(printf("[farkas_lemma_affine] eliminating %d multipliers from %d constraints\n",
+                idom->nrows, farkas->nrows));
+    fourier_motzkin_eliminate_last(farkas, idom->nrows, ss);
+    // printf("%d rows\n", farkas->nrows);
+    // pluto_constraints_compact_print(stdout, farkas);
     assert(farkas->ncols == phi->ncols);
     
     // printf("After farkas multiplier elimination\n");
@@ -401,106 +406,345 @@ static int row_compar(const void *e1, const void *e2)
 }
 
 
-/* 
- * Eliminates duplicate constraints; the simplified constraints
- * are still at the same memory location but the number of constraints 
- * will decrease
- */
-void pluto_constraints_simplify(PlutoConstraints *const cst)
+/* Divide a row by the gcd of its elements */
+static void row_normalize_gcd(int64 *row, int ncols)
 {
-    int i, j, p;
+    int j;
     int64 _gcd;
 
+    for (j=0; j<ncols; j++)  {
+        if (row[j] != 0)    break;
+    }
+
+    if (j<ncols) {
+        _gcd = PLABS(row[j]);
+        for (; j<ncols; j++) {
+            _gcd = gcd(PLABS(row[j]), _gcd);
+        }
+
+        /* Normalize by gcd */
+        for (j=0; j< ncols; j++)   {
+            row[j] /= _gcd;
+        }
+    }
+}
+
+
+/* Number of original inequalities in a row's history */
+static int fm_hist_size(const unsigned long long *hist, int nw)
+{
+    int i, size;
+
+    size = 0;
+    for (i=0; i<nw; i++) {
+        size += __builtin_popcountll(hist[i]);
+    }
+    return size;
+}
+
+/* Hash of a gcd-normalized row: the coefficients and the kind of
+ * constraint; the constant is included only for equalities, so that
+ * inequalities that differ only in the constant collide */
+static unsigned long row_hash(const int64 *row, int ncols, int is_eq)
+{
+    int j;
+    unsigned long hash = 5381;
+
+    hash = hash*33 + is_eq;
+    for (j=0; j<ncols-1; j++) {
+        hash = hash*33 + (unsigned long) row[j];
+    }
+    if (is_eq) hash = hash*33 + (unsigned long) row[ncols-1];
+
+    return hash;
+}
+
+/*
+ * Eliminates all-zero rows, duplicates, and inequalities dominated by
+ * another one with the same coefficients and a smaller constant (a stronger
+ * constraint) after gcd normalization. Works in place, preserving the order
+ * of the rows kept; duplicates are found with an open addressing hash table
+ * on row positions.
+ *
+ * If 'hist' is non-NULL, it holds 'nw' words for each row (see
+ * fourier_motzkin_eliminate_last) that are moved along with the rows; of two
+ * identical rows, the one with the smaller history is kept
+ */
+static void pluto_constraints_simplify_single(PlutoConstraints *cst,
+        unsigned long long *hist, int nw)
+{
+    int i, j, p, h, size, ncols;
+    int *table;
+    int64 *row;
+
     if (cst->nrows == 0)    {
         return;
     }
 
-    PlutoConstraints *tmpcst = pluto_constraints_alloc(cst->nrows, cst->ncols);
-    tmpcst->nrows = 0;
+    ncols = cst->ncols;
 
-    int *is_redun = (int *) malloc(sizeof(int)*cst->nrows);
-    bzero(is_redun, cst->nrows*sizeof(int));
+    for (size=1; size < 2*cst->nrows; size *= 2)
+        ;
+    table = (int *) malloc(size*sizeof(int));
+    for (h=0; h<size; h++) {
+        table[h] = -1;
+    }
 
-    /* Normalize cst - will help find redundancy */
-    for (i=0; i<cst->nrows; i++)   {
-        for (j=0; j<cst->ncols; j++)  {
-            if (cst->val[i][j] != 0)    break;
+    p = 0;
+    for (i=0; i<cst->nrows; i++)    {
+        row = cst->val[i];
+
+        /* Normalize - will help find redundancy */
+        row_normalize_gcd(row, ncols);
+
+        for (j=0; j<ncols; j++)    {
+            if (row[j] != 0) break;
+        }
+        if (j==ncols)  {
+            /* All zeros */
+            continue;
         }
 
-        if (j<cst->ncols) {
-            _gcd = PLABS(cst->val[i][j]);
-            for (; j<cst->ncols; j++) {
-                _gcd = gcd(PLABS(cst->val[i][j]), _gcd);
+        /* Look for a kept row with the same coefficients */
+        h = row_hash(row, ncols, cst->is_eq[i]) & (size-1);
+        while (table[h] != -1) {
+            int64 *krow = cst->val[table[h]];
+            if (cst->is_eq[table[h]] == cst->is_eq[i]
+                    && !memcmp(krow, row, (ncols-1)*sizeof(int64))
+                    && (!cst->is_eq[i] || krow[ncols-1] == row[ncols-1])) {
+                break;
+            }
+            h = (h+1) & (size-1);
+        }
+
+        if (table[h] != -1) {
+            int k = table[h];
+            int64 *krow = cst->val[k];
+            /* Same as (or dominated by) row k unless its constant is smaller */
+            if (row[ncols-1] < krow[ncols-1] || (hist != NULL
+                        && row[ncols-1] == krow[ncols-1]
+                        && fm_hist_size(&hist[i*nw], nw) < fm_hist_size(&hist[k*nw], nw))) {
+                krow[ncols-1] = row[ncols-1];
+                if (hist != NULL) {
+                    memcpy(&hist[k*nw], &hist[i*nw], nw*sizeof(unsigned long long));
+                }
             }
+            continue;
+        }
 
-            /* Normalize by gcd */
-            for (j=0; j< cst->ncols; j++)   {
-                cst->val[i][j] /= _gcd;
+        if (p != i) {
+            memcpy(cst->val[p], row, ncols*sizeof(int64));
+            cst->is_eq[p] = cst->is_eq[i];
+            if (hist != NULL) {
+                memcpy(&hist[p*nw], &hist[i*nw], nw*sizeof(unsigned long long));
             }
         }
+        table[h] = p;
+        p++;
     }
+    cst->nrows = p;
 
-    struct row_info **rows;
-    rows = (struct row_info **) malloc(cst->nrows*sizeof(struct row_info *));
-    for (i=0; i<cst->nrows; i++) {
-        rows[i] = (struct row_info *) malloc(sizeof(struct row_info));
-        rows[i]->row = cst->val[i];
-        rows[i]->is_eq = cst->is_eq[i];
-        rows[i]->ncols = cst->ncols;
+    free(table);
+}
+
+
+/* 
+ * Eliminates duplicate constraints (and inequalities dominated by another
+ * one); the simplified constraints are still at the same memory location but
+ * the number of constraints will decrease
+ */
+void pluto_constraints_simplify(PlutoConstraints *const cst)
+{
+    pluto_constraints_simplify_single(cst, NULL, 0);
+
+    if (cst->next != NULL) pluto_constraints_simplify(cst->next);
+}
+
+
+#define FARKAS_CACHE_NBUCKETS 4096
+
+/* An entry of the Farkas cache: canonical domain, phi, and the result */
+struct farkas_cache_entry {
+    unsigned long hash;
+    PlutoConstraints *dom;
+    PlutoMatrix *phi;
+    PlutoConstraints *farkas;
+    struct farkas_cache_entry *next;
+};
+
+
+PlutoFarkasCache *pluto_farkas_cache_alloc()
+{
+    PlutoFarkasCache *cache = (PlutoFarkasCache *) malloc(sizeof(PlutoFarkasCache));
+
+    cache->nbuckets = FARKAS_CACHE_NBUCKETS;
+    cache->buckets = (struct farkas_cache_entry **) calloc(cache->nbuckets,
+            sizeof(struct farkas_cache_entry *));
+    cache->num_lookups = 0;
+    cache->num_hits = 0;
+
+    return cache;
+}
+
+
+void pluto_farkas_cache_free(PlutoFarkasCache *cache)
+{
+    int i;
+
+    if (cache == NULL) return;
+
+    for (i=0; i<cache->nbuckets; i++) {
+        struct farkas_cache_entry *e = cache->buckets[i];
+        while (e != NULL) {
+            struct farkas_cache_entry *next = e->next;
+            pluto_constraints_free(e->dom);
+            pluto_matrix_free(e->phi);
+            pluto_constraints_free(e->farkas);
+            free(e);
+            e = next;
+        }
     }
-    qsort(rows, cst->nrows, sizeof(struct row_info *), row_compar);
+    free(cache->buckets);
+    free(cache);
+}
 
-    for (i=0; i<cst->nrows; i++) {
-        cst->val[i] = rows[i]->row;
-        cst->is_eq[i] = rows[i]->is_eq;
-        free(rows[i]);
+
+/*
+ * Canonical form of a domain for the Farkas cache: rows sorted so that
+ * polyhedra that only differ in the order of their constraints (and in
+ * names) share an entry
+ */
+static PlutoConstraints *farkas_canonical_domain(const PlutoConstraints *dom)
+{
+    int i;
+    PlutoConstraints *cdom;
+    struct row_info *info, **rows;
+
+    info = (struct row_info *) malloc(PLMAX(1,dom->nrows)*sizeof(struct row_info));
+    rows = (struct row_info **) malloc(PLMAX(1,dom->nrows)*sizeof(struct row_info *));
+    for (i=0; i<dom->nrows; i++) {
+        info[i].row = dom->val[i];
+        info[i].is_eq = dom->is_eq[i];
+        info[i].ncols = dom->ncols;
+        rows[i] = &info[i];
+    }
+    qsort(rows, dom->nrows, sizeof(struct row_info *), row_compar);
+
+    cdom = pluto_constraints_alloc(dom->nrows, dom->ncols);
+    for (i=0; i<dom->nrows; i++) {
+        pluto_constraints_add_constraint(cdom, rows[i]->is_eq);
+        memcpy(cdom->val[i], rows[i]->row, dom->ncols*sizeof(int64));
     }
     free(rows);
+    free(info);
 
-    is_redun[0] = 0;
-    for (i=1; i<cst->nrows; i++)    {
-        for (j=0; j<cst->ncols; j++)    {
-            if (cst->val[i][j] != 0) break;
-        }
+    return cdom;
+}
 
-        if (j==cst->ncols)  {
-            /* All zeros */
-            is_redun[i] = 1;
-            continue;
-        }
 
-        for (j=0; j<cst->ncols; j++)    {
-            if (cst->val[i-1][j] != cst->val[i][j]) break;
+static unsigned long farkas_cache_hash(const PlutoConstraints *dom, 
+        const PlutoMatrix *phi)
+{
+    int i, j;
+    unsigned long hash = 5381;
+
+    hash = hash*33 + dom->nrows;
+    hash = hash*33 + dom->ncols;
+    for (i=0; i<dom->nrows; i++) {
+        hash = hash*33 + dom->is_eq[i];
+        for (j=0; j<dom->ncols; j++) {
+            hash = hash*33 + (unsigned long) dom->val[i][j];
         }
+    }
+    hash = hash*33 + phi->nrows;
+    hash = hash*33 + phi->ncols;
+    for (i=0; i<phi->nrows; i++) {
+        for (j=0; j<phi->ncols; j++) {
+            hash = hash*33 + (unsigned long) phi->val[i][j];
+        }
+    }
 
-        if (j==cst->ncols && cst->is_eq[i-1] == cst->is_eq[i]) {
-            /* Same as cst(i-1) */
-            is_redun[i] = 1;
-        }else is_redun[i] = 0;
+    return hash;
+}
+
+
+static int farkas_cache_entry_matches(const struct farkas_cache_entry *e,
+        unsigned long hash, const PlutoConstraints *dom, const PlutoMatrix *phi)
+{
+    int i;
+
+    if (e->hash != hash) return 0;
+    if (e->dom->nrows != dom->nrows || e->dom->ncols != dom->ncols) return 0;
+    if (e->phi->nrows != phi->nrows || e->phi->ncols != phi->ncols) return 0;
+
+    for (i=0; i<dom->nrows; i++) {
+        if (e->dom->is_eq[i] != dom->is_eq[i]) return 0;
+        if (memcmp(e->dom->val[i], dom->val[i], dom->ncols*sizeof(int64))) return 0;
     }
+    for (i=0; i<phi->nrows; i++) {
+        if (memcmp(e->phi->val[i], phi->val[i], phi->ncols*sizeof(int64))) return 0;
+    }
+    return 1;
+}
 
-    p = 0;
-    for (i=0; i<cst->nrows; i++)    {
-        if (!is_redun[i])  {
-            /*
-            for (j=0; j<cst->ncols; j++)    {
-                tmpcst->val[p][j] = cst->val[i][j];
+
+/*
+ * farkas_lemma_affine with a cache keyed on the (dom, phi) pair: dependence
+ * polyhedra of the same shape (for eg., between different pairs of
+ * statements accessing the same array) have their multipliers eliminated
+ * only once; the result is local to (dom, phi) and is remapped to the
+ * statements' coefficients by the caller. 'cache' can be NULL. Safe to call
+ * concurrently on the same cache (but not on the same session)
+ */
+PlutoConstraints *farkas_lemma_affine_cached(const PlutoConstraints *dom,
+        const PlutoMatrix *phi, PlutoFarkasCache *cache, PlutoSolverSession *ss)
+{
+    unsigned long hash;
+    PlutoConstraints *cdom, *farkas;
+    struct farkas_cache_entry *e;
+
+    if (cache == NULL) return farkas_lemma_affine(dom, phi, ss);
+
+    assert(dom->next == NULL);
+
+    cdom = farkas_canonical_domain(dom);
+    hash = farkas_cache_hash(cdom, phi);
+
+    farkas = NULL;
+#pragma omp critical (farkas_cache)
+    {
+        cache->num_lookups++;
+        for (e=cache->buckets[hash%cache->nbuckets]; e!=NULL; e=e->next) {
+            if (farkas_cache_entry_matches(e, hash, cdom, phi)) {
+                farkas = pluto_constraints_dup(e->farkas);
+                cache->num_hits++;
+                break;
             }
-            */
-            memcpy(tmpcst->val[p], cst->val[i], cst->ncols*sizeof(int64));
-            tmpcst->is_eq[p] = cst->is_eq[i];
-            p++;
         }
     }
-    tmpcst->nrows = p;
-    tmpcst->ncols = cst->ncols;
 
-    pluto_constraints_copy_single(cst, tmpcst);
-    pluto_constraints_free(tmpcst);
+    if (farkas != NULL) {
+        pluto_constraints_free(cdom);
+        return farkas;
+    }
 
-    free(is_redun);
+    farkas = farkas_lemma_affine(cdom, phi, ss);
 
-    if (cst->next != NULL) pluto_constraints_simplify(cst->next);
+    e = (struct farkas_cache_entry *) malloc(sizeof(struct farkas_cache_entry));
+    e->hash = hash;
+    e->dom = cdom;
+    e->phi = pluto_matrix_dup(phi);
+    e->farkas = pluto_constraints_dup(farkas);
+
+    /* Another thread may have added the same key meanwhile; a duplicate
+     * entry is harmless */
+#pragma omp critical (farkas_cache)
+    {
+        e->next = cache->buckets[hash%cache->nbuckets];
+        cache->buckets[hash%cache->nbuckets] = e;
+    }
+
+    return farkas;
 }
 
 
@@ -1074,6 +1318,10 @@ PlutoMatrix *pluto_constraints_to_pip_matrix(const PlutoConstraints *cst, PlutoM
 
 /* Use PIP to solve these constraints (solves for the first element
  * if it's a list of constraints) */
+/* PIP keeps global state while solving; solves from different threads are
+ * serialized */
+static pthread_mutex_t pip_solve_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int64 *pluto_constraints_lexmin_pip(const PlutoConstraints *cst, int negvar)
 {
     int bignum, i;
@@ -1097,6 +1345,8 @@ int64 *pluto_constraints_lexmin_pip(const PlutoConstraints *cst, int negvar)
     context = NULL;
     bignum = -1;
 
+    pthread_mutex_lock(&pip_solve_lock);
+
     domain = pip_matrix_populate(pipmat->val, pipmat->nrows, 
             pipmat->ncols);
 
@@ -1138,19 +1388,99 @@ int64 *pluto_constraints_lexmin_pip(const PlutoConstraints *cst, int negvar)
     pip_matrix_free(domain);
     pip_quast_free(solution);
 
+    pthread_mutex_unlock(&pip_solve_lock);
+
     pluto_matrix_free(pipmat);
 
     return sol;
 }
 
-/* Solve these constraints for lexmin solution */
-int64 *pluto_constraints_lexmin(const PlutoConstraints *cst, int negvar)
+/* Sequence number of the next query captured */
+static long num_captured = 0;
+
+/*
+ * With --capture-ilp=<dir>, write a solver query to its own file in
+ * <dir>, named by sequence number and kind ("lexmin" or "empty"), so that
+ * it can be replayed later (ilp_bench): a line with the kind and negvar,
+ * followed by the first element of cst in the format read by
+ * pluto_constraints_read. <dir> is created if it doesn't exist.
+ *
+ * Sequence numbers are process-wide, and a file is never overwritten: the
+ * numbers of files already in <dir> (captured by an earlier program or
+ * process) are skipped
+ */
+void pluto_constraints_capture(const PlutoConstraints *cst, const char *kind,
+        int negvar)
+{
+    int i, j, fd;
+    FILE *fp;
+
+    if (pluto_options->ilp_capture_dir == NULL) return;
+
+    char path[strlen(pluto_options->ilp_capture_dir)+32];
+
+#pragma omp critical (capture)
+    {
+        do {
+            sprintf(path, "%s/%06ld.%s", pluto_options->ilp_capture_dir,
+                    num_captured++, kind);
+            fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (fd < 0 && errno == ENOENT) {
+                if (mkdir(pluto_options->ilp_capture_dir, 0755) != 0
+                        && errno != EEXIST) {
+                    fprintf(stderr, "[pluto] WARNING: can't create %s\n",
+                            pluto_options->ilp_capture_dir);
+                    errno = ENOENT;
+                }else{
+                    fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+                }
+            }
+        }while (fd < 0 && errno == EEXIST);
+    }
+
+    fp = (fd >= 0)? fdopen(fd, "w"): NULL;
+    if (!fp) {
+        fprintf(stderr, "[pluto] WARNING: can't write %s\n", path);
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    fprintf(fp, "%s %d\n", kind, negvar);
+    fprintf(fp, "%d %d\n", cst->nrows, cst->ncols+1);
+    for (i=0; i<cst->nrows; i++)    {
+        fprintf(fp, "%s ", cst->is_eq[i]? "0": "1");
+        for (j=0; j<cst->ncols; j++)    {
+            fprintf(fp, "%lld ", cst->val[i][j]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+}
+
+
+/* Solve these constraints for lexmin solution; 'ss' is the solver session
+ * of the program (can be NULL) */
+int64 *pluto_constraints_lexmin(const PlutoConstraints *cst, int negvar,
+        PlutoSolverSession *ss)
 {
-    if (options->islsolve) {
-        return pluto_constraints_lexmin_isl(cst, negvar);
+    int64 *sol;
+    double t_start;
+
+    if (ss) ss->num_lexmin_calls++;
+
+    pluto_constraints_capture(cst, "lexmin", negvar);
+
+    t_start = pluto_profile_clock();
+    if (pluto_options->islsolve) {
+        sol = pluto_constraints_lexmin_isl(cst, negvar, ss);
     }else{
-        return pluto_constraints_lexmin_pip(cst, negvar);
+        sol = pluto_constraints_lexmin_pip(cst, negvar);
     }
+    pluto_profile_add_solver_call(PROF_LEXMIN, cst->nrows, cst->ncols,
+            pluto_profile_clock() - t_start);
+
+    return sol;
 }
 
 #ifdef GLPK
@@ -1232,7 +1562,7 @@ void set_glpk_constraints_from_pluto_constraints(glp_prob *lp, const PlutoConstr
 int64 *pluto_constraints_solve_glpk(glp_prob *lp, const PlutoConstraints *cst)
 {
     int j;
-    if (!options->debug && !options->moredebug) {
+    if (!pluto_options->debug && !pluto_options->moredebug) {
         glp_term_out(GLP_OFF);
     }
 
@@ -1767,7 +2097,7 @@ void check_redundancy(PlutoConstraints *cst)
         pluto_constraints_remove_row(check, i); 
         pluto_constraints_negate_constraint(row, 0);
         pluto_constraints_add(check, row);
-        if (pluto_constraints_is_empty(check))  {
+        if (pluto_constraints_is_empty(check, NULL))  {
             // printf("%dth constraint is redundant\n", i);
             count++;
         }else{
@@ -1824,26 +2154,36 @@ PlutoConstraints *pluto_constraints_empty(int ncols)
 }
 
 
-int pluto_constraints_is_empty(const PlutoConstraints *cst)
+/* 'ss': solver session to run the query in; a temporary isl context is
+ * used if NULL */
+int pluto_constraints_is_empty(const PlutoConstraints *cst,
+        PlutoSolverSession *ss)
 {
     int64 *sol;
     bool is_empty;
 
-    if (options->islsolve) {
-        isl_ctx *ctx = isl_ctx_alloc();
+    if (ss) ss->num_is_empty_calls++;
+
+    pluto_constraints_capture(cst, "empty", ALLOW_NEGATIVE_COEFF);
+
+    double t_start = pluto_profile_clock();
+    if (pluto_options->islsolve) {
+        isl_ctx *ctx = ss? ss->ctx: isl_ctx_alloc();
         isl_set *iset = isl_set_from_pluto_constraints(cst, ctx);
         is_empty = isl_set_is_empty(iset);
         isl_set_free(iset);
-        isl_ctx_free(ctx);
+        if (!ss) isl_ctx_free(ctx);
     }else{
         sol = pluto_constraints_lexmin_pip(cst, ALLOW_NEGATIVE_COEFF);
         is_empty = (sol == NULL);
         free(sol);
     }
+    pluto_profile_add_solver_call(PROF_IS_EMPTY, cst->nrows, cst->ncols,
+            pluto_profile_clock() - t_start);
 
     if (!is_empty) return 0;
 
-    if (cst->next != NULL)  return pluto_constraints_is_empty(cst->next);
+    if (cst->next != NULL)  return pluto_constraints_is_empty(cst->next, ss);
 
     /* This one is empty and there are no more */
     return 1;
@@ -1940,7 +2280,7 @@ void print_polylib_visual_sets_internal(char* str, int k,  PlutoConstraints *cst
     int i, j, first = 0;
     char name[100];
 
-	if(!options->moredebug)
+	if(!pluto_options->moredebug)
 		return;
 
     if(cst == NULL)
@@ -2269,37 +2609,73 @@ void pluto_constraints_set_names_range(PlutoConstraints *cst, char **names,
  * Returns the best candidate to eliminate (exact index in cst)
  * max_elim: maximum number of variables to eliminate (from the right)
  *
- * FIXME: update it for constraints with equalities
+ * Candidates are ranked by the number of non-zero coefficients the system
+ * is expected to have after their elimination (fill-in), not just its
+ * number of rows: each of the lb*ub Fourier-Motzkin combinations can be as
+ * dense as the union of its two sources, and Gaussian elimination (for a
+ * variable in an equality) spreads the equality's support into every row
+ * the variable appears in
  */
 int pluto_constraints_best_elim_candidate(const PlutoConstraints *cst, int max_elim)
 {
     int64 **csm;
-    int64 i, j, ub, lb, nb, num_eq, cost;
+    int64 i, j, ub, lb, nb, num_occ, eq_row, cost, min_cost;
+    int64 nnz_total, nnz_ub, nnz_lb, nnz_nb;
+    int *nnz;
 
-    int min_cost = cst->nrows*cst->nrows/4;
     int best_candidate = cst->ncols-2;
 
     csm = cst->val;
 
+    nnz = (int *) malloc(PLMAX(1,cst->nrows)*sizeof(int));
+    nnz_total = 0;
+    for (i=0; i < cst->nrows; i++)    {
+        nnz[i] = 0;
+        for (j=0; j < cst->ncols-1; j++)    {
+            if (csm[i][j] != 0) nnz[i]++;
+        }
+        nnz_total += nnz[i];
+    }
+
+    min_cost = -1;
     for (j=cst->ncols-2; j > cst->ncols-2-max_elim; j--)    {
         ub=0;
         lb=0;
         nb=0;
-        num_eq = 0;
+        nnz_ub = 0;
+        nnz_lb = 0;
+        nnz_nb = 0;
+        num_occ = 0;
+        eq_row = -1;
         for (i=0; i < cst->nrows; i++)    {
-            if (cst->is_eq[i] && csm[i][j] != 0) num_eq++;
-            else if (csm[i][j] > 0) ub++;
-            else if (csm[i][j] < 0) lb++;
-            else nb++;
-        }
-        if (num_eq >= 1) cost = cst->nrows-1;
-        else cost = lb*ub + nb;
-        if (cost < min_cost)    {
+            if (csm[i][j] != 0) num_occ++;
+            if (cst->is_eq[i] && csm[i][j] != 0) {
+                /* pluto_constraints_gaussian_eliminate uses the first one */
+                if (eq_row == -1) eq_row = i;
+            }else if (csm[i][j] > 0) {
+                ub++;
+                nnz_ub += nnz[i];
+            }else if (csm[i][j] < 0) {
+                lb++;
+                nnz_lb += nnz[i];
+            }else{
+                nb++;
+                nnz_nb += nnz[i];
+            }
+        }
+        if (eq_row >= 0) {
+            cost = nnz_total - nnz[eq_row] + (num_occ-1)*(nnz[eq_row]-2);
+        }else{
+            cost = nnz_nb + lb*nnz_ub + ub*nnz_lb - 2*lb*ub;
+        }
+        if (min_cost == -1 || cost < min_cost)    {
             min_cost = cost;
             best_candidate = j;
         }
     }
 
+    free(nnz);
+
     return best_candidate;
 }
 
@@ -2542,3 +2918,238 @@ void pluto_constraints_gaussian_eliminate(PlutoConstraints *cst, int pos)
 
     if (cst->next != NULL) pluto_constraints_gaussian_eliminate(cst->next, pos);
 }
+
+
+/* Adds the statistics in 'other' to 'stats' */
+void pluto_fm_stats_add(PlutoFMStats *stats, const PlutoFMStats *other)
+{
+    stats->num_elims += other->num_elims;
+    stats->peak_rows = PLMAX(stats->peak_rows, other->peak_rows);
+    stats->num_imbert_dropped += other->num_imbert_dropped;
+    stats->num_lp_dropped += other->num_lp_dropped;
+    stats->time += other->time;
+}
+
+/* Keep only rows order[0..n-1] of cst (in that order) along with their
+ * histories */
+static void fm_select_rows(PlutoConstraints *cst, unsigned long long *hist,
+        int nw, const int *order, int n)
+{
+    int i;
+
+    PlutoConstraints *tmpcst = pluto_constraints_alloc(PLMAX(1,n), cst->ncols);
+    unsigned long long *tmphist = (unsigned long long *)
+        malloc(PLMAX(1,n)*nw*sizeof(unsigned long long));
+
+    for (i=0; i<n; i++) {
+        memcpy(tmpcst->val[i], cst->val[order[i]], cst->ncols*sizeof(int64));
+        tmpcst->is_eq[i] = cst->is_eq[order[i]];
+        memcpy(&tmphist[i*nw], &hist[order[i]*nw], nw*sizeof(unsigned long long));
+    }
+    tmpcst->nrows = n;
+
+    pluto_constraints_copy_single(cst, tmpcst);
+    memcpy(hist, tmphist, n*nw*sizeof(unsigned long long));
+
+    pluto_constraints_free(tmpcst);
+    free(tmphist);
+}
+
+/* Remove rows implied by the others (LP-based); returns the number removed */
+static int fm_remove_redundant_lp(PlutoConstraints *cst, unsigned long long *hist,
+        int nw, PlutoSolverSession *ss)
+{
+    int i, n, num_redun;
+    int *is_redun, *order;
+
+    if (cst->nrows == 0) return 0;
+
+    is_redun = (int *) calloc(cst->nrows, sizeof(int));
+    order = (int *) malloc(cst->nrows*sizeof(int));
+
+    num_redun = pluto_constraints_mark_redundant_lp(cst, is_redun, ss);
+
+    if (num_redun >= 1) {
+        n = 0;
+        for (i=0; i<cst->nrows; i++) {
+            if (!is_redun[i]) order[n++] = i;
+        }
+        fm_select_rows(cst, hist, nw, order, n);
+    }
+
+    free(order);
+    free(is_redun);
+
+    return num_redun;
+}
+
+/*
+ * Eliminates the last 'num' variables of cst (the ones right before the
+ * constant column), in the order suggested by
+ * pluto_constraints_best_elim_candidate; a variable that appears in an
+ * equality is eliminated via Gaussian elimination, others via
+ * Fourier-Motzkin. Only the first element of cst is handled.
+ *
+ * Every inequality carries its history: the set of inequalities of the
+ * input it is a non-negative combination of. By Imbert's first
+ * acceleration theorem (Chernikov's rule), after k variables have been
+ * eliminated by Fourier-Motzkin, an inequality whose history has more than
+ * k+1 elements is redundant; such combinations are not even materialized.
+ * Substituting an equality does not change any history. With
+ * options->lpredun, rows implied by the others are also removed (one LP per
+ * row) after every step.
+ *
+ * The LPs are solved in the context of 'ss', and the statistics of the
+ * elimination are added to ss->fm_stats; with a NULL 'ss', a temporary
+ * session is used for the LPs and no statistics are kept
+ */
+void fourier_motzkin_eliminate_last(PlutoConstraints *cst, int num,
+        PlutoSolverSession *ss)
+{
+    int i, j, k, l, r, p, q, pos, nw, num_ineq, num_fm, peak_rows;
+    int64 lb, ub, nb;
+    int *bound;
+    long num_imbert, num_lp;
+    double t_start;
+    unsigned long long *hist, *newhist;
+    PlutoConstraints *newcst;
+    PlutoSolverSession *tss = NULL;
+
+    assert(cst->next == NULL);
+    assert(num >= 0 && num <= cst->ncols-1);
+
+    t_start = pluto_options->time? pluto_profile_clock(): 0.0;
+
+    num_ineq = 0;
+    for (r=0; r<cst->nrows; r++) {
+        if (!cst->is_eq[r]) num_ineq++;
+    }
+    nw = PLMAX(1, (num_ineq+63)/64);
+
+    /* Each input inequality starts out as its own history; equalities have
+     * an empty one */
+    hist = (unsigned long long *) calloc(PLMAX(1,cst->nrows)*nw,
+            sizeof(unsigned long long));
+    for (r=0, j=0; r<cst->nrows; r++) {
+        if (!cst->is_eq[r]) {
+            hist[r*nw + j/64] |= 1ULL << (j%64);
+            j++;
+        }
+    }
+
+    num_fm = 0;
+    num_imbert = 0;
+    num_lp = 0;
+    peak_rows = cst->nrows;
+
+    for (i=0; i<num; i++) {
+        pos = pluto_constraints_best_elim_candidate(cst, num-i);
+
+        for (r=0; r<cst->nrows; r++) {
+            if (cst->is_eq[r] && cst->val[r][pos] != 0) break;
+        }
+
+        if (r < cst->nrows) {
+            /* Row r is the equality that will be used and removed */
+            pluto_constraints_gaussian_eliminate(cst, pos);
+            memmove(&hist[r*nw], &hist[(r+1)*nw],
+                    (cst->nrows-r)*nw*sizeof(unsigned long long));
+            pluto_constraints_simplify_single(cst, hist, nw);
+            continue;
+        }
+
+        num_fm++;
+
+        bound = (int *) malloc(PLMAX(1,cst->nrows)*sizeof(int));
+        lb=0;
+        ub=0;
+        nb=0;
+        for (r=0; r<cst->nrows; r++)    {
+            if (cst->val[r][pos] == 0) {
+                bound[r] = NB;
+                nb++;
+            }else if (cst->val[r][pos] >= 1) {
+                bound[r] = LB;
+                lb++;
+            }else{
+                bound[r] = UB;
+                ub++;
+            }
+        }
+
+        newcst = pluto_constraints_alloc(PLMAX(1,lb*ub+nb), cst->ncols-1);
+        newhist = (unsigned long long *) calloc(PLMAX(1,lb*ub+nb)*nw,
+                sizeof(unsigned long long));
+
+        p=0;
+        for (r=0; r<cst->nrows; r++)    {
+            if (bound[r] == UB) {
+                for (k=0; k<cst->nrows; k++)    {
+                    if (bound[k] != LB) continue;
+                    for (l=0; l<nw; l++) {
+                        newhist[p*nw+l] = hist[r*nw+l] | hist[k*nw+l];
+                    }
+                    if (fm_hist_size(&newhist[p*nw], nw) > num_fm+1) {
+                        num_imbert++;
+                        continue;
+                    }
+                    q = 0;
+                    for(l=0; l < cst->ncols; l++)  {
+                        if (l!=pos)   {
+                            newcst->val[p][q] =
+                                cst->val[r][l]*(lcm(cst->val[k][pos],
+                                            -cst->val[r][pos])/(-cst->val[r][pos]))
+                                + cst->val[k][l]*(lcm(-cst->val[r][pos],
+                                            cst->val[k][pos])/cst->val[k][pos]);
+                            q++;
+                        }
+                    }
+                    newcst->is_eq[p] = 0;
+                    p++;
+                }
+            }else if (bound[r] == NB)   {
+                q = 0;
+                for (l=0; l<cst->ncols; l++)    {
+                    if (l!=pos)   {
+                        newcst->val[p][q] = cst->val[r][l];
+                        q++;
+                    }
+                }
+                newcst->is_eq[p] = cst->is_eq[r];
+                memcpy(&newhist[p*nw], &hist[r*nw], nw*sizeof(unsigned long long));
+                p++;
+            }
+        }
+        assert(p <= lb*ub + nb);
+        newcst->nrows = p;
+        peak_rows = PLMAX(peak_rows, p);
+        free(bound);
+
+        pluto_constraints_copy_single(cst, newcst);
+        pluto_constraints_free(newcst);
+        free(hist);
+        hist = newhist;
+
+        pluto_constraints_simplify_single(cst, hist, nw);
+
+        if (pluto_options->lpredun) {
+            if (ss == NULL && tss == NULL) {
+                tss = pluto_solver_session_alloc();
+            }
+            num_lp += fm_remove_redundant_lp(cst, hist, nw, ss? ss: tss);
+        }
+    }
+
+    free(hist);
+    pluto_solver_session_free(tss);
+
+    if (ss != NULL) {
+        ss->fm_stats.num_elims += num;
+        ss->fm_stats.peak_rows = PLMAX(ss->fm_stats.peak_rows, peak_rows);
+        ss->fm_stats.num_imbert_dropped += num_imbert;
+        ss->fm_stats.num_lp_dropped += num_lp;
+        if (pluto_options->time) {
+            ss->fm_stats.time += pluto_profile_clock() - t_start;
+        }
+    }
+}
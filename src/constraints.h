@@ -59,6 +59,131 @@ struct pluto_constraints {
 
 typedef struct pluto_constraints PlutoConstraints;
 
+/*
+ * Same as PlutoConstraints (a single system; no list), but with rows
+ * stored in compressed form: only the non-zero coefficients of a row are
+ * kept. Meant for the wide systems of the Pluto ILP, where a row involves
+ * only the coefficients of one or two statements
+ */
+struct pluto_sparse_constraints {
+    /* Row i's non-zero coefficients are val[start[i]..start[i+1]-1] for
+     * columns col[start[i]..start[i+1]-1] (in increasing order); the
+     * constant is column ncols-1 like for PlutoConstraints */
+    int *start;
+    int *col;
+    int64 *val;
+
+    /* Is row i an equality? 1 yes, 0 no */
+    int *is_eq;
+
+    int nrows;
+    /* Number of columns (number of vars + 1) */
+    int ncols;
+
+    /* Number of rows and non-zeros allocated */
+    int alloc_nrows;
+    int alloc_nnz;
+
+    /* The first nbase rows stay the same across a sequence of solves
+     * (e.g., the constraints of a band, with only the rows added for each
+     * hyperplane changing); 0 if not known */
+    int nbase;
+};
+typedef struct pluto_sparse_constraints PlutoSparseConstraints;
+
+/* What pluto_sparse_constraints_presolve removed from a system, to rebuild
+ * a solution of it from one of the reduced system */
+struct pluto_presolve_info {
+    /* Number of columns of the original system */
+    int ncols;
+
+    /* Column of each variable in the reduced system (-1 if removed) */
+    int *colmap;
+
+    /* Values of the fixed variables */
+    int64 *fixval;
+
+    /* Variables substituted away, in order; row i of elim_eqs is the
+     * equality used for elim_col[i] (a unit coefficient for it and none
+     * for later variables) */
+    int *elim_col;
+    PlutoSparseConstraints *elim_eqs;
+    int nelim;
+};
+typedef struct pluto_presolve_info PlutoPresolveInfo;
+
+/* Fourier-Motzkin elimination statistics, accumulated over the calls to
+ * fourier_motzkin_eliminate_last made with a solver session (reported with
+ * --time) */
+struct pluto_fm_stats {
+    /* Number of variables eliminated */
+    long num_elims;
+
+    /* Largest number of rows materialized by a single elimination */
+    int peak_rows;
+
+    /* Rows dropped by Imbert's acceleration theorem and by the LP
+     * redundancy check (options->lpredun) */
+    long num_imbert_dropped;
+    long num_lp_dropped;
+
+    /* Time spent eliminating (only measured with options->time) */
+    double time;
+};
+typedef struct pluto_fm_stats PlutoFMStats;
+
+/* Number of base systems kept by a solver session */
+#define PLUTO_SOLVER_NUM_BASES 8
+
+/* 
+ * Solver state that lives as long as the program being optimized: a
+ * single isl context (and scratch sets built in it) reused across all
+ * emptiness and lexmin queries, along with a count of the queries made.
+ * Query functions accept NULL in its place, in which case a temporary
+ * context is used (the old behavior)
+ */
+struct pluto_solver_session {
+    isl_ctx *ctx;
+
+    /* Non-negative orthant of dimensionality 'orthant_dim'; cached since
+     * consecutive lexmin queries are mostly of the same width */
+    isl_basic_set *orthant;
+    int orthant_dim;
+
+    /* isl sets of the base rows (see PlutoSparseConstraints nbase) of
+     * recently solved systems, along with a copy of those rows to match
+     * against; a base is simplified once it's seen a second time */
+    PlutoSparseConstraints *base_rows[PLUTO_SOLVER_NUM_BASES];
+    isl_basic_set *base_sets[PLUTO_SOLVER_NUM_BASES];
+    int base_simplified[PLUTO_SOLVER_NUM_BASES];
+    long base_last_use[PLUTO_SOLVER_NUM_BASES];
+
+    /* Number of queries answered */
+    long num_is_empty_calls;
+    long num_lexmin_calls;
+    /* Min/max of an affine function (pluto_constraints_affine_sign_range) */
+    long num_range_calls;
+    /* Lexmin calls that reused a base */
+    long num_base_hits;
+    /* Lexmin queries answered by each back end with --portfolio */
+    long num_isl_wins;
+    long num_pip_wins;
+
+    PlutoFMStats fm_stats;
+};
+typedef struct pluto_solver_session PlutoSolverSession;
+
+/* Cache of Farkas lemma results (see farkas_lemma_affine_cached) */
+struct pluto_farkas_cache {
+    /* Hash table with chaining */
+    struct farkas_cache_entry **buckets;
+    int nbuckets;
+
+    long num_lookups;
+    long num_hits;
+};
+typedef struct pluto_farkas_cache PlutoFarkasCache;
+
 /* A constraint with one equality */
 typedef PlutoConstraints PlutoEquality;
 typedef PlutoConstraints Hyperplane;
@@ -76,6 +201,9 @@ PlutoConstraints *pluto_constraints_dup_single(const PlutoConstraints *src);
 
 void fourier_motzkin_eliminate(PlutoConstraints *, int n);
 void fourier_motzkin_eliminate_smart(PlutoConstraints *cst, int pos);
+void fourier_motzkin_eliminate_last(PlutoConstraints *cst, int num,
+        PlutoSolverSession *ss);
+void pluto_fm_stats_add(PlutoFMStats *stats, const PlutoFMStats *other);
 
 PlutoMatrix *pluto_constraints_to_pip_matrix(const PlutoConstraints *cst, PlutoMatrix *pmat);
 PlutoConstraints *pluto_constraints_to_pure_inequalities_single(const PlutoConstraints *cst);
@@ -86,8 +214,10 @@ PlutoConstraints *pluto_constraints_add_to_each(PlutoConstraints *cst1, const Pl
 
 void pluto_constraints_simplify(PlutoConstraints *const cst);
 
-int64 *pluto_constraints_lexmin(const PlutoConstraints *,int);
-int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar);
+int64 *pluto_constraints_lexmin(const PlutoConstraints *,int,
+        PlutoSolverSession *ss);
+int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar,
+        PlutoSolverSession *ss);
 int64 *pluto_constraints_lexmin_pip(const PlutoConstraints *cst, int negvar);
 void pluto_constraints_add_inequality(PlutoConstraints *cst);
 void pluto_constraints_add_equality(PlutoConstraints *cst);
@@ -108,6 +238,8 @@ void pluto_constraints_negate_constraint(PlutoConstraints *cst, int pos);
 void pluto_constraints_interchange_cols(PlutoConstraints *cst, int col1, int col2);
 
 PlutoConstraints *pluto_constraints_read(FILE *fp);
+void pluto_constraints_capture(const PlutoConstraints *cst, const char *kind,
+        int negvar);
 
 void pluto_constraints_print(FILE *fp, const PlutoConstraints *);
 void pluto_constraints_pretty_print(FILE *fp, const PlutoConstraints *cst);
@@ -142,13 +274,16 @@ PlutoConstraints *pluto_constraints_unionize(PlutoConstraints *cst1,
 PlutoConstraints *pluto_constraints_unionize_simple(PlutoConstraints *cst1, 
         const PlutoConstraints *cst2);
 
+PlutoConstraints *pluto_constraints_intersection_isl(const PlutoConstraints *cst1, 
+        const PlutoConstraints *cst2, PlutoSolverSession *ss);
 PlutoConstraints *pluto_constraints_intersect_isl(PlutoConstraints *cst1, 
-        const PlutoConstraints *cst2);
+        const PlutoConstraints *cst2, PlutoSolverSession *ss);
 
 int pluto_constraints_get_const_ub(const PlutoConstraints *cnst, int depth, int64 *ub);
 int pluto_constraints_get_const_lb(const PlutoConstraints *cnst, int depth, int64 *lb);
 
-int pluto_constraints_is_empty(const PlutoConstraints *cst);
+int pluto_constraints_is_empty(const PlutoConstraints *cst,
+        PlutoSolverSession *ss);
 int pluto_constraints_are_equal(const PlutoConstraints *cst1, const PlutoConstraints *cst2);
 
 PlutoConstraints *pluto_constraints_empty(int ncols);
@@ -178,6 +313,10 @@ int isl_basic_map_to_pluto_constraints_func_arg(__isl_keep isl_basic_map *bmap,
 __isl_give isl_basic_map *isl_basic_map_from_pluto_constraints(
        isl_ctx *ctx, const PlutoConstraints *cst, int n_par, int n_in, int n_out);
 void pluto_constraints_remove_names_single(PlutoConstraints *cst);
+int pluto_constraints_mark_redundant_lp(const PlutoConstraints *cst,
+        int *is_redun, PlutoSolverSession *ss);
+int pluto_constraints_affine_sign_range(const PlutoConstraints *cst,
+        const int64 *obj, int *min_sign, int *max_sign, PlutoSolverSession *ss);
 
 PlutoConstraints *pluto_constraints_unionize_isl(PlutoConstraints *cst1, 
         const PlutoConstraints *cst2);
@@ -194,8 +333,63 @@ void pluto_constraints_remove_names_single(PlutoConstraints *cst);
 void pluto_constraints_remove_names_single(PlutoConstraints *cst);
 
 void pluto_constraints_cplex_print(FILE *fp, const PlutoConstraints *cst);
-PlutoConstraints *farkas_lemma_affine(const PlutoConstraints *dom, const PlutoMatrix *phi);
+PlutoConstraints *farkas_lemma_affine(const PlutoConstraints *dom,
+        const PlutoMatrix *phi, PlutoSolverSession *ss);
+PlutoConstraints *farkas_lemma_affine_cached(const PlutoConstraints *dom,
+        const PlutoMatrix *phi, PlutoFarkasCache *cache, PlutoSolverSession *ss);
+PlutoFarkasCache *pluto_farkas_cache_alloc();
+void pluto_farkas_cache_free(PlutoFarkasCache *cache);
 void pluto_constraints_gaussian_eliminate(PlutoConstraints *cst, int pos);
 
+PlutoSparseConstraints *pluto_sparse_constraints_alloc(int nrows, int nnz,
+        int ncols);
+void pluto_sparse_constraints_free(PlutoSparseConstraints *sc);
+PlutoSparseConstraints *pluto_sparse_constraints_copy(PlutoSparseConstraints *dest,
+        const PlutoSparseConstraints *src);
+PlutoSparseConstraints *pluto_sparse_constraints_dup(const PlutoSparseConstraints *src);
+void pluto_sparse_constraints_add_constraint(PlutoSparseConstraints *sc, int is_eq);
+void pluto_sparse_constraints_add_coeff(PlutoSparseConstraints *sc, int col,
+        int64 val);
+void pluto_sparse_constraints_add_row(PlutoSparseConstraints *sc,
+        const PlutoSparseConstraints *src, int row);
+void pluto_sparse_constraints_add_lb(PlutoSparseConstraints *sc, int varnum,
+        int64 lb);
+void pluto_sparse_constraints_add_ub(PlutoSparseConstraints *sc, int varnum,
+        int64 ub);
+int64 pluto_sparse_constraints_get(const PlutoSparseConstraints *sc, int row,
+        int col);
+PlutoSparseConstraints *pluto_sparse_constraints_add(PlutoSparseConstraints *sc1,
+        const PlutoSparseConstraints *sc2);
+PlutoSparseConstraints *pluto_sparse_constraints_add_dense(PlutoSparseConstraints *sc,
+        const PlutoConstraints *cst);
+PlutoSparseConstraints *pluto_sparse_constraints_from_constraints(
+        const PlutoConstraints *cst);
+PlutoConstraints *pluto_sparse_constraints_to_constraints(
+        const PlutoSparseConstraints *sc);
+PlutoSparseConstraints *pluto_sparse_constraints_gather_cols(
+        const PlutoSparseConstraints *sc, const int *colmap, int ncols);
+int pluto_sparse_constraints_rows_equal(const PlutoSparseConstraints *sc1,
+        const PlutoSparseConstraints *sc2, int nrows);
+void pluto_sparse_constraints_simplify(PlutoSparseConstraints *sc);
+int pluto_sparse_constraints_get_nnz(const PlutoSparseConstraints *sc);
+void pluto_sparse_constraints_pretty_print(FILE *fp,
+        const PlutoSparseConstraints *sc);
+int64 *pluto_sparse_constraints_lexmin(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss);
+PlutoSparseConstraints *pluto_sparse_constraints_presolve(
+        const PlutoSparseConstraints *sc, PlutoPresolveInfo **info);
+int64 *pluto_presolve_postsolve(const int64 *sol, const PlutoPresolveInfo *info);
+void pluto_presolve_info_free(PlutoPresolveInfo *info);
+int64 *pluto_sparse_constraints_lexmin_isl(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss);
+int64 *pluto_sparse_constraints_lexmin_portfolio(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss);
+__isl_give isl_basic_set *isl_basic_set_from_pluto_sparse_constraints(
+        isl_ctx *ctx, const PlutoSparseConstraints *sc);
+
 int pluto_constraints_get_num_non_zero_coeffs(const PlutoConstraints* cst);
+
+PlutoSolverSession *pluto_solver_session_alloc();
+void pluto_solver_session_free(PlutoSolverSession *ss);
+long pluto_solver_session_num_calls(const PlutoSolverSession *ss);
 #endif
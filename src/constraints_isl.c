@@ -8,15 +8,22 @@
 #include <assert.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/time.h>
 
 #include "math_support.h"
 #include "constraints.h"
 #include "pluto.h"
+#include "profile.h"
 
 #include "isl/map.h"
 #include "isl/set.h"
+#include "isl/aff.h"
+#include "isl/constraint.h"
+#include "isl/ilp.h"
+#include "isl/local_space.h"
 #include "isl/val_gmp.h"
+#include "isl/options.h"
 
 /* start: 0-indexed */
 void pluto_constraints_project_out_isl(
@@ -334,26 +341,30 @@ int isl_basic_map_to_pluto_constraints_func_arg(
 }
 
 
-/* Use isl to solve these constraints (solves just for the first element if
- * it's a list of constraints */
-int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar) 
+/* Lexmin of the non-parametric set built from 'bset' (taken) in ctx;
+ * ctx is the session's if 'ss' is non-NULL */
+static int64 *isl_basic_set_lexmin_sol(isl_ctx *ctx, __isl_take isl_basic_set *bset,
+        int ncols, int negvar, PlutoSolverSession *ss)
 {
     int i;
     int64 *sol;
-    isl_ctx *ctx;
-    isl_basic_set *bset, *all_positive;
+    isl_basic_set *all_positive;
     isl_set *domain, *all_positive_set, *lexmin;
 
-    IF_DEBUG2(printf("[pluto] pluto_constraints_lexmin_isl (%d variables, %d constraints)\n",
-                cst->ncols-1, cst->nrows););
-
-    ctx = isl_ctx_alloc();
-    bset = isl_basic_set_from_pluto_constraints(ctx, cst);
     domain = isl_set_from_basic_set(bset);
 
     // Allow only positive values.
     if(negvar == 0) {
-        all_positive = isl_basic_set_positive_orthant(isl_set_get_dim(domain));
+        if (ss) {
+            if (ss->orthant == NULL || ss->orthant_dim != ncols-1) {
+                isl_basic_set_free(ss->orthant);
+                ss->orthant = isl_basic_set_positive_orthant(isl_set_get_dim(domain));
+                ss->orthant_dim = ncols-1;
+            }
+            all_positive = isl_basic_set_copy(ss->orthant);
+        }else{
+            all_positive = isl_basic_set_positive_orthant(isl_set_get_dim(domain));
+        }
         all_positive_set = isl_set_from_basic_set(all_positive);
         domain = isl_set_intersect(domain, all_positive_set);
     }
@@ -363,7 +374,6 @@ int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar)
 
     if (isl_set_is_empty(lexmin)) {
         isl_set_free(lexmin);
-        isl_ctx_free(ctx);
         return NULL;
     }
 
@@ -382,11 +392,338 @@ int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar)
     }
 
     isl_point_free(p);
-    isl_ctx_free(ctx);
 
     return sol;
 }
 
+
+/* Use isl to solve these constraints (solves just for the first element if
+ * it's a list of constraints; the query is run in the session's context if
+ * 'ss' is non-NULL */
+int64 *pluto_constraints_lexmin_isl(const PlutoConstraints *cst, int negvar,
+        PlutoSolverSession *ss) 
+{
+    int64 *sol;
+    isl_ctx *ctx;
+    isl_basic_set *bset;
+
+    IF_DEBUG2(printf("[pluto] pluto_constraints_lexmin_isl (%d variables, %d constraints)\n",
+                cst->ncols-1, cst->nrows););
+
+    ctx = ss? ss->ctx: isl_ctx_alloc();
+    bset = isl_basic_set_from_pluto_constraints(ctx, cst);
+    sol = isl_basic_set_lexmin_sol(ctx, bset, cst->ncols, negvar, ss);
+    if (!ss) isl_ctx_free(ctx);
+
+    return sol;
+}
+
+
+/* Add rows [first, last) of sc to bset (non-parametric, of sc->ncols-1
+ * dimensions) */
+static __isl_give isl_basic_set *isl_basic_set_add_pluto_sparse_rows(
+        __isl_take isl_basic_set *bset, const PlutoSparseConstraints *sc,
+        int first, int last)
+{
+    int i, k;
+    isl_ctx *ctx;
+    isl_local_space *ls;
+
+    ctx = isl_basic_set_get_ctx(bset);
+    ls = isl_local_space_from_space(isl_basic_set_get_space(bset));
+
+    for (i=first; i<last; i++) {
+        isl_constraint *c;
+
+        if (sc->is_eq[i]) {
+            c = isl_equality_alloc(isl_local_space_copy(ls));
+        }else{
+            c = isl_inequality_alloc(isl_local_space_copy(ls));
+        }
+        for (k=sc->start[i]; k<sc->start[i+1]; k++) {
+            isl_val *v = isl_val_int_from_si(ctx, sc->val[k]);
+            if (sc->col[k] == sc->ncols-1) {
+                c = isl_constraint_set_constant_val(c, v);
+            }else{
+                c = isl_constraint_set_coefficient_val(c, isl_dim_set,
+                        sc->col[k], v);
+            }
+        }
+        bset = isl_basic_set_add_constraint(bset, c);
+    }
+
+    isl_local_space_free(ls);
+
+    return bset;
+}
+
+
+/*
+ * Construct a non-parametric basic set from sparse constraints; only the
+ * non-zero coefficients are set (no dense matrix is formed)
+ */
+__isl_give isl_basic_set *isl_basic_set_from_pluto_sparse_constraints(
+        isl_ctx *ctx, const PlutoSparseConstraints *sc)
+{
+    isl_basic_set *bset;
+
+    bset = isl_basic_set_universe(isl_space_set_alloc(ctx, 0, sc->ncols-1));
+
+    return isl_basic_set_add_pluto_sparse_rows(bset, sc, 0, sc->nrows);
+}
+
+
+/*
+ * The isl set of the base rows of sc (the first sc->nbase) from the
+ * session's cache; the least recently used entry is replaced on a miss.
+ * Implicit equalities and redundant rows are removed from a base the
+ * second time it's asked for, and so every solve after the first one on
+ * the same base (e.g., for successive hyperplanes of a band) starts from
+ * the reduced system, with only the rows that changed to be added
+ */
+static __isl_keep isl_basic_set *pluto_solver_session_get_base(
+        PlutoSolverSession *ss, const PlutoSparseConstraints *sc)
+{
+    int i, b;
+    long now = ss->num_lexmin_calls;
+
+    b = 0;
+    for (i=0; i<PLUTO_SOLVER_NUM_BASES; i++) {
+        PlutoSparseConstraints *rows = ss->base_rows[i];
+        /* A set is NULL if its computation was aborted (--portfolio) */
+        if (rows && ss->base_sets[i] && rows->nrows == sc->nbase
+                && pluto_sparse_constraints_rows_equal(rows, sc, sc->nbase)) {
+            ss->base_last_use[i] = now;
+            ss->num_base_hits++;
+            if (!ss->base_simplified[i]) {
+                ss->base_sets[i] = isl_basic_set_detect_equalities(ss->base_sets[i]);
+                ss->base_sets[i] = isl_basic_set_remove_redundancies(ss->base_sets[i]);
+                ss->base_simplified[i] = 1;
+            }
+            return ss->base_sets[i];
+        }
+        if (ss->base_last_use[i] < ss->base_last_use[b]) b = i;
+    }
+
+    pluto_sparse_constraints_free(ss->base_rows[b]);
+    isl_basic_set_free(ss->base_sets[b]);
+
+    ss->base_rows[b] = pluto_sparse_constraints_dup(sc);
+    ss->base_rows[b]->nrows = sc->nbase;
+    ss->base_sets[b] = isl_basic_set_add_pluto_sparse_rows(
+            isl_basic_set_universe(isl_space_set_alloc(ss->ctx, 0, sc->ncols-1)),
+            sc, 0, sc->nbase);
+    ss->base_simplified[b] = 0;
+    ss->base_last_use[b] = now;
+
+    return ss->base_sets[b];
+}
+
+
+/* Sparse counterpart of pluto_constraints_lexmin_isl; with a session, the
+ * base rows of sc come from its cache (see pluto_solver_session_get_base) */
+int64 *pluto_sparse_constraints_lexmin_isl(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss)
+{
+    int64 *sol;
+    isl_ctx *ctx;
+    isl_basic_set *bset;
+
+    IF_DEBUG2(printf("[pluto] pluto_sparse_constraints_lexmin_isl (%d variables, %d constraints, %d non-zeros)\n",
+                sc->ncols-1, sc->nrows, pluto_sparse_constraints_get_nnz(sc)););
+
+    ctx = ss? ss->ctx: isl_ctx_alloc();
+    if (ss && sc->nbase > 0) {
+        bset = isl_basic_set_copy(pluto_solver_session_get_base(ss, sc));
+        bset = isl_basic_set_add_pluto_sparse_rows(bset, sc, sc->nbase, sc->nrows);
+    }else{
+        bset = isl_basic_set_from_pluto_sparse_constraints(ctx, sc);
+    }
+    sol = isl_basic_set_lexmin_sol(ctx, bset, sc->ncols, negvar, ss);
+    if (!ss) isl_ctx_free(ctx);
+
+    return sol;
+}
+
+/* A lexmin query raced between isl and PIP (see
+ * pluto_sparse_constraints_lexmin_portfolio) */
+struct lexmin_race {
+    pthread_mutex_t lock;
+
+    /* PIP's copy of the system */
+    PlutoConstraints *cst;
+    int negvar;
+
+    /* Context isl is solving in; aborted if PIP answers first */
+    isl_ctx *ctx;
+
+    /* Set once an answer has been taken */
+    int done;
+    PlutoSolverBackend winner;
+    int64 *sol;
+
+    /* The caller and the PIP thread; the last one out frees it */
+    int refs;
+
+    /* Options of the PIP thread: a copy of the caller's values that the PIP
+     * path reads, since the PIP thread may outlive the caller's options */
+    PlutoOptions *options;
+};
+
+/* PIP solves are serialized (see pluto_constraints_lexmin_pip); rather than
+ * queue up behind one that lost a race and is still running, later queries
+ * are left to isl */
+static pthread_mutex_t pip_lock = PTHREAD_MUTEX_INITIALIZER;
+static int pip_busy = 0;
+
+
+static void lexmin_race_release(struct lexmin_race *race)
+{
+    int last;
+
+    pthread_mutex_lock(&race->lock);
+    last = (--race->refs == 0);
+    pthread_mutex_unlock(&race->lock);
+
+    if (last) {
+        pthread_mutex_destroy(&race->lock);
+        pluto_constraints_free(race->cst);
+        pluto_options_free(race->options);
+        free(race->sol);
+        free(race);
+    }
+}
+
+
+static void *lexmin_race_pip(void *arg)
+{
+    int64 *sol;
+    struct lexmin_race *race = arg;
+
+    pluto_options = race->options;
+
+    sol = pluto_constraints_lexmin_pip(race->cst, race->negvar);
+
+    pthread_mutex_lock(&race->lock);
+    if (!race->done) {
+        race->done = 1;
+        race->winner = SOLVER_PIP;
+        race->sol = sol;
+        isl_ctx_abort(race->ctx);
+    }else{
+        free(sol);
+    }
+    pthread_mutex_unlock(&race->lock);
+
+    pthread_mutex_lock(&pip_lock);
+    pip_busy = 0;
+    pthread_mutex_unlock(&pip_lock);
+
+    lexmin_race_release(race);
+
+    return NULL;
+}
+
+
+/*
+ * Lexmin with isl and PIP racing (--portfolio): PIP runs in a thread of
+ * its own on a dense copy while isl solves in the calling thread, and the
+ * first answer is taken (both are exact). If PIP wins, the isl
+ * computation is aborted through its context; PIP can't be interrupted,
+ * so if isl wins, PIP runs to completion in the background and its answer
+ * is dropped. Until it's done, later queries are solved by isl alone. The
+ * back end that answered is recorded in the session and in the profile.
+ * GLPK isn't raced since it minimizes a weighted sum and not the lexmin
+ */
+int64 *pluto_sparse_constraints_lexmin_portfolio(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss)
+{
+    int use_pip, on_error;
+    int64 *sol;
+    pthread_t thread;
+    struct lexmin_race *race;
+    PlutoSolverBackend winner;
+    PlutoSolverSession *tss = NULL;
+
+    double t_start = pluto_profile_clock();
+
+    if (ss == NULL) {
+        /* A context of our own is needed to abort isl */
+        ss = tss = pluto_solver_session_alloc();
+    }
+
+    pthread_mutex_lock(&pip_lock);
+    use_pip = !pip_busy;
+    if (use_pip) pip_busy = 1;
+    pthread_mutex_unlock(&pip_lock);
+
+    race = NULL;
+    if (use_pip) {
+        race = (struct lexmin_race *) malloc(sizeof(struct lexmin_race));
+        pthread_mutex_init(&race->lock, NULL);
+        race->cst = pluto_sparse_constraints_to_constraints(sc);
+        race->negvar = negvar;
+        race->ctx = ss->ctx;
+        race->done = 0;
+        race->sol = NULL;
+        race->refs = 2;
+        race->options = pluto_options_alloc();
+        race->options->debug = pluto_options->debug;
+        race->options->moredebug = pluto_options->moredebug;
+        race->options->silent = pluto_options->silent;
+        if (pthread_create(&thread, NULL, lexmin_race_pip, race) != 0) {
+            race->refs = 1;
+            lexmin_race_release(race);
+            race = NULL;
+            pthread_mutex_lock(&pip_lock);
+            pip_busy = 0;
+            pthread_mutex_unlock(&pip_lock);
+        }else{
+            pthread_detach(thread);
+        }
+    }
+
+    /* An abort shouldn't be reported as an error */
+    on_error = isl_options_get_on_error(ss->ctx);
+    isl_options_set_on_error(ss->ctx, ISL_ON_ERROR_CONTINUE);
+
+    sol = pluto_sparse_constraints_lexmin_isl(sc, negvar, ss);
+    winner = SOLVER_ISL;
+
+    if (race) {
+        pthread_mutex_lock(&race->lock);
+        if (!race->done) {
+            race->done = 1;
+            race->winner = SOLVER_ISL;
+        }else{
+            free(sol);
+            sol = race->sol;
+            race->sol = NULL;
+            winner = race->winner;
+            isl_ctx_resume(ss->ctx);
+        }
+        pthread_mutex_unlock(&race->lock);
+        lexmin_race_release(race);
+    }
+
+    isl_options_set_on_error(ss->ctx, on_error);
+
+    if (winner == SOLVER_PIP) ss->num_pip_wins++;
+    else ss->num_isl_wins++;
+
+    IF_DEBUG2(printf("[pluto] pluto_sparse_constraints_lexmin_portfolio: answered by %s%s\n",
+                winner == SOLVER_PIP? "PIP": "isl", race? "": " (uncontested)"););
+
+    pluto_profile_add_portfolio_query(sc->nrows, sc->ncols,
+            pluto_sparse_constraints_get_nnz(sc), winner, race != NULL,
+            pluto_profile_clock() - t_start);
+
+    pluto_solver_session_free(tss);
+
+    return sol;
+}
+
+
 PlutoConstraints *pluto_constraints_union_isl(const PlutoConstraints *cst1, 
         const PlutoConstraints *cst2)
 {
@@ -423,12 +760,12 @@ int isl_map_count(__isl_take isl_map *map, void *user)
 
 
 PlutoConstraints *pluto_constraints_intersection_isl(const PlutoConstraints *cst1, 
-        const PlutoConstraints *cst2)
+        const PlutoConstraints *cst2, PlutoSolverSession *ss)
 {
     isl_set *iset1, *iset2, *iset3;
     PlutoConstraints *icst;
 
-    isl_ctx *ctx = isl_ctx_alloc();
+    isl_ctx *ctx = ss? ss->ctx: isl_ctx_alloc();
 
     iset1 = isl_set_from_pluto_constraints(cst1, ctx);
     iset2 = isl_set_from_pluto_constraints(cst2, ctx);
@@ -438,7 +775,7 @@ PlutoConstraints *pluto_constraints_intersection_isl(const PlutoConstraints *cst
     icst = isl_set_to_pluto_constraints(iset3);
     isl_set_free(iset3);
 
-    isl_ctx_free(ctx);
+    if (!ss) isl_ctx_free(ctx);
 
     return icst;
 }
@@ -446,11 +783,180 @@ PlutoConstraints *pluto_constraints_intersection_isl(const PlutoConstraints *cst
 
 /* In-place intersection: first argument is modified */
 PlutoConstraints *pluto_constraints_intersect_isl(PlutoConstraints *cst1, 
-        const PlutoConstraints *cst2)
+        const PlutoConstraints *cst2, PlutoSolverSession *ss)
 {
-    PlutoConstraints *icst = pluto_constraints_intersection_isl(cst1, cst2);
+    PlutoConstraints *icst = pluto_constraints_intersection_isl(cst1, cst2, ss);
     pluto_constraints_copy(cst1, icst);
     pluto_constraints_free(icst);
 
     return cst1;
 }
+
+
+/*
+ * Marks in is_redun the inequalities of cst (first element) that are
+ * implied, over the rationals, by the rows of cst not already marked; for
+ * each row, the maximum of its negation over the rest is found with an LP.
+ * Rows are checked one after the other so that only one of a set of
+ * mutually implied rows is marked. Returns the number of rows marked
+ */
+int pluto_constraints_mark_redundant_lp(const PlutoConstraints *cst,
+        int *is_redun, PlutoSolverSession *ss)
+{
+    int i, j, r, num_redun;
+    isl_ctx *ctx;
+    isl_basic_set *bset;
+    isl_aff *obj;
+    isl_val *max;
+    PlutoConstraints *rest;
+
+    ctx = ss? ss->ctx: isl_ctx_alloc();
+    rest = pluto_constraints_alloc(PLMAX(1,cst->nrows), cst->ncols);
+
+    num_redun = 0;
+    for (i=0; i<cst->nrows; i++) {
+        if (cst->is_eq[i] || is_redun[i]) continue;
+
+        rest->nrows = 0;
+        for (r=0; r<cst->nrows; r++) {
+            if (r == i || is_redun[r]) continue;
+            memcpy(rest->val[rest->nrows], cst->val[r], cst->ncols*sizeof(int64));
+            rest->is_eq[rest->nrows] = cst->is_eq[r];
+            rest->nrows++;
+        }
+
+        bset = isl_basic_set_from_pluto_constraints(ctx, rest);
+        bset = isl_basic_set_set_rational(bset);
+
+        obj = isl_aff_zero_on_domain(
+                isl_local_space_from_space(isl_basic_set_get_space(bset)));
+        for (j=0; j<cst->ncols-1; j++) {
+            obj = isl_aff_set_coefficient_val(obj, isl_dim_in, j,
+                    isl_val_int_from_si(ctx, -cst->val[i][j]));
+        }
+        obj = isl_aff_set_constant_val(obj,
+                isl_val_int_from_si(ctx, -cst->val[i][cst->ncols-1]));
+
+        /* Row i is implied if its negation can't be made positive (NaN
+         * means the rest is empty) */
+        max = isl_basic_set_max_val(bset, obj);
+        if (isl_val_is_nan(max) || !isl_val_is_pos(max)) {
+            is_redun[i] = 1;
+            num_redun++;
+        }
+
+        isl_val_free(max);
+        isl_aff_free(obj);
+        isl_basic_set_free(bset);
+    }
+
+    pluto_constraints_free(rest);
+    if (ss == NULL) isl_ctx_free(ctx);
+
+    return num_redun;
+}
+
+
+/*
+ * Signs of the minimum and maximum of the affine function 'obj' (cst->ncols
+ * coefficients, the last being the constant) over the integer points of
+ * 'cst': -1, 0, or 1, where an unbounded minimum (maximum) has sign -1 (1).
+ * Both come from a single isl set. Returns 1 if 'cst' is empty (signs
+ * aren't set), 0 otherwise
+ */
+int pluto_constraints_affine_sign_range(const PlutoConstraints *cst,
+        const int64 *obj, int *min_sign, int *max_sign, PlutoSolverSession *ss)
+{
+    int j, is_empty;
+    isl_ctx *ctx;
+    isl_set *set;
+    isl_aff *aff;
+    isl_val *min, *max;
+
+    if (ss) ss->num_range_calls++;
+
+    double t_start = pluto_profile_clock();
+
+    ctx = ss? ss->ctx: isl_ctx_alloc();
+    set = isl_set_from_pluto_constraints(cst, ctx);
+
+    aff = isl_aff_zero_on_domain(
+            isl_local_space_from_space(isl_set_get_space(set)));
+    for (j=0; j<cst->ncols-1; j++) {
+        aff = isl_aff_set_coefficient_val(aff, isl_dim_in, j,
+                isl_val_int_from_si(ctx, obj[j]));
+    }
+    aff = isl_aff_set_constant_val(aff,
+            isl_val_int_from_si(ctx, obj[cst->ncols-1]));
+
+    min = isl_set_min_val(set, aff);
+    is_empty = isl_val_is_nan(min);
+    if (!is_empty) {
+        max = isl_set_max_val(set, aff);
+        *min_sign = isl_val_sgn(min);
+        *max_sign = isl_val_sgn(max);
+        isl_val_free(max);
+    }
+
+    isl_val_free(min);
+    isl_aff_free(aff);
+    isl_set_free(set);
+    if (!ss) isl_ctx_free(ctx);
+
+    pluto_profile_add_solver_call(PROF_RANGE, cst->nrows, cst->ncols,
+            pluto_profile_clock() - t_start);
+
+    return is_empty;
+}
+
+
+PlutoSolverSession *pluto_solver_session_alloc()
+{
+    int i;
+    PlutoSolverSession *ss = (PlutoSolverSession *) malloc(sizeof(PlutoSolverSession));
+
+    ss->ctx = isl_ctx_alloc();
+    assert(ss->ctx);
+    ss->orthant = NULL;
+    ss->orthant_dim = -1;
+    ss->num_is_empty_calls = 0;
+    ss->num_lexmin_calls = 0;
+    ss->num_range_calls = 0;
+    ss->num_base_hits = 0;
+    ss->num_isl_wins = 0;
+    ss->num_pip_wins = 0;
+    memset(&ss->fm_stats, 0, sizeof(PlutoFMStats));
+    for (i=0; i<PLUTO_SOLVER_NUM_BASES; i++) {
+        ss->base_rows[i] = NULL;
+        ss->base_sets[i] = NULL;
+        ss->base_simplified[i] = 0;
+        ss->base_last_use[i] = -1;
+    }
+
+    return ss;
+}
+
+
+void pluto_solver_session_free(PlutoSolverSession *ss)
+{
+    int i;
+
+    if (ss == NULL) return;
+
+    for (i=0; i<PLUTO_SOLVER_NUM_BASES; i++) {
+        pluto_sparse_constraints_free(ss->base_rows[i]);
+        isl_basic_set_free(ss->base_sets[i]);
+    }
+    isl_basic_set_free(ss->orthant);
+    isl_ctx_free(ss->ctx);
+    free(ss);
+}
+
+
+/* Total number of solver queries made through this session */
+long pluto_solver_session_num_calls(const PlutoSolverSession *ss)
+{
+    if (ss == NULL) return 0;
+
+    return ss->num_is_empty_calls + ss->num_lexmin_calls + ss->num_range_calls;
+}
@@ -247,11 +247,11 @@ PlutoConstraints *pluto_constraints_subtract(PlutoConstraints *cst1,
 
 int pluto_constraints_are_equal(const PlutoConstraints *cst1, const PlutoConstraints *cst2) {
     PlutoConstraints *diff = pluto_constraints_difference(cst1,cst2);
-    int are_constraints_equal = pluto_constraints_is_empty(diff);
+    int are_constraints_equal = pluto_constraints_is_empty(diff, NULL);
     pluto_constraints_free(diff);
     if (are_constraints_equal) {
         diff = pluto_constraints_difference(cst2, cst1);
-        are_constraints_equal = pluto_constraints_is_empty(diff);
+        are_constraints_equal = pluto_constraints_is_empty(diff, NULL);
         pluto_constraints_free(diff);
     }
     return are_constraints_equal;
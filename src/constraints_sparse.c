@@ -0,0 +1,948 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ *
+ * Copyright (C) 2007-2012 Uday Bondhugula
+ *
+ * This file is part of Pluto.
+ *
+ * Pluto is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the file
+ * `LICENSE' in the top-level directory of this distribution.
+ *
+ * constraints_sparse.c
+ *
+ * Row-compressed constraints (PlutoSparseConstraints) for the wide systems
+ * of the Pluto ILP
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "math_support.h"
+#include "constraints.h"
+#include "pluto.h"
+#include "profile.h"
+
+
+PlutoSparseConstraints *pluto_sparse_constraints_alloc(int nrows, int nnz,
+        int ncols)
+{
+    PlutoSparseConstraints *sc;
+
+    sc = (PlutoSparseConstraints *) malloc(sizeof(PlutoSparseConstraints));
+
+    sc->alloc_nrows = PLMAX(1,nrows);
+    sc->alloc_nnz = PLMAX(1,nnz);
+
+    sc->start = (int *) malloc((sc->alloc_nrows+1)*sizeof(int));
+    sc->is_eq = (int *) malloc(sc->alloc_nrows*sizeof(int));
+    sc->col = (int *) malloc(sc->alloc_nnz*sizeof(int));
+    sc->val = (int64 *) malloc(sc->alloc_nnz*sizeof(int64));
+
+    if (!sc->start || !sc->is_eq || !sc->col || !sc->val) {
+        fprintf(stderr, "[pluto] ERROR: Not enough memory to allocate constraints\n");
+        exit(1);
+    }
+
+    sc->start[0] = 0;
+    sc->nrows = 0;
+    sc->ncols = ncols;
+    sc->nbase = 0;
+
+    return sc;
+}
+
+
+void pluto_sparse_constraints_free(PlutoSparseConstraints *sc)
+{
+    if (sc == NULL) return;
+
+    free(sc->start);
+    free(sc->is_eq);
+    free(sc->col);
+    free(sc->val);
+    free(sc);
+}
+
+
+/* Make room for at least nrows rows and nnz non-zeros in all */
+static void pluto_sparse_constraints_reserve(PlutoSparseConstraints *sc,
+        int nrows, int nnz)
+{
+    if (nrows > sc->alloc_nrows) {
+        sc->alloc_nrows = PLMAX(nrows, 2*sc->alloc_nrows);
+        sc->start = (int *) realloc(sc->start, (sc->alloc_nrows+1)*sizeof(int));
+        sc->is_eq = (int *) realloc(sc->is_eq, sc->alloc_nrows*sizeof(int));
+    }
+    if (nnz > sc->alloc_nnz) {
+        sc->alloc_nnz = PLMAX(nnz, 2*sc->alloc_nnz);
+        sc->col = (int *) realloc(sc->col, sc->alloc_nnz*sizeof(int));
+        sc->val = (int64 *) realloc(sc->val, sc->alloc_nnz*sizeof(int64));
+    }
+    if (!sc->start || !sc->is_eq || !sc->col || !sc->val) {
+        fprintf(stderr, "[pluto] ERROR: Not enough memory to allocate constraints\n");
+        exit(1);
+    }
+}
+
+
+/* Copy src into dest (dest is resized if necessary) */
+PlutoSparseConstraints *pluto_sparse_constraints_copy(PlutoSparseConstraints *dest,
+        const PlutoSparseConstraints *src)
+{
+    int nnz = src->start[src->nrows];
+
+    pluto_sparse_constraints_reserve(dest, src->nrows, nnz);
+
+    memcpy(dest->start, src->start, (src->nrows+1)*sizeof(int));
+    memcpy(dest->is_eq, src->is_eq, src->nrows*sizeof(int));
+    memcpy(dest->col, src->col, nnz*sizeof(int));
+    memcpy(dest->val, src->val, nnz*sizeof(int64));
+    dest->nrows = src->nrows;
+    dest->ncols = src->ncols;
+    dest->nbase = src->nbase;
+
+    return dest;
+}
+
+
+PlutoSparseConstraints *pluto_sparse_constraints_dup(const PlutoSparseConstraints *src)
+{
+    PlutoSparseConstraints *dup = pluto_sparse_constraints_alloc(src->nrows,
+            src->start[src->nrows], src->ncols);
+    return pluto_sparse_constraints_copy(dup, src);
+}
+
+
+/* Add an empty (all-zero) row */
+void pluto_sparse_constraints_add_constraint(PlutoSparseConstraints *sc, int is_eq)
+{
+    pluto_sparse_constraints_reserve(sc, sc->nrows+1, 0);
+    sc->is_eq[sc->nrows] = is_eq;
+    sc->start[sc->nrows+1] = sc->start[sc->nrows];
+    sc->nrows++;
+}
+
+
+/* Add 'val' to the coefficient of column 'col' in the last row */
+void pluto_sparse_constraints_add_coeff(PlutoSparseConstraints *sc, int col,
+        int64 val)
+{
+    int i, first, last;
+
+    assert(sc->nrows >= 1);
+    assert(col >= 0 && col <= sc->ncols-1);
+
+    if (val == 0) return;
+
+    first = sc->start[sc->nrows-1];
+    last = sc->start[sc->nrows];
+
+    /* Rows are short: a linear scan from the end finds the slot (columns
+     * are mostly added in increasing order) */
+    for (i=last-1; i>=first && sc->col[i] > col; i--)
+        ;
+
+    if (i >= first && sc->col[i] == col) {
+        sc->val[i] += val;
+        if (sc->val[i] == 0) {
+            memmove(&sc->col[i], &sc->col[i+1], (last-i-1)*sizeof(int));
+            memmove(&sc->val[i], &sc->val[i+1], (last-i-1)*sizeof(int64));
+            sc->start[sc->nrows]--;
+        }
+        return;
+    }
+
+    pluto_sparse_constraints_reserve(sc, sc->nrows, last+1);
+    memmove(&sc->col[i+2], &sc->col[i+1], (last-i-1)*sizeof(int));
+    memmove(&sc->val[i+2], &sc->val[i+1], (last-i-1)*sizeof(int64));
+    sc->col[i+1] = col;
+    sc->val[i+1] = val;
+    sc->start[sc->nrows]++;
+}
+
+
+/* Append row 'row' of src to sc */
+void pluto_sparse_constraints_add_row(PlutoSparseConstraints *sc,
+        const PlutoSparseConstraints *src, int row)
+{
+    int len = src->start[row+1] - src->start[row];
+
+    assert(sc->ncols == src->ncols);
+
+    pluto_sparse_constraints_add_constraint(sc, src->is_eq[row]);
+    pluto_sparse_constraints_reserve(sc, sc->nrows, sc->start[sc->nrows]+len);
+    memcpy(&sc->col[sc->start[sc->nrows-1]], &src->col[src->start[row]],
+            len*sizeof(int));
+    memcpy(&sc->val[sc->start[sc->nrows-1]], &src->val[src->start[row]],
+            len*sizeof(int64));
+    sc->start[sc->nrows] += len;
+}
+
+
+/* Add a lower bound for a variable */
+void pluto_sparse_constraints_add_lb(PlutoSparseConstraints *sc, int varnum,
+        int64 lb)
+{
+    assert(varnum >=0 && varnum <= sc->ncols-2);
+
+    pluto_sparse_constraints_add_constraint(sc, 0);
+    pluto_sparse_constraints_add_coeff(sc, varnum, 1);
+    pluto_sparse_constraints_add_coeff(sc, sc->ncols-1, -lb);
+}
+
+
+/* Add an upper bound for a variable */
+void pluto_sparse_constraints_add_ub(PlutoSparseConstraints *sc, int varnum,
+        int64 ub)
+{
+    assert(varnum >=0 && varnum <= sc->ncols-2);
+
+    pluto_sparse_constraints_add_constraint(sc, 0);
+    pluto_sparse_constraints_add_coeff(sc, varnum, -1);
+    pluto_sparse_constraints_add_coeff(sc, sc->ncols-1, ub);
+}
+
+
+/* Coefficient of column 'col' in row 'row' */
+int64 pluto_sparse_constraints_get(const PlutoSparseConstraints *sc, int row,
+        int col)
+{
+    int i;
+
+    for (i=sc->start[row]; i<sc->start[row+1]; i++) {
+        if (sc->col[i] == col) return sc->val[i];
+        if (sc->col[i] > col) break;
+    }
+    return 0;
+}
+
+
+/* Append rows of sc2 to sc1; returns sc1 */
+PlutoSparseConstraints *pluto_sparse_constraints_add(PlutoSparseConstraints *sc1,
+        const PlutoSparseConstraints *sc2)
+{
+    int i, nnz1, nnz2;
+
+    assert(sc1->ncols == sc2->ncols);
+
+    nnz1 = sc1->start[sc1->nrows];
+    nnz2 = sc2->start[sc2->nrows];
+
+    pluto_sparse_constraints_reserve(sc1, sc1->nrows+sc2->nrows, nnz1+nnz2);
+
+    memcpy(&sc1->col[nnz1], sc2->col, nnz2*sizeof(int));
+    memcpy(&sc1->val[nnz1], sc2->val, nnz2*sizeof(int64));
+    memcpy(&sc1->is_eq[sc1->nrows], sc2->is_eq, sc2->nrows*sizeof(int));
+    for (i=1; i<=sc2->nrows; i++) {
+        sc1->start[sc1->nrows+i] = nnz1 + sc2->start[i];
+    }
+    sc1->nrows += sc2->nrows;
+
+    return sc1;
+}
+
+
+/* Append the rows of the dense cst (first element only) to sc */
+PlutoSparseConstraints *pluto_sparse_constraints_add_dense(PlutoSparseConstraints *sc,
+        const PlutoConstraints *cst)
+{
+    int i, j;
+
+    assert(sc->ncols == cst->ncols);
+
+    for (i=0; i<cst->nrows; i++) {
+        pluto_sparse_constraints_add_constraint(sc, cst->is_eq[i]);
+        for (j=0; j<cst->ncols; j++) {
+            pluto_sparse_constraints_add_coeff(sc, j, cst->val[i][j]);
+        }
+    }
+
+    return sc;
+}
+
+
+PlutoSparseConstraints *pluto_sparse_constraints_from_constraints(
+        const PlutoConstraints *cst)
+{
+    PlutoSparseConstraints *sc = pluto_sparse_constraints_alloc(cst->nrows,
+            pluto_constraints_get_num_non_zero_coeffs(cst)+cst->nrows, cst->ncols);
+    return pluto_sparse_constraints_add_dense(sc, cst);
+}
+
+
+/* Dense equivalent of sc; to be used only where a dense system is really
+ * needed (PIP, GLPK, or code working on small systems) */
+PlutoConstraints *pluto_sparse_constraints_to_constraints(
+        const PlutoSparseConstraints *sc)
+{
+    int i, k;
+
+    PlutoConstraints *cst = pluto_constraints_alloc(sc->nrows, sc->ncols);
+    cst->nrows = sc->nrows;
+
+    for (i=0; i<sc->nrows; i++) {
+        cst->is_eq[i] = sc->is_eq[i];
+        for (k=sc->start[i]; k<sc->start[i+1]; k++) {
+            cst->val[i][sc->col[k]] = sc->val[k];
+        }
+    }
+
+    return cst;
+}
+
+
+/*
+ * New system with column j of sc as column colmap[j] (of ncols), built in
+ * a single pass over the non-zeros of sc; the coefficients of column j are
+ * dropped if colmap[j] is -1 (i.e., the variable is set to zero). colmap
+ * must map the constant column to ncols-1. The columns of a row are
+ * re-sorted only if the map isn't monotonic on them
+ */
+PlutoSparseConstraints *pluto_sparse_constraints_gather_cols(
+        const PlutoSparseConstraints *sc, const int *colmap, int ncols)
+{
+    int i, k, l, p, first;
+    PlutoSparseConstraints *gc;
+
+    assert(colmap[sc->ncols-1] == ncols-1);
+
+    gc = pluto_sparse_constraints_alloc(sc->nrows, sc->start[sc->nrows], ncols);
+
+    p = 0;
+    for (i=0; i<sc->nrows; i++) {
+        first = p;
+        for (k=sc->start[i]; k<sc->start[i+1]; k++) {
+            int c = colmap[sc->col[k]];
+            if (c == -1) continue;
+            /* Insertion sort; rows are short */
+            for (l=p-1; l>=first && gc->col[l] > c; l--) {
+                gc->col[l+1] = gc->col[l];
+                gc->val[l+1] = gc->val[l];
+            }
+            gc->col[l+1] = c;
+            gc->val[l+1] = sc->val[k];
+            p++;
+        }
+        gc->start[i+1] = p;
+        gc->is_eq[i] = sc->is_eq[i];
+    }
+    gc->nrows = sc->nrows;
+    gc->nbase = sc->nbase;
+
+    return gc;
+}
+
+
+/* Are the first nrows rows of sc1 and sc2 the same? */
+int pluto_sparse_constraints_rows_equal(const PlutoSparseConstraints *sc1,
+        const PlutoSparseConstraints *sc2, int nrows)
+{
+    if (sc1->ncols != sc2->ncols || sc1->nrows < nrows || sc2->nrows < nrows) {
+        return 0;
+    }
+
+    if (memcmp(sc1->start, sc2->start, (nrows+1)*sizeof(int))
+            || memcmp(sc1->is_eq, sc2->is_eq, nrows*sizeof(int))) {
+        return 0;
+    }
+
+    return !memcmp(sc1->col, sc2->col, sc1->start[nrows]*sizeof(int))
+        && !memcmp(sc1->val, sc2->val, sc1->start[nrows]*sizeof(int64));
+}
+
+
+/* Hash of a row; the constant is included only for equalities (see
+ * pluto_constraints_simplify) */
+static unsigned long sparse_row_hash(const PlutoSparseConstraints *sc, int row)
+{
+    int k, last;
+    unsigned long hash = 5381;
+
+    last = sc->start[row+1];
+    /* The constant, if non-zero, is the last entry */
+    if (last > sc->start[row] && sc->col[last-1] == sc->ncols-1
+            && !sc->is_eq[row]) {
+        last--;
+    }
+
+    hash = hash*33 + sc->is_eq[row];
+    for (k=sc->start[row]; k<last; k++) {
+        hash = hash*33 + sc->col[k];
+        hash = hash*33 + (unsigned long) sc->val[k];
+    }
+
+    return hash;
+}
+
+
+/* Constant of a row */
+static int64 sparse_row_const(const PlutoSparseConstraints *sc, int row)
+{
+    int last = sc->start[row+1];
+
+    if (last > sc->start[row] && sc->col[last-1] == sc->ncols-1) {
+        return sc->val[last-1];
+    }
+    return 0;
+}
+
+
+/* Do rows r1 and r2 have the same coefficients (and the same constant if
+ * they are equalities)? */
+static int sparse_rows_match(const PlutoSparseConstraints *sc, int r1, int r2)
+{
+    int n1, n2;
+
+    if (sc->is_eq[r1] != sc->is_eq[r2]) return 0;
+
+    n1 = sc->start[r1+1] - sc->start[r1];
+    n2 = sc->start[r2+1] - sc->start[r2];
+
+    if (!sc->is_eq[r1]) {
+        if (sparse_row_const(sc, r1) != 0) n1--;
+        if (sparse_row_const(sc, r2) != 0) n2--;
+    }
+
+    return n1 == n2
+        && !memcmp(&sc->col[sc->start[r1]], &sc->col[sc->start[r2]], n1*sizeof(int))
+        && !memcmp(&sc->val[sc->start[r1]], &sc->val[sc->start[r2]], n1*sizeof(int64));
+}
+
+
+/*
+ * Sparse counterpart of pluto_constraints_simplify: normalizes rows by
+ * their gcd, and removes all-zero rows, duplicates and inequalities
+ * dominated by another one with the same coefficients (the smaller
+ * constant is kept). In place; the order of the rows kept is preserved
+ */
+void pluto_sparse_constraints_simplify(PlutoSparseConstraints *sc)
+{
+    int i, k, p, h, q, size, first, last, num_changed;
+    int64 _gcd;
+    int *table;
+    int64 *minc;
+
+    if (sc->nrows == 0) return;
+
+    for (size=1; size < 2*sc->nrows; size *= 2)
+        ;
+    table = (int *) malloc(size*sizeof(int));
+    for (h=0; h<size; h++) {
+        table[h] = -1;
+    }
+    /* Smallest constant seen for each kept row */
+    minc = (int64 *) malloc(sc->nrows*sizeof(int64));
+
+    p = 0;
+    q = 0;
+    num_changed = 0;
+    for (i=0; i<sc->nrows; i++) {
+        first = sc->start[i];
+        last = sc->start[i+1];
+
+        /* All zeros */
+        if (first == last) continue;
+
+        _gcd = PLABS(sc->val[first]);
+        for (k=first+1; k<last; k++) {
+            _gcd = gcd(PLABS(sc->val[k]), _gcd);
+        }
+
+        /* Compact row i into row p, starting at q */
+        for (k=first; k<last; k++) {
+            sc->col[q+k-first] = sc->col[k];
+            sc->val[q+k-first] = sc->val[k]/_gcd;
+        }
+        sc->is_eq[p] = sc->is_eq[i];
+        sc->start[p] = q;
+        sc->start[p+1] = q + (last-first);
+
+        h = sparse_row_hash(sc, p) & (size-1);
+        while (table[h] != -1 && !sparse_rows_match(sc, table[h], p)) {
+            h = (h+1) & (size-1);
+        }
+
+        if (table[h] != -1) {
+            /* Same as or dominated by a kept row unless its constant is
+             * smaller */
+            int64 c = sparse_row_const(sc, p);
+            if (c < minc[table[h]]) {
+                if (minc[table[h]] == sparse_row_const(sc, table[h])) num_changed++;
+                minc[table[h]] = c;
+            }
+            continue;
+        }
+
+        table[h] = p;
+        minc[p] = sparse_row_const(sc, p);
+        q = sc->start[p+1];
+        p++;
+    }
+    sc->nrows = p;
+
+    if (num_changed >= 1) {
+        /* Put in the stronger constants: entries may have to be added, so
+         * the rows are rewritten into new storage */
+        int *col = (int *) malloc((q+p)*sizeof(int));
+        int64 *val = (int64 *) malloc((q+p)*sizeof(int64));
+
+        q = 0;
+        for (i=0; i<p; i++) {
+            first = sc->start[i];
+            last = sc->start[i+1];
+            if (sparse_row_const(sc, i) != 0) last--;
+            sc->start[i] = q;
+            for (k=first; k<last; k++, q++) {
+                col[q] = sc->col[k];
+                val[q] = sc->val[k];
+            }
+            if (minc[i] != 0) {
+                col[q] = sc->ncols-1;
+                val[q] = minc[i];
+                q++;
+            }
+        }
+        sc->start[p] = q;
+
+        free(sc->col);
+        free(sc->val);
+        sc->col = col;
+        sc->val = val;
+        sc->alloc_nnz = PLMAX(1, q+p);
+    }
+
+    free(minc);
+    free(table);
+}
+
+
+/* Total number of non-zero coefficients (including constants) */
+int pluto_sparse_constraints_get_nnz(const PlutoSparseConstraints *sc)
+{
+    return sc->start[sc->nrows];
+}
+
+
+void pluto_sparse_constraints_pretty_print(FILE *fp,
+        const PlutoSparseConstraints *sc)
+{
+    PlutoConstraints *cst = pluto_sparse_constraints_to_constraints(sc);
+    pluto_constraints_pretty_print(fp, cst);
+    pluto_constraints_free(cst);
+}
+
+
+/* Variable states during presolve */
+#define PRESOLVE_ACTIVE 0
+#define PRESOLVE_FIXED 1
+#define PRESOLVE_ELIMINATED 2
+
+/* Passes over the rows that may tighten bounds */
+#define PRESOLVE_MAX_TIGHTEN 16
+
+/* floor(a/b) for b > 0 */
+static int64 presolve_floor_div(int64 a, int64 b)
+{
+    int64 q = a/b;
+    return (a%b != 0 && a < 0)? q-1: q;
+}
+
+/*
+ * Copy of the live rows of w, with the values of fixed variables moved into
+ * the constant and, if k is not -1, variable k replaced using row e (an
+ * equality in which it has a unit coefficient)
+ */
+static PlutoSparseConstraints *presolve_rebuild(const PlutoSparseConstraints *w,
+        const int *live, const int *state, const int64 *fixval, int k, int e)
+{
+    int i, l, m;
+    int64 a_k = 0;
+    PlutoSparseConstraints *nw;
+
+    nw = pluto_sparse_constraints_alloc(w->nrows, w->start[w->nrows], w->ncols);
+
+    if (k >= 0) a_k = pluto_sparse_constraints_get(w, e, k);
+
+    for (i=0; i<w->nrows; i++) {
+        if (!live[i]) continue;
+        pluto_sparse_constraints_add_constraint(nw, w->is_eq[i]);
+        for (l=w->start[i]; l<w->start[i+1]; l++) {
+            int c = w->col[l];
+            int64 v = w->val[l];
+            if (c < w->ncols-1 && state[c] == PRESOLVE_FIXED) {
+                pluto_sparse_constraints_add_coeff(nw, w->ncols-1, v*fixval[c]);
+            }else if (c == k) {
+                /* x_k = -a_k*(rest of row e) since a_k = +/-1 */
+                for (m=w->start[e]; m<w->start[e+1]; m++) {
+                    if (w->col[m] == k) continue;
+                    pluto_sparse_constraints_add_coeff(nw, w->col[m],
+                            -v*a_k*w->val[m]);
+                }
+            }else{
+                pluto_sparse_constraints_add_coeff(nw, c, v);
+            }
+        }
+    }
+
+    return nw;
+}
+
+
+/*
+ * Presolve for the lexmin over the non-negative integer points of sc (see
+ * pluto_sparse_constraints_lexmin). Removes
+ *  - fixed variables (by a single-variable equality, or bounds that
+ *    meet), substituting their values into the other rows,
+ *  - variables that have a unit coefficient in an equality in which they
+ *    are the last variable: x_k = f(x_1, ..., x_{k-1}) is substituted,
+ *    which keeps the lexicographic order of the solutions,
+ *  - rows with a single variable (they become bounds), inequalities implied
+ *    by the bounds, and duplicate or dominated rows.
+ * Bounds are tightened by propagating them through the inequalities. The
+ * bounds that remain are added as rows to the reduced system. Returns the
+ * reduced system and sets *info to what's needed to rebuild a solution of
+ * sc (pluto_presolve_postsolve); returns NULL if sc was found to be
+ * infeasible
+ */
+PlutoSparseConstraints *pluto_sparse_constraints_presolve(
+        const PlutoSparseConstraints *sc, PlutoPresolveInfo **info)
+{
+    int i, j, l, changed, infeasible;
+    PlutoSparseConstraints *w, *nw, *rsc;
+    PlutoPresolveInfo *pi;
+
+    int nvar = sc->ncols-1;
+    int64 lb[nvar], ub[nvar];
+    int has_ub[nvar], state[nvar];
+    /* Passes that tightened bounds (to stop on slow convergence) */
+    int num_tighten = 0;
+
+    pi = (PlutoPresolveInfo *) malloc(sizeof(PlutoPresolveInfo));
+    pi->ncols = sc->ncols;
+    pi->colmap = (int *) malloc(sc->ncols*sizeof(int));
+    pi->fixval = (int64 *) malloc(nvar*sizeof(int64));
+    pi->elim_col = (int *) malloc(nvar*sizeof(int));
+    pi->elim_eqs = pluto_sparse_constraints_alloc(8, 8*sc->ncols, sc->ncols);
+    pi->nelim = 0;
+
+    for (j=0; j<nvar; j++) {
+        lb[j] = 0;
+        ub[j] = 0;
+        has_ub[j] = 0;
+        state[j] = PRESOLVE_ACTIVE;
+    }
+
+    w = pluto_sparse_constraints_dup(sc);
+    w->nbase = 0;
+    infeasible = 0;
+
+    do {
+        int live[w->nrows+1];
+        int num_dead = 0, num_fixed = 0;
+
+        changed = 0;
+
+        for (i=0; i<w->nrows && !infeasible; i++) {
+            int64 c = 0, minact = 0, maxact = 0;
+            int nv = 0, min_inf = 0, max_inf = 0, last = -1;
+
+            live[i] = 1;
+            for (l=w->start[i]; l<w->start[i+1]; l++) {
+                int col = w->col[l];
+                int64 a = w->val[l];
+                if (col == w->ncols-1) {
+                    c = a;
+                    continue;
+                }
+                nv++;
+                last = l;
+                /* Contribution of a*x_col to the min and max of the row */
+                if (a > 0) {
+                    minact += a*lb[col];
+                    if (has_ub[col]) maxact += a*ub[col]; else max_inf++;
+                }else{
+                    maxact += a*lb[col];
+                    if (has_ub[col]) minact += a*ub[col]; else min_inf++;
+                }
+            }
+            minact += c;
+            maxact += c;
+
+            if (nv == 0) {
+                if (w->is_eq[i]? c != 0: c < 0) infeasible = 1;
+                live[i] = 0;
+            }else if (nv == 1) {
+                int col = w->col[last];
+                int64 a = w->val[last];
+                if (w->is_eq[i]) {
+                    if (c % a != 0) {
+                        infeasible = 1;
+                    }else{
+                        int64 v = -c/a;
+                        if (v > lb[col]) lb[col] = v;
+                        if (!has_ub[col] || v < ub[col]) ub[col] = v;
+                        has_ub[col] = 1;
+                    }
+                }else if (a > 0) {
+                    /* x >= ceil(-c/a) */
+                    int64 v = -presolve_floor_div(c, a);
+                    if (v > lb[col]) lb[col] = v;
+                }else{
+                    /* x <= floor(c/-a) */
+                    int64 v = presolve_floor_div(c, -a);
+                    if (!has_ub[col] || v < ub[col]) {
+                        ub[col] = v;
+                        has_ub[col] = 1;
+                    }
+                }
+                live[i] = 0;
+            }else if (!w->is_eq[i]) {
+                if (min_inf == 0 && minact >= 0) {
+                    /* Implied by the bounds */
+                    live[i] = 0;
+                }else if (max_inf == 0 && maxact < 0) {
+                    infeasible = 1;
+                }else if (max_inf == 0 && num_tighten < PRESOLVE_MAX_TIGHTEN) {
+                    /* Tighten: a_j x_j >= -(maxact - max contribution of a_j x_j) */
+                    for (l=w->start[i]; l<w->start[i+1]; l++) {
+                        int col = w->col[l];
+                        int64 a = w->val[l];
+                        if (col == w->ncols-1) continue;
+                        if (a > 0) {
+                            int64 rest = maxact - a*ub[col];
+                            int64 v = -presolve_floor_div(rest, a);
+                            if (v > lb[col]) {
+                                lb[col] = v;
+                                changed = 1;
+                            }
+                        }else{
+                            int64 rest = maxact - a*lb[col];
+                            int64 v = presolve_floor_div(rest, -a);
+                            if (!has_ub[col] || v < ub[col]) {
+                                ub[col] = v;
+                                has_ub[col] = 1;
+                                changed = 1;
+                            }
+                        }
+                    }
+                }
+            }else if ((min_inf == 0 && minact > 0) || (max_inf == 0 && maxact < 0)) {
+                infeasible = 1;
+            }
+            if (!live[i]) num_dead++;
+        }
+
+        for (j=0; j<nvar && !infeasible; j++) {
+            if (state[j] != PRESOLVE_ACTIVE || !has_ub[j]) continue;
+            if (lb[j] > ub[j]) {
+                infeasible = 1;
+            }else if (lb[j] == ub[j]) {
+                state[j] = PRESOLVE_FIXED;
+                pi->fixval[j] = lb[j];
+                num_fixed++;
+            }
+        }
+
+        if (infeasible) break;
+
+        if (num_dead >= 1 || num_fixed >= 1) {
+            nw = presolve_rebuild(w, live, state, pi->fixval, -1, -1);
+            pluto_sparse_constraints_free(w);
+            w = nw;
+            changed = 1;
+            continue;
+        }
+
+        if (changed) {
+            num_tighten++;
+            continue;
+        }
+
+        /* Substitute one variable using an equality */
+        for (i=0; i<w->nrows; i++) {
+            if (!w->is_eq[i]) continue;
+            l = w->start[i+1]-1;
+            if (l >= w->start[i] && w->col[l] == w->ncols-1) l--;
+            if (l < w->start[i] || PLABS(w->val[l]) != 1) continue;
+
+            int k = w->col[l];
+
+            /* x_k's bounds (non-negativity at least) become constraints on
+             * what it's replaced with */
+            pluto_sparse_constraints_add_lb(w, k, lb[k]);
+            if (has_ub[k]) pluto_sparse_constraints_add_ub(w, k, ub[k]);
+
+            pluto_sparse_constraints_add_row(pi->elim_eqs, w, i);
+            pi->elim_col[pi->nelim++] = k;
+            state[k] = PRESOLVE_ELIMINATED;
+
+            int live2[w->nrows+1];
+            for (j=0; j<w->nrows; j++) {
+                live2[j] = (j != i);
+            }
+            nw = presolve_rebuild(w, live2, state, pi->fixval, k, i);
+            pluto_sparse_constraints_free(w);
+            w = nw;
+            changed = 1;
+            break;
+        }
+    }while (changed);
+
+    if (infeasible) {
+        pluto_sparse_constraints_free(w);
+        pluto_presolve_info_free(pi);
+        *info = NULL;
+        return NULL;
+    }
+
+    /* Remaining bounds as rows (non-negativity is implied) */
+    for (j=0; j<nvar; j++) {
+        if (state[j] != PRESOLVE_ACTIVE) continue;
+        if (lb[j] > 0) pluto_sparse_constraints_add_lb(w, j, lb[j]);
+        if (has_ub[j]) pluto_sparse_constraints_add_ub(w, j, ub[j]);
+    }
+
+    pluto_sparse_constraints_simplify(w);
+
+    l = 0;
+    for (j=0; j<nvar; j++) {
+        pi->colmap[j] = (state[j] == PRESOLVE_ACTIVE)? l++: -1;
+    }
+    pi->colmap[nvar] = l;
+
+    rsc = pluto_sparse_constraints_gather_cols(w, pi->colmap, l+1);
+    pluto_sparse_constraints_free(w);
+
+    IF_DEBUG(printf("[pluto] presolve: %d variables, %d constraints -> %d variables (%d eliminated), %d constraints\n",
+                nvar, sc->nrows, l, pi->nelim, rsc->nrows););
+
+    *info = pi;
+    return rsc;
+}
+
+
+/* Solution of the original system from sol, a solution of the system
+ * reduced by pluto_sparse_constraints_presolve */
+int64 *pluto_presolve_postsolve(const int64 *sol, const PlutoPresolveInfo *info)
+{
+    int i, j, l;
+    int nvar = info->ncols-1;
+    int64 *fsol = (int64 *) malloc(nvar*sizeof(int64));
+
+    for (j=0; j<nvar; j++) {
+        if (info->colmap[j] >= 0) {
+            fsol[j] = sol[info->colmap[j]];
+        }else{
+            /* Eliminated variables are filled in below */
+            fsol[j] = info->fixval[j];
+        }
+    }
+
+    /* Later substitutions only involve variables of earlier rows */
+    for (i=info->nelim-1; i>=0; i--) {
+        const PlutoSparseConstraints *eqs = info->elim_eqs;
+        int k = info->elim_col[i];
+        int64 a_k = pluto_sparse_constraints_get(eqs, i, k);
+        int64 rest = 0;
+        for (l=eqs->start[i]; l<eqs->start[i+1]; l++) {
+            int c = eqs->col[l];
+            if (c == k) continue;
+            rest += eqs->val[l]*(c == nvar? 1: fsol[c]);
+        }
+        fsol[k] = -a_k*rest;
+    }
+
+    return fsol;
+}
+
+
+void pluto_presolve_info_free(PlutoPresolveInfo *info)
+{
+    if (info == NULL) return;
+
+    free(info->colmap);
+    free(info->fixval);
+    free(info->elim_col);
+    pluto_sparse_constraints_free(info->elim_eqs);
+    free(info);
+}
+
+
+/* Lexmin by the chosen solver (or the isl/PIP race with --portfolio);
+ * with isl, the sparse form is converted directly; PIP needs the dense
+ * matrix */
+static int64 *pluto_sparse_constraints_lexmin_solve(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss)
+{
+    int64 *sol;
+    PlutoConstraints *cst;
+
+    if (pluto_options->portfolio || pluto_options->islsolve) {
+        double t_start = pluto_profile_clock();
+        if (ss) ss->num_lexmin_calls++;
+        if (pluto_options->ilp_capture_dir) {
+            cst = pluto_sparse_constraints_to_constraints(sc);
+            pluto_constraints_capture(cst, "lexmin", negvar);
+            pluto_constraints_free(cst);
+        }
+        if (pluto_options->portfolio) {
+            sol = pluto_sparse_constraints_lexmin_portfolio(sc, negvar, ss);
+        }else{
+            sol = pluto_sparse_constraints_lexmin_isl(sc, negvar, ss);
+        }
+        pluto_profile_add_solver_call(PROF_LEXMIN, sc->nrows, sc->ncols,
+                pluto_profile_clock() - t_start);
+        return sol;
+    }
+
+    cst = pluto_sparse_constraints_to_constraints(sc);
+    sol = pluto_constraints_lexmin(cst, negvar, ss);
+    pluto_constraints_free(cst);
+
+    return sol;
+}
+
+
+/* Solve for the lexmin; 'ss' is the program's solver session (can be NULL).
+ * With --presolve, the system is first reduced (only for non-negative
+ * variables) */
+int64 *pluto_sparse_constraints_lexmin(const PlutoSparseConstraints *sc,
+        int negvar, PlutoSolverSession *ss)
+{
+    int64 *sol, *rsol;
+    PlutoPresolveInfo *info;
+    PlutoSparseConstraints *rsc;
+
+    if (!pluto_options->presolve || negvar != DO_NOT_ALLOW_NEGATIVE_COEFF) {
+        return pluto_sparse_constraints_lexmin_solve(sc, negvar, ss);
+    }
+
+    rsc = pluto_sparse_constraints_presolve(sc, &info);
+    if (rsc == NULL) return NULL;
+
+    if (rsc->ncols == 1) {
+        /* Everything was fixed or substituted */
+        sol = pluto_presolve_postsolve(NULL, info);
+    }else{
+        rsol = pluto_sparse_constraints_lexmin_solve(rsc, negvar, ss);
+        sol = rsol? pluto_presolve_postsolve(rsol, info): NULL;
+        free(rsol);
+    }
+
+    pluto_sparse_constraints_free(rsc);
+    pluto_presolve_info_free(info);
+
+    return sol;
+}
@@ -31,26 +31,20 @@
 Graph *graph_alloc(int nVertices)
 {
     Graph *g;
-    int i, j;
+    int i;
 
     g = (Graph *) malloc(sizeof(Graph));
 
     g->nVertices = nVertices;
+    g->nEdges = 0;
 
     g->vertices = (Vertex *) malloc(nVertices*sizeof(Vertex));
     for (i=0; i<nVertices; i++) {
         g->vertices[i].id = i;
-    }
-
-    g->adj = pluto_matrix_alloc(nVertices, nVertices);
-    g->adj->nrows = nVertices;
-    g->adj->ncols = nVertices;
-
-    for (i=0; i<nVertices; i++) {
-        g->vertices[i].vn = -1;
-        g->vertices[i].fn = -1;
-        for (j=0; j<nVertices; j++)
-            g->adj->val[i][j] = 0;
+        g->vertices[i].out = NULL;
+        g->vertices[i].nout = 0;
+        g->vertices[i].alloc_out = 0;
+        g->vertices[i].scc_id = -1;
     }
 
     g->sccs = (Scc *) malloc(nVertices*sizeof(Scc));
@@ -58,157 +52,265 @@ Graph *graph_alloc(int nVertices)
     /* Not computed yet */
     g->num_sccs = -1;
 
+    g->dep_edges = NULL;
+    g->ndeps = 0;
+
     return g;
 }
 
 
-/* Print the strongly-connected components */
-void graph_print_sccs(Graph *g)
+/* Position of the edge src -> dest in src's (sorted) edge list; if there is
+ * no such edge, the position where it would be inserted */
+static int graph_find_edge(const Graph *g, int src, int dest)
 {
-    int i;
+    int lo, hi, mid;
+    const Vertex *v = &g->vertices[src];
+
+    lo = 0;
+    hi = v->nout;
+    while (lo < hi) {
+        mid = (lo+hi)/2;
+        if (v->out[mid].dest < dest) lo = mid+1;
+        else hi = mid;
+    }
 
-    /* SCCs should have been computed */
-    assert(g->num_sccs != -1);
+    return lo;
+}
 
-    for (i=0; i<g->num_sccs; i++)  {
-        IF_DEBUG(printf("\tSCC %d: size: %d: max stmt dim: %d\n",
-                g->sccs[i].id, g->sccs[i].size, g->sccs[i].max_dim));
+
+/* Number of (parallel) edges from src to dest */
+int graph_get_num_edges(const Graph *g, int src, int dest)
+{
+    int e = graph_find_edge(g, src, dest);
+
+    if (e < g->vertices[src].nout && g->vertices[src].out[e].dest == dest) {
+        return g->vertices[src].out[e].count;
     }
+
+    return 0;
 }
 
 
-/* Return transpose of a graph G
- * G^T has an edge b/w u and v  iff G has an edge b/w v and u */
-Graph *graph_transpose(Graph *g)
+/* Add count parallel edges from src to dest */
+void graph_add_edges(Graph *g, int src, int dest, int count)
 {
-    int i, j;
-    Graph *gT;
+    int e;
+    Vertex *v = &g->vertices[src];
 
-    gT = graph_alloc(g->nVertices);
+    assert(src >= 0 && src < g->nVertices);
+    assert(dest >= 0 && dest < g->nVertices);
 
-    for (i=0; i<g->nVertices; i++)  {
-        for (j=0; j<g->nVertices; j++)  {
-            gT->adj->val[j][i] = g->adj->val[i][j];
-        }
+    if (count <= 0) return;
 
-        gT->vertices[i].fn = g->vertices[i].fn;
+    g->nEdges += count;
+
+    e = graph_find_edge(g, src, dest);
+    if (e < v->nout && v->out[e].dest == dest) {
+        v->out[e].count += count;
+        return;
     }
 
-    return gT;
+    if (v->nout == v->alloc_out) {
+        v->alloc_out = PLMAX(4, 2*v->alloc_out);
+        v->out = (Edge *) realloc(v->out, v->alloc_out*sizeof(Edge));
+    }
+    memmove(&v->out[e+1], &v->out[e], (v->nout-e)*sizeof(Edge));
+    v->out[e].dest = dest;
+    v->out[e].count = count;
+    v->nout++;
 }
 
 
-/* Depth first search from a given vertex */
-void dfs_vertex(Graph *g, Vertex *v, int *time)
+/* Remove count parallel edges from src to dest; the edge disappears from the
+ * list once none are left */
+void graph_remove_edges(Graph *g, int src, int dest, int count)
 {
-    int j;
+    int e;
+    Vertex *v = &g->vertices[src];
 
-    *time = *time + 1;
-    v->vn = *time;
+    if (count <= 0) return;
 
-    /* matrix_print(stdout, g->adj, g->nVertices, g->nVertices); */
+    e = graph_find_edge(g, src, dest);
+    assert(e < v->nout && v->out[e].dest == dest);
+    assert(v->out[e].count >= count);
 
-    for (j=0; j< g->nVertices; j++) {
-        if (g->adj->val[v->id][j])   {
-            // Vertex *w = ddg_get_vertex_by_id(g, j);
-            if (g->vertices[j].vn == 0) {
-                dfs_vertex(g, &g->vertices[j], time);
-            }
-        }
-    }
+    g->nEdges -= count;
 
-    *time = *time + 1;
-    v->fn = *time;
+    v->out[e].count -= count;
+    if (v->out[e].count == 0) {
+        memmove(&v->out[e], &v->out[e+1], (v->nout-e-1)*sizeof(Edge));
+        v->nout--;
+    }
 }
 
 
-/* Depth first search */
-void dfs(Graph *g)
+void graph_clear_edges(Graph *g)
 {
     int i;
-    int time = 0;
-    
-    for (i=0; i<g->nVertices; i++)  {
-        g->vertices[i].vn = 0;
+
+    for (i=0; i<g->nVertices; i++) {
+        g->vertices[i].nout = 0;
     }
-    
-    for (i=0; i<g->nVertices; i++)  {
-        if (g->vertices[i].vn == 0)  {
-            // printf("DFS vertex: %d\n", i);
-            dfs_vertex (g, &g->vertices[i], &time);
+    g->nEdges = 0;
+}
+
+
+void graph_print(FILE *fp, const Graph *g)
+{
+    int i, e;
+
+    for (i=0; i<g->nVertices; i++) {
+        fprintf(fp, "%d:", i);
+        for (e=0; e<g->vertices[i].nout; e++) {
+            fprintf(fp, " %d", g->vertices[i].out[e].dest);
+            if (g->vertices[i].out[e].count >= 2) {
+                fprintf(fp, "(x%d)", g->vertices[i].out[e].count);
+            }
         }
+        fprintf(fp, "\n");
     }
 }
 
 
-/* Comparison function for sorting graph vertices by their finish time */
-static int compar (const void *e1, const void *e2)
+/* Print the strongly-connected components */
+void graph_print_sccs(Graph *g)
 {
-    Vertex *v1, *v2;
+    int i;
 
-    v1 = (Vertex *) e1;
-    v2 = (Vertex *) e2;
+    /* SCCs should have been computed */
+    assert(g->num_sccs != -1);
 
-    if (v1->fn < v2->fn)    {
-        return -1;
-    }else if (v1->fn == v2->fn) {
-        return 0;
-    }else return 1;
+    for (i=0; i<g->num_sccs; i++)  {
+        IF_DEBUG(printf("\tSCC %d: size: %d: max stmt dim: %d\n",
+                g->sccs[i].id, g->sccs[i].size, g->sccs[i].max_dim));
+    }
 }
 
+
 /*
- * Depth first search in the descending order of finish
- * times of previous dfs - used to compute SCCs
- *
- * SCC related information is stored
+ * Compute the SCCs of a graph in a single depth first search (Tarjan's
+ * algorithm); scc_id of each vertex is set, and sccs[].id/size are filled in
  *
+ * The search is iterative so that large graphs don't exhaust the stack.
+ * Vertices and their edges are visited in increasing order of id; SCCs are
+ * numbered in topological order (no edges from SCC<i> to SCC<j> for i > j),
+ * and, among SCCs with no path between them, in the same order that the
+ * previous two-pass (Kosaraju) implementation produced
  **/
-void dfs_for_scc(Graph *g)
+void graph_compute_sccs(Graph *g)
 {
-    int i, j;
-    int time = 0;
-
-    Vertex *vCopy = (Vertex *) malloc(g->nVertices*sizeof(Vertex));
-    memcpy(vCopy, g->vertices, g->nVertices*sizeof(Vertex));
-    
-    for (i=0; i<g->nVertices; i++)  {
-        g->vertices[i].vn = 0;
-        g->vertices[i].scc_id = -1;
+    int i, v, w, sp, csp, index, numScc;
+
+    int n = g->nVertices;
+
+    /* DFS discovery number and lowest discovery number reachable */
+    int *num = (int *) malloc(n*sizeof(int));
+    int *low = (int *) malloc(n*sizeof(int));
+    bool *on_stack = (bool *) malloc(n*sizeof(bool));
+    /* Tarjan's vertex stack */
+    int *stack = (int *) malloc(n*sizeof(int));
+    /* DFS call stack: vertex, and the next of its edges to explore */
+    int *call = (int *) malloc(n*sizeof(int));
+    int *next_edge = (int *) malloc(n*sizeof(int));
+
+    for (i=0; i<n; i++) {
+        num[i] = -1;
+        on_stack[i] = false;
     }
 
-    /* Sort (in the ascending order) by finish number */
-    qsort(vCopy, g->nVertices, sizeof(Vertex), compar);
-
-    /* Reverse order of fn */
-    int numScc = 0;
-    for (i=g->nVertices-1; i>=0; i--)  {
-        if (g->vertices[vCopy[i].id].vn == 0)  {
-            g->sccs[numScc].id = numScc;
-            dfs_vertex(g, &g->vertices[vCopy[i].id], &time);
-
-            IF_MORE_DEBUG(printf("[pluto] dfs_for_scc: SCC %d: Stmt ids: ", numScc));
-            for (j=0; j<g->nVertices; j++) {
-                if (g->vertices[j].scc_id == -1 && g->vertices[j].vn > 0) {
-                    g->vertices[j].scc_id = numScc;
-                    IF_MORE_DEBUG(printf(" %d", g->vertices[j].id));
+    index = 0;
+    sp = 0;
+    numScc = 0;
+
+    for (i=0; i<n; i++) {
+        if (num[i] != -1) continue;
+
+        num[i] = low[i] = index++;
+        stack[sp++] = i;
+        on_stack[i] = true;
+        call[0] = i;
+        next_edge[0] = 0;
+        csp = 1;
+
+        while (csp > 0) {
+            v = call[csp-1];
+            if (next_edge[csp-1] < g->vertices[v].nout) {
+                w = g->vertices[v].out[next_edge[csp-1]++].dest;
+                if (num[w] == -1) {
+                    num[w] = low[w] = index++;
+                    stack[sp++] = w;
+                    on_stack[w] = true;
+                    call[csp] = w;
+                    next_edge[csp] = 0;
+                    csp++;
+                }else if (on_stack[w]) {
+                    low[v] = PLMIN(low[v], num[w]);
                 }
+                continue;
+            }
+
+            /* All of v's edges explored */
+            csp--;
+            if (csp > 0) {
+                low[call[csp-1]] = PLMIN(low[call[csp-1]], low[v]);
+            }
+
+            if (low[v] == num[v]) {
+                /* v is the root of an SCC */
+                g->sccs[numScc].size = 0;
+                do {
+                    w = stack[--sp];
+                    on_stack[w] = false;
+                    g->vertices[w].scc_id = numScc;
+                    g->sccs[numScc].size++;
+                }while (w != v);
+                numScc++;
             }
-            IF_MORE_DEBUG(printf("\n"));
-            numScc++;
         }
     }
-    IF_MORE_DEBUG(printf("\n\n"));
+
+    /* SCCs are completed in reverse topological order */
+    for (i=0; i<n; i++) {
+        g->vertices[i].scc_id = numScc - 1 - g->vertices[i].scc_id;
+    }
+    for (i=0; i<numScc/2; i++) {
+        int tmp = g->sccs[i].size;
+        g->sccs[i].size = g->sccs[numScc-1-i].size;
+        g->sccs[numScc-1-i].size = tmp;
+    }
+    for (i=0; i<numScc; i++) {
+        g->sccs[i].id = i;
+    }
+
+    IF_MORE_DEBUG(
+        for (i=0; i<numScc; i++) {
+            printf("[pluto] graph_compute_sccs: SCC %d: Stmt ids: ", i);
+            for (v=0; v<n; v++) {
+                if (g->vertices[v].scc_id == i) printf(" %d", v);
+            }
+            printf("\n");
+        }
+    );
 
     g->num_sccs = numScc;
 
-    free(vCopy);
+    free(num);
+    free(low);
+    free(on_stack);
+    free(stack);
+    free(call);
+    free(next_edge);
 }
 
 void graph_free(Graph *g)
 {
-    pluto_matrix_free(g->adj);
+    int i;
+
+    for (i=0; i<g->nVertices; i++) {
+        free(g->vertices[i].out);
+    }
     free(g->vertices);
     free(g->sccs);
+    free(g->dep_edges);
     free(g);
 }
-
@@ -1,14 +1,31 @@
 #ifndef _DDG_H_
 #define _DDG_H_
 
+#include <stdio.h>
+#include <stdbool.h>
+
 #include "math_support.h"
 
+/* Edge of a graph; parallel edges are stored once with their multiplicity */
+struct edge{
+    /* Destination vertex */
+    int dest;
+
+    /* Number of parallel edges (for the DDG, the number of unsatisfied
+     * dependences between the two statements) */
+    int count;
+};
+typedef struct edge Edge;
+
 /* Vertex of a graph */
 struct vertex{
     /* In PLUTO code, id here is same as Stmt ID */
     int id;
-    int vn;
-    int fn;
+
+    /* Outgoing edges, sorted by destination */
+    Edge *out;
+    int nout;
+    int alloc_out;
 
     /* Id of the SCC this vertex belongs to */
     int scc_id;
@@ -36,21 +53,28 @@ struct graph{
     Vertex *vertices;
     int nVertices;
 
-    /* Adjacency matrix */
-    PlutoMatrix *adj;
+    /* Total number of edges (counting multiplicities) */
+    int nEdges;
 
     Scc *sccs;
     int num_sccs;
+
+    /* For the DDG: whether dependence i currently contributes an edge;
+     * lets ddg_update only touch the edges that changed */
+    bool *dep_edges;
+    int ndeps;
 };
 typedef struct graph Graph;
 
 Graph *graph_alloc (int nVertices);
 void graph_free(Graph *g);
+void graph_print(FILE *fp, const Graph *g);
 void graph_print_sccs (Graph *g);
-void dfs_for_scc (Graph *g);
-Graph *graph_transpose (Graph *g);
-void dfs (Graph *g);
-void dfs_for_scc (Graph *g);
+void graph_add_edges(Graph *g, int src, int dest, int count);
+void graph_remove_edges(Graph *g, int src, int dest, int count);
+void graph_clear_edges(Graph *g);
+int graph_get_num_edges(const Graph *g, int src, int dest);
+void graph_compute_sccs(Graph *g);
 Vertex *ddg_get_vertex_by_id(Graph *g, int id);
 
 #endif
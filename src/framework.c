@@ -29,6 +29,7 @@
 #include "constraints.h"
 #include "pluto.h"
 #include "program.h"
+#include "profile.h"
 
 #include <isl/constraint.h>
 #include <isl/mat.h>
@@ -40,6 +41,7 @@
 
 static int pluto_dep_satisfies_instance(const Dep *dep, const PlutoProg *prog, int level);
 static int pluto_dep_remove_satisfied_instances(Dep *dep, PlutoProg *prog, int level);
+static int dep_dir_cache_entry(Dep *dep, const PlutoProg *prog, int level);
 
 
 /**
@@ -53,23 +55,21 @@ static int pluto_dep_remove_satisfied_instances(Dep *dep, PlutoProg *prog, int l
  * nvar - number of parameters in whole program
  */
 
-/* Builds validity and bounding function constraints for a dependence */
-static void compute_permutability_constraints_dep(Dep *dep, PlutoProg *prog)
+/*
+ * Apply Farkas lemma on the dependence polyhedron to obtain the tiling
+ * validity constraints and bounding function constraints in local format:
+ *      validity: [src stmt coeff.s | dest stmt coeff.s (if different) | const]
+ *      bounding: [u | w | src stmt coeff.s | dest stmt coeff.s | const]
+ */
+static void farkas_dep_constraints(Dep *dep, PlutoProg *prog,
+        PlutoConstraints **tiling_valid_cst, PlutoConstraints **bounding_func_cst,
+        PlutoSolverSession *ss)
 {
-    PlutoConstraints *cst, *tiling_valid_cst, *bounding_func_cst;
-    int nstmts, nvar, npar, src_stmt, dest_stmt, j, k, r;
-    int src_offset, dest_offset;
+    int nvar, npar, src_stmt, dest_stmt, r;
     PlutoMatrix *phi;
-    Stmt **stmts;
 
     nvar = prog->nvar;
     npar = prog->npar;
-    stmts = prog->stmts;
-    nstmts = prog->nstmts;
-
-    /* IMPORTANT: It's assumed that all statements are of dimensionality nvar */
-
-    IF_DEBUG(printf("[pluto] compute permutability constraints: Dep %d\n", dep->id+1););
 
     dest_stmt = dep->dest;
     src_stmt = dep->src;
@@ -112,7 +112,8 @@ static void compute_permutability_constraints_dep(Dep *dep, PlutoProg *prog)
     }
 
     /* Apply Farkas lemma for tiling validity constraints */
-    tiling_valid_cst = farkas_lemma_affine(dpoly, phi);
+    *tiling_valid_cst = farkas_lemma_affine_cached(dpoly, phi, prog->farkas_cache,
+            ss);
     
     pluto_matrix_free(phi);
 
@@ -162,93 +163,206 @@ static void compute_permutability_constraints_dep(Dep *dep, PlutoProg *prog)
     }
 
     /* Apply Farkas lemma for bounding function constraints */
-    bounding_func_cst = farkas_lemma_affine(dep->bounding_poly, phi);
+    *bounding_func_cst = farkas_lemma_affine_cached(dep->bounding_poly, phi,
+            prog->farkas_cache, ss);
 
     pluto_matrix_free(phi);
     pluto_constraints_free(dpoly);
+}
+
+
+/*
+ * Closed-form counterpart of farkas_dep_constraints for a uniform self
+ * dependence with distance vector d = dep->distvec. Validity is just
+ * c.d >= 0 (the translation coefficient cancels out). Bounding requires
+ * u.p + w - c.d >= 0 for all valid parameter values: Farkas is applied on
+ * the parameter-only constraints of the bounding polyhedron (parameters
+ * being non-negative) treating w - c.d as the constant, and the result
+ * expanded back in terms of w and c.
+ */
+static void uniform_dep_constraints(Dep *dep, PlutoProg *prog,
+        PlutoConstraints **tiling_valid_cst, PlutoConstraints **bounding_func_cst,
+        PlutoSolverSession *ss)
+{
+    int nvar, npar, i, j, k;
+    PlutoConstraints *pcst, *fcst, *bcst, *vcst;
+    PlutoMatrix *phi;
+
+    nvar = prog->nvar;
+    npar = prog->npar;
+
+    assert(dep->src == dep->dest);
+    assert(dep->bounding_poly->ncols == 2*nvar+npar+1);
+
+    /* Validity: [c_1, c_2, .., c_nvar, c_0 | const] */
+    vcst = pluto_constraints_alloc(1, nvar+2);
+    pluto_constraints_add_inequality(vcst);
+    for (j=0; j<nvar; j++) {
+        vcst->val[0][j] = dep->distvec[j];
+    }
+
+    /* Parameter space: constraints of bounding_poly on parameters alone,
+     * and p >= 0 */
+    pcst = pluto_constraints_alloc(dep->bounding_poly->nrows+npar, npar+1);
+    for (i=0; i<dep->bounding_poly->nrows; i++) {
+        for (j=0; j<2*nvar; j++) {
+            if (dep->bounding_poly->val[i][j] != 0) break;
+        }
+        if (j < 2*nvar) continue;
+        pluto_constraints_add_constraint(pcst, dep->bounding_poly->is_eq[i]);
+        for (j=0; j<npar+1; j++) {
+            pcst->val[pcst->nrows-1][j] = dep->bounding_poly->val[i][2*nvar+j];
+        }
+    }
+    for (j=0; j<npar; j++) {
+        pluto_constraints_add_lb(pcst, j, 0);
+    }
+
+    /* u.p + K; format: [u_1, .., u_npar, K | const] */
+    phi = pluto_matrix_alloc(npar+1, npar+2);
+    pluto_matrix_set(phi, 0);
+    for (j=0; j<npar+1; j++) {
+        phi->val[j][j] = 1;
+    }
+
+    fcst = farkas_lemma_affine_cached(pcst, phi, prog->farkas_cache, ss);
+
+    /* Substitute K = w - c.d; format as with Farkas for self dependences:
+     * [u_1, .., u_npar, w | c_1, .., c_nvar, c_0 | const] */
+    bcst = pluto_constraints_alloc(fcst->nrows, npar+1+nvar+1+1);
+    for (k=0; k<fcst->nrows; k++) {
+        pluto_constraints_add_constraint(bcst, fcst->is_eq[k]);
+        for (j=0; j<npar+1; j++) {
+            bcst->val[k][j] = fcst->val[k][j];
+        }
+        for (j=0; j<nvar; j++) {
+            bcst->val[k][npar+1+j] = -dep->distvec[j]*fcst->val[k][npar];
+        }
+        bcst->val[k][bcst->ncols-1] = fcst->val[k][npar+1];
+    }
+
+    pluto_matrix_free(phi);
+    pluto_constraints_free(pcst);
+    pluto_constraints_free(fcst);
+
+    *tiling_valid_cst = vcst;
+    *bounding_func_cst = bcst;
+}
+
+
+/* Builds validity and bounding function constraints for a dependence; 'ss'
+ * is the solver session of the calling thread */
+static void compute_permutability_constraints_dep(Dep *dep, PlutoProg *prog,
+        PlutoSolverSession *ss)
+{
+    PlutoConstraints *tiling_valid_cst, *bounding_func_cst;
+    PlutoSparseConstraints *cst;
+    int nstmts, nvar, npar, src_stmt, dest_stmt, j, k;
+    int src_offset, dest_offset;
+    Stmt **stmts;
+
+    nvar = prog->nvar;
+    npar = prog->npar;
+    stmts = prog->stmts;
+    nstmts = prog->nstmts;
+
+    /* IMPORTANT: It's assumed that all statements are of dimensionality nvar */
+
+    IF_DEBUG(printf("[pluto] compute permutability constraints: Dep %d\n", dep->id+1););
+
+    dest_stmt = dep->dest;
+    src_stmt = dep->src;
+
+    if (dep->distvec != NULL)   {
+        /* Uniform dependence: no Farkas elimination needed */
+        uniform_dep_constraints(dep, prog, &tiling_valid_cst, &bounding_func_cst,
+                ss);
+    }else{
+        farkas_dep_constraints(dep, prog, &tiling_valid_cst, &bounding_func_cst,
+                ss);
+    }
 
     /* Aggregate permutability and bounding function constraints together in
      * global format; note that tiling_valid_cst and bounding_func_cst are 
-     * local to a  dependence/statements pertaining to it) */
-
-    /* Everything initialized to zero during allocation */
-    cst = pluto_constraints_alloc(tiling_valid_cst->nrows + bounding_func_cst->nrows, CST_WIDTH);
-    cst->nrows = 0;
-    cst->ncols = CST_WIDTH;
+     * local to a  dependence/statements pertaining to it). Rows are stored
+     * sparse: only the columns of the statements involved are non-zero */
+    cst = pluto_sparse_constraints_alloc(
+            tiling_valid_cst->nrows + bounding_func_cst->nrows,
+            (tiling_valid_cst->nrows + bounding_func_cst->nrows)*(npar+1+2*(nvar+1)+1),
+            CST_WIDTH);
 
     src_offset = npar+1+src_stmt*(nvar+1);
     dest_offset = npar+1+dest_stmt*(nvar+1);
 
+    /* Coefficients of those dimensions that were added for padding
+     * are of no utility, and are left out (zero) */
+
     /* Permutability constraints */
     if (!IS_RAR(dep->type)) {
         /* Permutability constraints only for non-RAR deps */
         for (k=0; k<tiling_valid_cst->nrows; k++) {
-            pluto_constraints_add_constraint(cst, tiling_valid_cst->is_eq[k]);
+            pluto_sparse_constraints_add_constraint(cst, tiling_valid_cst->is_eq[k]);
             for (j=0; j<nvar+1; j++)  {
-                cst->val[cst->nrows-1][src_offset+j] = tiling_valid_cst->val[k][j];
-                if (src_stmt != dest_stmt) {
-                    cst->val[cst->nrows-1][dest_offset+j] = tiling_valid_cst->val[k][nvar+1+j];
+                if (j == nvar || stmts[src_stmt]->is_orig_loop[j]) {
+                    pluto_sparse_constraints_add_coeff(cst, src_offset+j,
+                            tiling_valid_cst->val[k][j]);
+                }
+                if (src_stmt != dest_stmt && (j == nvar || stmts[dest_stmt]->is_orig_loop[j])) {
+                    pluto_sparse_constraints_add_coeff(cst, dest_offset+j,
+                            tiling_valid_cst->val[k][nvar+1+j]);
                 }
             }
             /* constant part */
             if (src_stmt == dest_stmt) {
-                cst->val[cst->nrows-1][cst->ncols-1] = tiling_valid_cst->val[k][nvar+1];
+                pluto_sparse_constraints_add_coeff(cst, CST_WIDTH-1,
+                        tiling_valid_cst->val[k][nvar+1]);
             }else{
-                cst->val[cst->nrows-1][cst->ncols-1] = tiling_valid_cst->val[k][2*nvar+2];
+                pluto_sparse_constraints_add_coeff(cst, CST_WIDTH-1,
+                        tiling_valid_cst->val[k][2*nvar+2]);
             }
         }
     }
 
     /* Add bounding function constraints */
-    if (!options->nodepbound)   {
+    if (!pluto_options->nodepbound)   {
         /* Bounding function constraints in global format */
-        PlutoConstraints *bcst_g;
-
-        src_offset = npar+1+src_stmt*(nvar+1);
-        dest_offset = npar+1+dest_stmt*(nvar+1);
+        PlutoSparseConstraints *bcst_g;
 
-        bcst_g = pluto_constraints_alloc(bounding_func_cst->nrows, CST_WIDTH);
+        bcst_g = pluto_sparse_constraints_alloc(bounding_func_cst->nrows,
+                bounding_func_cst->nrows*(npar+1+2*(nvar+1)+1), CST_WIDTH);
 
         for (k=0; k<bounding_func_cst->nrows; k++)   {
-            pluto_constraints_add_constraint(bcst_g, bounding_func_cst->is_eq[k]);
+            pluto_sparse_constraints_add_constraint(bcst_g, bounding_func_cst->is_eq[k]);
             for (j=0; j<npar+1; j++)  {
-                bcst_g->val[bcst_g->nrows-1][j] = bounding_func_cst->val[k][j];
+                pluto_sparse_constraints_add_coeff(bcst_g, j,
+                        bounding_func_cst->val[k][j]);
             }
             for (j=0; j<nvar+1; j++)  {
-                bcst_g->val[bcst_g->nrows-1][src_offset+j] = bounding_func_cst->val[k][npar+1+j];
-                if (src_stmt != dest_stmt) {
-                    bcst_g->val[bcst_g->nrows-1][dest_offset+j] = bounding_func_cst->val[k][npar+1+nvar+1+j];
+                if (j == nvar || stmts[src_stmt]->is_orig_loop[j]) {
+                    pluto_sparse_constraints_add_coeff(bcst_g, src_offset+j,
+                            bounding_func_cst->val[k][npar+1+j]);
+                }
+                if (src_stmt != dest_stmt && (j == nvar || stmts[dest_stmt]->is_orig_loop[j])) {
+                    pluto_sparse_constraints_add_coeff(bcst_g, dest_offset+j,
+                            bounding_func_cst->val[k][npar+1+nvar+1+j]);
                 }
             }
             /* constant part */
             if (src_stmt == dest_stmt) {
-                bcst_g->val[bcst_g->nrows-1][bcst_g->ncols-1] = bounding_func_cst->val[k][npar+1+nvar+1];
+                pluto_sparse_constraints_add_coeff(bcst_g, CST_WIDTH-1,
+                        bounding_func_cst->val[k][npar+1+nvar+1]);
             }else{
-                bcst_g->val[bcst_g->nrows-1][bcst_g->ncols-1] = bounding_func_cst->val[k][npar+1+2*nvar+2];
+                pluto_sparse_constraints_add_coeff(bcst_g, CST_WIDTH-1,
+                        bounding_func_cst->val[k][npar+1+2*nvar+2]);
             }
         }
-        pluto_constraints_add(cst, bcst_g);
+        pluto_sparse_constraints_add(cst, bcst_g);
 
-        pluto_constraints_free(dep->bounding_cst);
+        pluto_sparse_constraints_free(dep->bounding_cst);
         dep->bounding_cst = bcst_g;
     }
 
-    /* Coefficients of those dimensions that were added for padding
-     * are of no utility */
-    for (k=0; k<nvar; k++)    {
-        if (!stmts[src_stmt]->is_orig_loop[k]) {
-            for (j=0; j < cst->nrows; j++)   {
-                cst->val[j][src_offset+k] = 0;
-            }
-        }
-        if (src_stmt != dest_offset && !stmts[dest_stmt]->is_orig_loop[k])  {
-            for (j=0; j < cst->nrows; j++)   {
-                cst->val[j][dest_offset+k] = 0;
-            }
-        }
-    }
-
-    pluto_constraints_free(dep->cst);
+    pluto_sparse_constraints_free(dep->cst);
     dep->cst = cst;
 
     pluto_constraints_free(tiling_valid_cst);
@@ -256,11 +370,12 @@ static void compute_permutability_constraints_dep(Dep *dep, PlutoProg *prog)
 }
 
 
-/* This function itself is NOT thread-safe for the same PlutoProg */
-PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
+/* This function itself is NOT thread-safe for the same PlutoProg
+ * (it may use threads internally: see options->nthreads) */
+PlutoSparseConstraints *get_permutability_constraints(PlutoProg *prog)
 {
-    int i, inc, nstmts, nvar, npar, ndeps, total_cst_rows;
-    PlutoConstraints *globcst;
+    int i, inc, nstmts, nvar, npar, ndeps, total_cst_rows, total_cst_nnz;
+    PlutoSparseConstraints *globcst;
     Dep **deps;
 
     nstmts = prog->nstmts;
@@ -284,31 +399,62 @@ PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
     }
 
     total_cst_rows = 0;
+    total_cst_nnz = 0;
 
-    /* Compute the constraints and store them in dep->cst */
-    for (i=0; i<ndeps; i++) {
-        Dep *dep = deps[i];
+    double t_start = pluto_profile_clock();
 
-        if (skipdeps[i]) continue;
+    PlutoOptions *caller_options = pluto_options;
 
-        if (options->rar == 0 && IS_RAR(dep->type)) {
-            continue;
-        }
+    /* Compute the constraints and store them in dep->cst; constraints for a
+     * dependence are computed independently of the others (and only written
+     * to the dependence), so this is spread over options->nthreads. The
+     * merge into globcst below is in dependence order, i.e., the result
+     * doesn't depend on the number of threads. An isl context can't be
+     * shared between threads: each thread has a solver session of its own,
+     * whose Fourier-Motzkin statistics are added to the program's */
+#pragma omp parallel num_threads(pluto_options->nthreads) \
+    reduction(+:total_cst_rows,total_cst_nnz) if(pluto_options->nthreads > 1)
+    {
+        /* options is thread-local */
+        pluto_options = caller_options;
+
+        PlutoSolverSession *ss = (pluto_options->nthreads > 1)?
+            pluto_solver_session_alloc(): prog->solver;
+
+#pragma omp for schedule(dynamic)
+        for (i=0; i<ndeps; i++) {
+            Dep *dep = deps[i];
+
+            if (skipdeps[i]) continue;
 
-        if (dep->cst == NULL) {
-            /* First time, compute the constraints */
-            compute_permutability_constraints_dep(dep, prog);
+            if (pluto_options->rar == 0 && IS_RAR(dep->type)) {
+                continue;
+            }
+
+            if (dep->cst == NULL) {
+                /* First time, compute the constraints */
+                compute_permutability_constraints_dep(dep, prog, ss);
+
+                IF_DEBUG(fprintf(stdout, "\tFor dep %d; num_constraints: %d\n",
+                            i+1, dep->cst->nrows));
+                total_cst_rows += dep->cst->nrows;
+                total_cst_nnz += pluto_sparse_constraints_get_nnz(dep->cst);
+                // IF_MORE_DEBUG(fprintf(stdout, "Constraints for dep %d\n", i+1));
+                // IF_MORE_DEBUG(pluto_constraints_pretty_print(stdout, dep->cst));
+            }
+        }
 
-            IF_DEBUG(fprintf(stdout, "\tFor dep %d; num_constraints: %d\n",
-                        i+1, dep->cst->nrows));
-            total_cst_rows += dep->cst->nrows;
-            // IF_MORE_DEBUG(fprintf(stdout, "Constraints for dep %d\n", i+1));
-            // IF_MORE_DEBUG(pluto_constraints_pretty_print(stdout, dep->cst));
+        if (ss != prog->solver) {
+#pragma omp critical (fm_stats)
+            pluto_fm_stats_add(&prog->solver->fm_stats, &ss->fm_stats);
+            pluto_solver_session_free(ss);
         }
     }
+    pluto_profile_add_phase("farkas", pluto_profile_clock() - t_start);
 
     if (!prog->globcst) {
-        prog->globcst = pluto_constraints_alloc(total_cst_rows, CST_WIDTH);
+        prog->globcst = pluto_sparse_constraints_alloc(total_cst_rows,
+                total_cst_nnz, CST_WIDTH);
     }
 
     globcst = prog->globcst;
@@ -324,7 +470,7 @@ PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
 
 		/* print_polylib_visual_sets("BB_cst", dep->bounding_cst); */
 
-        if (options->rar == 0 && IS_RAR(dep->type)) continue;
+        if (pluto_options->rar == 0 && IS_RAR(dep->type)) continue;
 
         /* Note that dependences would be marked satisfied (in
          * pluto_auto_transform) only after all possible independent solutions
@@ -335,7 +481,7 @@ PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
         }
 
         /* Subsequent calls can just use the old ones */
-        pluto_constraints_add(globcst, dep->cst);
+        pluto_sparse_constraints_add(globcst, dep->cst);
         /* print_polylib_visual_sets("global", dep->cst); */
 
         IF_DEBUG(fprintf(stdout, "\tAfter dep %d; num_constraints: %d\n", i+1,
@@ -350,7 +496,7 @@ PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
         if (globcst->nrows >= CONSTRAINTS_SIMPLIFY_THRESHOLD + (3000*inc) &&
                 globcst->nrows - dep->cst->nrows < 
                 CONSTRAINTS_SIMPLIFY_THRESHOLD + (3000*inc)) {
-            pluto_constraints_simplify(globcst);
+            pluto_sparse_constraints_simplify(globcst);
             inc++;
             IF_DEBUG(fprintf(stdout,
                         "\tAfter dep %d; num_constraints_simplified: %d\n", i+1,
@@ -358,13 +504,14 @@ PlutoConstraints *get_permutability_constraints(PlutoProg *prog)
         }
     }
 
-    pluto_constraints_simplify(globcst);
+    pluto_sparse_constraints_simplify(globcst);
 
     free(skipdeps);
     if (skipfp) fclose(skipfp);
 
-    IF_DEBUG(fprintf(stdout, "\tAfter all dependences: num constraints: %d, num variables: %d\n",
-                globcst->nrows, globcst->ncols - 1));
+    IF_DEBUG(fprintf(stdout, "\tAfter all dependences: num constraints: %d, num variables: %d, num non-zeros: %d\n",
+                globcst->nrows, globcst->ncols - 1,
+                pluto_sparse_constraints_get_nnz(globcst)));
     // IF_DEBUG2(pluto_constraints_pretty_print(stdout, globcst));
 
     return globcst;
@@ -434,7 +581,8 @@ PlutoConstraints *get_feautrier_schedule_constraints_dep(Dep *dep, PlutoProg *pr
     }
 
     /* Apply Farkas lemma */
-    sched_valid_cst = farkas_lemma_affine(dpoly, phi);
+    sched_valid_cst = farkas_lemma_affine_cached(dpoly, phi, prog->farkas_cache,
+            prog->solver);
     // pluto_constraints_pretty_print(stdout, sched_valid_cst);
     
     pluto_matrix_free(phi);
@@ -512,7 +660,7 @@ PlutoConstraints *get_feautrier_schedule_constraints(PlutoProg *prog, Stmt **stm
     for (i=0, inc = 0; i<ndeps; i++) {
         Dep *dep = deps[i];
 
-        if (options->rar == 0 && IS_RAR(dep->type)) {
+        if (pluto_options->rar == 0 && IS_RAR(dep->type)) {
             continue;
         }
 
@@ -579,11 +727,11 @@ PlutoConstraints *get_feautrier_schedule_constraints(PlutoProg *prog, Stmt **stm
  * If the null space is 0-dimensional, *orthonum will be zero and the return
  * value is NULL
  */
-PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
-        const PlutoConstraints *currcst, int *orthonum)
+PlutoSparseConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
+        const PlutoSparseConstraints *currcst, int *orthonum)
 {
     int i, j, k, p, q, nvar, npar, nstmts;
-    PlutoConstraints **orthcst;
+    PlutoSparseConstraints **orthcst;
     HyperplaneProperties *hProps;
     isl_ctx *ctx;
     isl_mat *h;
@@ -621,8 +769,7 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
         }
     }
 
-    ctx = isl_ctx_alloc();
-    assert(ctx);
+    ctx = prog->solver->ctx;
 
     h = isl_mat_alloc(ctx, q, p);
 
@@ -648,11 +795,10 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
 
     isl_mat_free(h);
 
-    orthcst = (PlutoConstraints **) malloc((nvar+1)*sizeof(PlutoConstraints *)); 
+    orthcst = (PlutoSparseConstraints **) malloc((nvar+1)*sizeof(PlutoSparseConstraints *)); 
 
     for (i=0; i<nvar+1; i++)  {
-        orthcst[i] = pluto_constraints_alloc(1, CST_WIDTH);
-        orthcst[i]->ncols = CST_WIDTH;
+        orthcst[i] = pluto_sparse_constraints_alloc(1, nvar+2, CST_WIDTH);
     }
 
     /* All non-negative orthant only */
@@ -684,35 +830,47 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
 
     /* Fast linear independence check */
     if (options->flic)  isl_currcst = NULL;
-    else isl_currcst = isl_basic_set_from_pluto_constraints(ctx, currcst);
+    else isl_currcst = isl_basic_set_from_pluto_sparse_constraints(ctx, currcst);
 
     assert(p == ortho->nrows);
     p=0;
     for (i=0; i<ortho->ncols; i++) {
         isl_basic_set *orthcst_i;
+        int negate;
 
-        j=0;
-        for (q=0; q<nvar; q++) {
-            if (stmt->is_orig_loop[q])    {
-                orthcst[p]->val[0][npar+1+(stmt->id)*(nvar+1)+q] = ortho->val[j][i];
-                j++;
-            }
-        }
-        orthcst[p]->nrows = 1;
-        orthcst[p]->val[0][CST_WIDTH-1] = -1;
-        if (!options->flic) {
-            orthcst_i = isl_basic_set_from_pluto_constraints(ctx, orthcst[p]);
-        }
-        orthcst[p]->val[0][CST_WIDTH-1] = 0;
-
+        /* Is the constraint (>= 1) along this direction infeasible? */
+        negate = 0;
         if (!options->flic) {
+            pluto_sparse_constraints_add_constraint(orthcst[p], 0);
+            j=0;
+            for (q=0; q<nvar; q++) {
+                if (stmt->is_orig_loop[q])    {
+                    pluto_sparse_constraints_add_coeff(orthcst[p],
+                            npar+1+(stmt->id)*(nvar+1)+q, ortho->val[j][i]);
+                    j++;
+                }
+            }
+            pluto_sparse_constraints_add_coeff(orthcst[p], CST_WIDTH-1, -1);
+            orthcst_i = isl_basic_set_from_pluto_sparse_constraints(ctx, orthcst[p]);
             orthcst_i = isl_basic_set_intersect(orthcst_i,
                     isl_basic_set_copy(isl_currcst));
             if (isl_basic_set_fast_is_empty(orthcst_i)
                     || isl_basic_set_is_empty(orthcst_i)) {
-                pluto_constraints_negate_row(orthcst[p], 0);
+                negate = 1;
             }
             isl_basic_set_free(orthcst_i);
+            orthcst[p]->nrows = 0;
+        }
+
+        pluto_sparse_constraints_add_constraint(orthcst[p], 0);
+        j=0;
+        for (q=0; q<nvar; q++) {
+            if (stmt->is_orig_loop[q])    {
+                pluto_sparse_constraints_add_coeff(orthcst[p],
+                        npar+1+(stmt->id)*(nvar+1)+q,
+                        negate? -ortho->val[j][i]: ortho->val[j][i]);
+                j++;
+            }
         }
         p++;
         /* assert(p<=nvar-1); */
@@ -720,13 +878,14 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
 
     if (p >= 1)  {
         /* Sum of all of the above is the last constraint */
-        for(j=0; j<CST_WIDTH; j++)  {
-            for (i=0; i<p; i++) {
-                orthcst[p]->val[0][j] += orthcst[i]->val[0][j];
+        pluto_sparse_constraints_add_constraint(orthcst[p], 0);
+        for (i=0; i<p; i++) {
+            for (k=orthcst[i]->start[0]; k<orthcst[i]->start[1]; k++) {
+                pluto_sparse_constraints_add_coeff(orthcst[p],
+                        orthcst[i]->col[k], orthcst[i]->val[k]);
             }
         }
-        orthcst[p]->nrows = 1;
-        orthcst[p]->val[0][CST_WIDTH-1] = -1;
+        pluto_sparse_constraints_add_coeff(orthcst[p], CST_WIDTH-1, -1);
         p++;
     }
 
@@ -736,17 +895,20 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
                 stmt->id+1, *orthonum-1));
     for (i=0; i<*orthonum; i++) {
         // print_polylib_visual_sets("li", orthcst[i]);
-        IF_DEBUG2(pluto_constraints_compact_print(stdout, orthcst[i]));
+        IF_DEBUG2({
+            PlutoConstraints *dcst = pluto_sparse_constraints_to_constraints(orthcst[i]);
+            pluto_constraints_compact_print(stdout, dcst);
+            pluto_constraints_free(dcst);
+        });
     }
 
     /* Free the unnecessary ones */
     for (i=p; i<nvar+1; i++)    {
-        pluto_constraints_free(orthcst[i]);
+        pluto_sparse_constraints_free(orthcst[i]);
     }
 
     pluto_matrix_free(ortho);
     isl_basic_set_free(isl_currcst);
-    isl_ctx_free(ctx);
 
     return orthcst;
 }
@@ -756,11 +918,16 @@ PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
  * Check whether the dependence is satisfied at level 'level'
  * (works whether the dep is const or non-const, inter-stmt or
  * self edge
+ *
+ * The result is cached on the dependence along with its direction (see
+ * get_dep_direction): recomputing satisfaction after a transformation
+ * only queries the solver for the (dep, level) pairs whose hyperplanes
+ * actually changed
  */
 bool dep_satisfaction_test(Dep *dep, PlutoProg *prog, int level)
 {
     PlutoConstraints *cst;
-    int j, src_dim, dest_dim, npar;
+    int j, e, src_dim, dest_dim, npar;
     bool is_empty;
 
     npar = prog->npar;
@@ -776,6 +943,11 @@ bool dep_satisfaction_test(Dep *dep, PlutoProg *prog, int level)
     assert(level < src_stmt->trans->nrows);
     assert(level < dest_stmt->trans->nrows);
 
+    e = dep_dir_cache_entry(dep, prog, level);
+    if (dep->dircache->sat[e] != -1) {
+        return dep->dircache->sat[e];
+    }
+
     cst = pluto_constraints_alloc(2*(1+dep->dpolytope->nrows), 
             src_dim+dest_dim+npar+1);
 
@@ -803,9 +975,11 @@ bool dep_satisfaction_test(Dep *dep, PlutoProg *prog, int level)
 
     /* if no solution exists, the dependence is satisfied, i.e., no points
      * satisfy \phi(src) - \phi(dest) <= 0 */
-    is_empty = pluto_constraints_is_empty(cst);
+    is_empty = pluto_constraints_is_empty(cst, prog->solver);
     pluto_constraints_free(cst);
 
+    dep->dircache->sat[e] = is_empty;
+
     return is_empty;
 }
 
@@ -861,9 +1035,9 @@ static int pluto_dep_remove_satisfied_instances(Dep *dep, PlutoProg *prog, int l
 
     cst->nrows = 1;
 
-    pluto_constraints_intersect_isl(dep->depsat_poly, cst);
+    pluto_constraints_intersect_isl(dep->depsat_poly, cst, prog->solver);
 
-    retval = !pluto_constraints_is_empty(cst);
+    retval = !pluto_constraints_is_empty(cst, prog->solver);
 
     pluto_constraints_free(cst);
 
@@ -912,7 +1086,7 @@ int pluto_compute_dep_satisfaction_precise(PlutoProg *prog)
             if (dep->satvec[level]) {
                 dep->satisfaction_level = PLMAX(dep->satisfaction_level, level);
             }
-            if (pluto_constraints_is_empty(dep->depsat_poly)) {
+            if (pluto_constraints_is_empty(dep->depsat_poly, prog->solver)) {
                 dep->satisfied = true;
                 IF_MORE_DEBUG(printf("\tdep %d satisfied\n", dep->id+1););
                 if (!IS_RAR(dep->type)) num_satisfied++;
@@ -977,10 +1151,10 @@ static int pluto_dep_satisfies_instance(const Dep *dep, const PlutoProg *prog, i
 
     cst->nrows = 1;
 
-    pluto_constraints_intersect_isl(cst, dep->depsat_poly);
+    pluto_constraints_intersect_isl(cst, dep->depsat_poly, prog->solver);
     // pluto_constraints_print(stdout, cst);
 
-    retval = !pluto_constraints_is_empty(cst);
+    retval = !pluto_constraints_is_empty(cst, prog->solver);
 
     pluto_constraints_free(cst);
 
@@ -988,149 +1162,190 @@ static int pluto_dep_satisfies_instance(const Dep *dep, const PlutoProg *prog, i
 }
 
 
-/* Direction vector component at level 'level'
- */
-DepDir get_dep_direction(const Dep *dep, const PlutoProg *prog, int level)
+void pluto_dep_dir_cache_free(PlutoDepDirCache *cache)
 {
-    PlutoConstraints *cst;
-    int j, src, dest;
+    int i;
 
-    int npar = prog->npar;
-    Stmt **stmts = prog->stmts;
+    if (cache == NULL) return;
 
-    src = dep->src;
-    dest = dep->dest;
+    for (i=0; i<cache->nentries; i++) {
+        free(cache->hyps[i]);
+    }
+    free(cache->hyps);
+    free(cache->len);
+    free(cache->dirs);
+    free(cache->sat);
+    pluto_constraints_free(cache->dpoly);
+    free(cache);
+}
 
-    Stmt *src_stmt = stmts[dep->src];
-    Stmt *dest_stmt = stmts[dep->dest];
 
-    int src_dim = src_stmt->dim;
-    int dest_dim = dest_stmt->dim;
+/* Were the entries of 'cache' computed for another dependence polyhedron or
+ * source dimensionality than dep's current ones? */
+static int dep_dir_cache_is_stale(const PlutoDepDirCache *cache,
+        const Dep *dep, int src_dim)
+{
+    int i;
+    const PlutoConstraints *c1, *c2;
+
+    if (cache->src_dim != src_dim) return 1;
+
+    for (c1 = cache->dpoly, c2 = dep->dpolytope; c1 && c2;
+            c1 = c1->next, c2 = c2->next) {
+        if (c1->nrows != c2->nrows || c1->ncols != c2->ncols) return 1;
+        for (i=0; i<c1->nrows; i++) {
+            if (c1->is_eq[i] != c2->is_eq[i]
+                    || memcmp(c1->val[i], c2->val[i], c1->ncols*sizeof(int64))) {
+                return 1;
+            }
+        }
+    }
 
-    assert(level < stmts[src]->trans->nrows);
-    assert(level < stmts[dest]->trans->nrows);
+    return c1 != c2;
+}
 
-    cst = pluto_constraints_alloc(2 * (2 + dep->dpolytope->nrows),
-            (src_dim + dest_dim) + npar + 1);
 
-    /*
-     * Check for zero
-     *
-     * To test \phi (dest) - \phi(src) = 0, we try
-     *
-     * \phi(dest) - \phi(src) >= 1
-     */
-    cst->is_eq[0] = 0;
-    for (j = 0; j < src_dim; j++) {
-        cst->val[0][j] = -stmts[src]->trans->val[level][j];
-    }
-    for (j = src_dim; j < src_dim + dest_dim; j++) {
-        cst->val[0][j] = stmts[dest]->trans->val[level][j - src_dim];
-    }
-    for (j = src_dim + dest_dim; j < src_dim + dest_dim + npar; j++) {
-        cst->val[0][j] = -stmts[src]->trans->val[level][j - dest_dim] +
-            stmts[dest]->trans->val[level][j - src_dim];
-    }
-    cst->val[0][src_dim + dest_dim + npar] =
-        -stmts[src]->trans->val[level][src_dim + npar] +
-        stmts[dest]->trans->val[level][dest_dim + npar] - 1;
-    cst->nrows = 1;
+/*
+ * Index of the cache entry of 'dep' for the source and target hyperplanes
+ * at 'level'; an entry with nothing known yet is added if there isn't one.
+ * The cache is started afresh if the dependence polyhedron changed in any
+ * way since it was filled, since the entries are only keyed by hyperplanes
+ */
+static int dep_dir_cache_entry(Dep *dep, const PlutoProg *prog, int level)
+{
+    int i, e;
 
-    pluto_constraints_add(cst, dep->dpolytope);
+    int npar = prog->npar;
+    Stmt *src_stmt = prog->stmts[dep->src];
+    Stmt *dest_stmt = prog->stmts[dep->dest];
+    PlutoDepDirCache *cache = dep->dircache;
+
+    /* Key: the two hyperplanes */
+    int src_len = src_stmt->dim+npar+1;
+    int len = src_len + dest_stmt->dim+npar+1;
+    int64 key[len];
+    memcpy(key, src_stmt->trans->val[level], src_len*sizeof(int64));
+    memcpy(key+src_len, dest_stmt->trans->val[level], 
+            (len-src_len)*sizeof(int64));
+
+    if (cache && dep_dir_cache_is_stale(cache, dep, src_stmt->dim)) {
+        /* Polyhedron changed: start afresh */
+        pluto_dep_dir_cache_free(cache);
+        cache = NULL;
+        dep->dircache = NULL;
+    }
 
-    bool is_empty = pluto_constraints_is_empty(cst);
+    if (cache == NULL) {
+        cache = (PlutoDepDirCache *) malloc(sizeof(PlutoDepDirCache));
+        cache->hyps = NULL;
+        cache->len = NULL;
+        cache->dirs = NULL;
+        cache->sat = NULL;
+        cache->nentries = 0;
+        cache->alloc_entries = 0;
+        cache->dpoly = pluto_constraints_dup(dep->dpolytope);
+        cache->src_dim = src_stmt->dim;
+        dep->dircache = cache;
+    }
 
-    if (is_empty) {
-        for (j = 0; j < src_dim; j++) {
-            cst->val[0][j] = stmts[src]->trans->val[level][j];
-        }
-        for (j = src_dim; j < src_dim + dest_dim; j++) {
-            cst->val[0][j] = -stmts[dest]->trans->val[level][j - src_dim];
-        }
-        for (j = src_dim + dest_dim; j < src_dim + dest_dim + npar; j++) {
-            cst->val[0][j] = stmts[src]->trans->val[level][j - dest_dim] 
-                - stmts[dest]->trans->val[level][j - src_dim];
+    for (i=0; i<cache->nentries; i++) {
+        if (cache->len[i] == len && !memcmp(cache->hyps[i], key, len*sizeof(int64))) {
+            return i;
         }
-        cst->val[0][src_dim + dest_dim + npar] =
-            stmts[src]->trans->val[level][src_dim + npar] 
-            - stmts[dest]->trans->val[level][dest_dim + npar] - 1;
-        cst->nrows = 1;
+    }
 
-        pluto_constraints_add(cst, dep->dpolytope);
+    if (cache->nentries == cache->alloc_entries) {
+        cache->alloc_entries = PLMAX(8, 2*cache->alloc_entries);
+        cache->hyps = (int64 **) realloc(cache->hyps, cache->alloc_entries*sizeof(int64 *));
+        cache->len = (int *) realloc(cache->len, cache->alloc_entries*sizeof(int));
+        cache->dirs = (int *) realloc(cache->dirs, cache->alloc_entries*sizeof(int));
+        cache->sat = (int *) realloc(cache->sat, cache->alloc_entries*sizeof(int));
+    }
 
-        is_empty = pluto_constraints_is_empty(cst);
+    e = cache->nentries;
+    cache->hyps[e] = (int64 *) malloc(len*sizeof(int64));
+    memcpy(cache->hyps[e], key, len*sizeof(int64));
+    cache->len[e] = len;
+    cache->dirs[e] = -1;
+    cache->sat[e] = -1;
+    cache->nentries++;
 
-        /* If no solution exists, all points satisfy \phi (dest) - \phi (src) = 0 */
-        if (is_empty) {
-            pluto_constraints_free(cst);
-            return DEP_ZERO;
-        }
-    }
+    return e;
+}
 
-    /*
-     * Check for PLUS
-     * Constraint format
-     * \phi(dest) - \phi (src) <= -1
-     * (reverse of plus)
-     */
 
-    for (j = 0; j < src_dim; j++) {
-        cst->val[0][j] = stmts[src]->trans->val[level][j];
-    }
-    for (j = src_dim; j < src_dim + dest_dim; j++) {
-        cst->val[0][j] = -stmts[dest]->trans->val[level][j - src_dim];
-    }
-    for (j = src_dim + dest_dim; j < src_dim + dest_dim + npar; j++) {
-        cst->val[0][j] = stmts[src]->trans->val[level][j - dest_dim] 
-            - stmts[dest]->trans->val[level][j - src_dim];
-    }
-    cst->val[0][src_dim + dest_dim + npar] =
-        stmts[src]->trans->val[level][src_dim + npar] -
-        stmts[dest]->trans->val[level][dest_dim + npar] - 1;
+/* Direction vector component at level 'level'
+ *
+ * Obtained from the signs of the min and max of \phi(dest) - \phi(src)
+ * over the dependence polyhedron (a single solver query), which also
+ * decides satisfaction at this level. Both are cached on the dependence by
+ * source and target hyperplane, and so recomputing directions after
+ * hyperplanes have only been added or permuted costs no solver calls for
+ * the unchanged ones
+ */
+DepDir get_dep_direction(Dep *dep, const PlutoProg *prog, int level)
+{
+    int j, e, src_dim, dest_dim, min_sign, max_sign, is_empty;
+    DepDir dir;
 
-    cst->nrows = 1;
+    int npar = prog->npar;
+    Stmt **stmts = prog->stmts;
 
-    pluto_constraints_add(cst, dep->dpolytope);
+    Stmt *src_stmt = stmts[dep->src];
+    Stmt *dest_stmt = stmts[dep->dest];
+
+    src_dim = src_stmt->dim;
+    dest_dim = dest_stmt->dim;
 
-    is_empty = pluto_constraints_is_empty(cst);
+    assert(level < src_stmt->trans->nrows);
+    assert(level < dest_stmt->trans->nrows);
 
-    if (is_empty) {
-        pluto_constraints_free(cst);
-        return DEP_PLUS;
+    e = dep_dir_cache_entry(dep, prog, level);
+    if (dep->dircache->dirs[e] != -1) {
+        return (DepDir) dep->dircache->dirs[e];
     }
 
+    int64 *src_hyp = src_stmt->trans->val[level];
+    int64 *dest_hyp = dest_stmt->trans->val[level];
+
     /*
-     * Check for MINUS
+     * \phi(dest) - \phi(src) in the space of the dependence polyhedron
      *
-     * Constraint format
-     * \phi(dest) - \phi (src) >= 1
-     * reverse of minus, we alraedy know that it's not zero
+     * [src iterators | dest iterators | params | const]
      */
-
+    int64 obj[src_dim+dest_dim+npar+1];
     for (j = 0; j < src_dim; j++) {
-        cst->val[0][j] = -stmts[src]->trans->val[level][j];
+        obj[j] = -src_hyp[j];
     }
-    for (j = src_dim; j < src_dim + dest_dim; j++) {
-        cst->val[0][j] = stmts[dest]->trans->val[level][j - src_dim];
+    for (j = 0; j < dest_dim; j++) {
+        obj[src_dim+j] = dest_hyp[j];
     }
-    for (j = src_dim + dest_dim; j < src_dim + dest_dim + npar; j++) {
-        cst->val[0][j] = -stmts[src]->trans->val[level][j - dest_dim] 
-            + stmts[dest]->trans->val[level][j - src_dim];
+    for (j = 0; j < npar; j++) {
+        obj[src_dim+dest_dim+j] = dest_hyp[dest_dim+j] - src_hyp[src_dim+j];
     }
-    cst->val[0][src_dim + dest_dim + npar] =
-        -stmts[src]->trans->val[level][src_dim + npar] +
-        stmts[dest]->trans->val[level][dest_dim + npar] - 1;
-    cst->nrows = 1;
+    obj[src_dim+dest_dim+npar] = dest_hyp[dest_dim+npar] - src_hyp[src_dim+npar];
 
-    pluto_constraints_add(cst, dep->dpolytope);
+    assert(dep->dpolytope->ncols == src_dim+dest_dim+npar+1);
 
-    is_empty = pluto_constraints_is_empty(cst);
-    pluto_constraints_free(cst);
+    is_empty = pluto_constraints_affine_sign_range(dep->dpolytope, obj,
+            &min_sign, &max_sign, prog->solver);
 
-    if (is_empty) {
-        return DEP_MINUS;
+    if (is_empty || (min_sign == 0 && max_sign == 0)) {
+        /* All points satisfy \phi (dest) - \phi (src) = 0 */
+        dir = DEP_ZERO;
+    }else if (min_sign >= 0) {
+        dir = DEP_PLUS;
+    }else if (max_sign <= 0) {
+        dir = DEP_MINUS;
+    }else{
+        /* Neither ZERO, nor PLUS, nor MINUS, has to be STAR */
+        dir = DEP_STAR;
     }
 
-    /* Neither ZERO, nor PLUS, nor MINUS, has to be STAR */
-    return DEP_STAR;
+    dep->dircache->dirs[e] = dir;
+    /* The function is integral at integer points: a positive minimum
+     * means \phi(dest) - \phi(src) >= 1 everywhere */
+    dep->dircache->sat[e] = is_empty || min_sign > 0;
+
+    return dir;
 }
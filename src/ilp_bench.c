@@ -0,0 +1,270 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ *
+ * Copyright (C) 2007-2012 Uday Bondhugula
+ *
+ * This file is part of Pluto.
+ *
+ * Pluto is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the file
+ * `LICENSE' in the top-level directory of this distribution.
+ *
+ * ilp_bench.c
+ *
+ * Replays solver queries captured with --capture-ilp=<dir> against each
+ * ILP back end (isl, PIP), and reports time per back end, whether the
+ * answers agree, and the distribution of problem sizes
+ *
+ * Usage: ilp_bench <capture dir | query file>...
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "pluto.h"
+#include "constraints.h"
+#include "profile.h"
+
+#define NUM_BACKENDS 2
+/* Size buckets: [0, 8), [8, 16), [16, 32), ..., [2^(k+2), inf) */
+#define NUM_BUCKETS 12
+
+static const char *backend_names[NUM_BACKENDS] = {"isl", "pip"};
+
+struct bench_stats {
+    int num_lexmin;
+    int num_empty;
+    int num_mismatch;
+
+    double time[NUM_BACKENDS];
+    double max_time[NUM_BACKENDS];
+    /* Queries on which the back end was the fastest */
+    int num_fastest[NUM_BACKENDS];
+
+    int rows_hist[NUM_BUCKETS];
+    int cols_hist[NUM_BUCKETS];
+};
+
+
+static int size_bucket(int n)
+{
+    int b = 0;
+
+    for (n /= 8; n > 0 && b < NUM_BUCKETS-1; n /= 2) b++;
+
+    return b;
+}
+
+
+/* Answer a query with back end b; returns the lexmin (or NULL), and for an
+ * emptiness query, sets *is_empty */
+static int64 *bench_solve(const PlutoConstraints *cst, int is_lexmin,
+        int negvar, int b, PlutoSolverSession *ss, int *is_empty)
+{
+    int64 *sol = NULL;
+
+    pluto_options->islsolve = (b == SOLVER_ISL);
+    pluto_options->pipsolve = (b == SOLVER_PIP);
+
+    if (is_lexmin) {
+        if (b == SOLVER_ISL) {
+            sol = pluto_constraints_lexmin_isl(cst, negvar, ss);
+        }else{
+            sol = pluto_constraints_lexmin_pip(cst, negvar);
+        }
+    }else{
+        *is_empty = pluto_constraints_is_empty(cst, ss);
+    }
+
+    return sol;
+}
+
+
+static void bench_file(const char *path, PlutoSolverSession *ss,
+        struct bench_stats *stats)
+{
+    int b, negvar, is_lexmin, fastest;
+    char kind[16];
+    FILE *fp;
+    PlutoConstraints *cst;
+    int64 *sol[NUM_BACKENDS];
+    int is_empty[NUM_BACKENDS];
+    double time[NUM_BACKENDS];
+
+    fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "[ilp_bench] Can't open %s\n", path);
+        return;
+    }
+
+    if (fscanf(fp, "%15s %d", kind, &negvar) != 2
+            || (strcmp(kind, "lexmin") && strcmp(kind, "empty"))) {
+        fprintf(stderr, "[ilp_bench] %s: not a captured query\n", path);
+        fclose(fp);
+        return;
+    }
+    cst = pluto_constraints_read(fp);
+    fclose(fp);
+    if (cst == NULL) {
+        fprintf(stderr, "[ilp_bench] %s: can't read constraints\n", path);
+        return;
+    }
+
+    is_lexmin = !strcmp(kind, "lexmin");
+    if (is_lexmin) stats->num_lexmin++;
+    else stats->num_empty++;
+
+    stats->rows_hist[size_bucket(cst->nrows)]++;
+    stats->cols_hist[size_bucket(cst->ncols-1)]++;
+
+    fastest = 0;
+    for (b=0; b<NUM_BACKENDS; b++) {
+        double t_start = pluto_profile_clock();
+        sol[b] = bench_solve(cst, is_lexmin, negvar, b, ss, &is_empty[b]);
+        time[b] = pluto_profile_clock() - t_start;
+
+        stats->time[b] += time[b];
+        stats->max_time[b] = PLMAX(stats->max_time[b], time[b]);
+        if (time[b] < time[fastest]) fastest = b;
+    }
+    stats->num_fastest[fastest]++;
+
+    for (b=1; b<NUM_BACKENDS; b++) {
+        int same;
+        if (is_lexmin) {
+            same = (sol[0] == NULL && sol[b] == NULL)
+                || (sol[0] && sol[b]
+                        && !memcmp(sol[0], sol[b], (cst->ncols-1)*sizeof(int64)));
+        }else{
+            same = (is_empty[0] == is_empty[b]);
+        }
+        if (!same) {
+            printf("[ilp_bench] %s: %s and %s differ\n", path,
+                    backend_names[0], backend_names[b]);
+            stats->num_mismatch++;
+            break;
+        }
+    }
+
+    for (b=0; b<NUM_BACKENDS; b++) {
+        free(sol[b]);
+    }
+    pluto_constraints_free(cst);
+}
+
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+
+/* Replay the queries of a capture directory in the order captured */
+static void bench_dir(const char *dirname, PlutoSolverSession *ss,
+        struct bench_stats *stats)
+{
+    int i, n;
+    DIR *dir;
+    struct dirent *ent;
+    char **names;
+
+    dir = opendir(dirname);
+    if (!dir) {
+        fprintf(stderr, "[ilp_bench] Can't open %s\n", dirname);
+        return;
+    }
+
+    n = 0;
+    names = NULL;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        names = (char **) realloc(names, (n+1)*sizeof(char *));
+        names[n] = (char *) malloc(strlen(dirname)+strlen(ent->d_name)+2);
+        sprintf(names[n], "%s/%s", dirname, ent->d_name);
+        n++;
+    }
+    closedir(dir);
+
+    qsort(names, n, sizeof(char *), compare_names);
+
+    for (i=0; i<n; i++) {
+        bench_file(names[i], ss, stats);
+        free(names[i]);
+    }
+    free(names);
+}
+
+
+static void print_hist(const char *what, const int *hist)
+{
+    int k;
+
+    printf("%s:\n", what);
+    for (k=0; k<NUM_BUCKETS; k++) {
+        if (hist[k] == 0) continue;
+        if (k == 0) {
+            printf("\t[0, 8): %d\n", hist[k]);
+        }else if (k == NUM_BUCKETS-1) {
+            printf("\t[%d, ...): %d\n", 4 << k, hist[k]);
+        }else{
+            printf("\t[%d, %d): %d\n", 4 << k, 8 << k, hist[k]);
+        }
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    int i, b;
+    struct stat st;
+    struct bench_stats stats;
+    PlutoSolverSession *ss;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture dir | query file>...\n", argv[0]);
+        return 1;
+    }
+
+    pluto_options = pluto_options_alloc();
+    pluto_options->silent = 1;
+
+    memset(&stats, 0, sizeof(stats));
+
+    ss = pluto_solver_session_alloc();
+
+    for (i=1; i<argc; i++) {
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            bench_dir(argv[i], ss, &stats);
+        }else{
+            bench_file(argv[i], ss, &stats);
+        }
+    }
+
+    printf("Queries: %d (lexmin: %d, emptiness: %d)\n",
+            stats.num_lexmin+stats.num_empty, stats.num_lexmin, stats.num_empty);
+    for (b=0; b<NUM_BACKENDS; b++) {
+        printf("%s: total %0.6lfs, max %0.6lfs, fastest on %d\n",
+                backend_names[b], stats.time[b], stats.max_time[b],
+                stats.num_fastest[b]);
+    }
+    printf("Answers differing: %d\n", stats.num_mismatch);
+    print_hist("Rows", stats.rows_hist);
+    print_hist("Variables", stats.cols_hist);
+
+    pluto_solver_session_free(ss);
+    pluto_options_free(pluto_options);
+
+    return stats.num_mismatch != 0;
+}
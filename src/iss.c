@@ -125,10 +125,10 @@ PlutoConstraints **get_lin_ind_constraints(PlutoMatrix *mat, int *orthonum)
  * Index Set Splitting for close-to mid-point cutting
  *
  * Refer to PACT'14 paper on tiling periodic domains for
- * the formulation
+ * the formulation; 'ss' (can be NULL) is passed on to farkas_lemma_affine
  */
 PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms,
-        int npar, PlutoConstraints *indcst)
+        int npar, PlutoConstraints *indcst, PlutoSolverSession *ss)
 {
     int i, j, k, ndim;
 
@@ -178,7 +178,7 @@ PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms,
          * cst is of the following form
          * [m | sigma(h) | h | P r| const ] 
          */
-        PlutoConstraints *cst1 = farkas_lemma_affine(dom, mat);
+        PlutoConstraints *cst1 = farkas_lemma_affine(dom, mat, ss);
 
         /* Linearize: m - 2v(p) + h.s + h.t >= 0 */
         pluto_matrix_set(mat, 0);
@@ -196,7 +196,7 @@ PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms,
         mat->val[2*ndim+npar][2+ndim+npar] = -2;
         mat->val[2*ndim+npar][0] = 1;
 
-        PlutoConstraints *cst2 = farkas_lemma_affine(dom, mat);
+        PlutoConstraints *cst2 = farkas_lemma_affine(dom, mat, ss);
         pluto_matrix_free(mat);
 
         pluto_constraints_add(cst, cst1);
@@ -237,7 +237,7 @@ PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms,
         pluto_constraints_add(cst, indcst);
     }
 
-    int64 *sol = pluto_constraints_lexmin(cst, DO_NOT_ALLOW_NEGATIVE_COEFF);
+    int64 *sol = pluto_constraints_lexmin(cst, DO_NOT_ALLOW_NEGATIVE_COEFF, NULL);
 
     pluto_constraints_free(cst);
     pluto_constraints_free(nz);
@@ -355,7 +355,7 @@ void pluto_update_deps_after_iss(PlutoProg *prog,
                     pluto_constraints_free(dcut);
                 }
 
-                if (!pluto_constraints_is_empty(dpolytope)) {
+                if (!pluto_constraints_is_empty(dpolytope, prog->solver)) {
                     num_iss_deps++;
                     iss_deps = realloc(iss_deps, num_iss_deps*sizeof(Dep *));
                     iss_deps[num_iss_deps-1] = pluto_dep_dup(dep);
@@ -373,6 +373,7 @@ void pluto_update_deps_after_iss(PlutoProg *prog,
                         iss_dep->dest = base_stmt_id + t;
                         iss_dep->dest_acc = NULL;
                     }
+                    pluto_dep_detect_uniform(iss_dep, prog->stmts);
                 }else{
                     pluto_constraints_free(dpolytope);
                 }
@@ -386,6 +387,7 @@ void pluto_update_deps_after_iss(PlutoProg *prog,
 
         prog->deps = iss_deps;
         prog->ndeps = num_iss_deps;
+        pluto_prog_invalidate_dep_index(prog);
     }
 }
 
@@ -488,7 +490,7 @@ void pluto_iss_dep(PlutoProg *prog)
         PLUTO_MESSAGE(printf("[iss] Dimension %d\n", i););
         PlutoConstraints *h = pluto_find_iss(
                 (const PlutoConstraints **) long_dep_doms[i], 
-                num_long_deps[i], npar, NULL);
+                num_long_deps[i], npar, NULL, prog->solver);
         if (h) {
             PlutoConstraints *negh = pluto_hyperplane_get_negative_half_space(h);
             PlutoConstraints *posh = pluto_hyperplane_get_non_negative_half_space(h);
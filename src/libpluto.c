@@ -19,9 +19,12 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/time.h>
 
 #include "pluto.h"
@@ -33,7 +36,7 @@
 
 #include "candl/scop.h"
 
-PlutoOptions *options;
+__thread PlutoOptions *pluto_options;
 
 static double rtclock()
 {
@@ -190,15 +193,331 @@ PlutoConstraints *normalize_domain_schedule(Stmt *stmt, PlutoProg *prog)
     return sched;
 }
 
+/* Describe loop as a band of the given width */
+static void band_info_set(PlutoBandInfo *binfo, const Ploop *loop, int width)
+{
+    int i;
+
+    binfo->depth = loop->depth;
+    binfo->width = width;
+    binfo->nstmts = loop->nstmts;
+    binfo->stmts = (int *) malloc(loop->nstmts*sizeof(int));
+    for (i=0; i<loop->nstmts; i++) {
+        binfo->stmts[i] = loop->stmts[i]->id;
+    }
+}
+
+
+static int band_has_loop(const Band *band, const Ploop *loop)
+{
+    int i;
+
+    if (loop->depth < band->loop->depth
+            || loop->depth >= band->loop->depth + band->width) {
+        return 0;
+    }
+    for (i=0; i<loop->nstmts; i++) {
+        if (!pluto_loop_has_stmt(band->loop, loop->stmts[i]->id)) return 0;
+    }
+
+    return 1;
+}
+
+
+static void loop_info_set(PlutoLoopInfo *linfo, Ploop *loop, Band **bands,
+        int nbands, PlutoProg *prog)
+{
+    int i, ts;
+
+    linfo->depth = loop->depth;
+    linfo->nstmts = loop->nstmts;
+    linfo->stmts = (int *) malloc(loop->nstmts*sizeof(int));
+    for (i=0; i<loop->nstmts; i++) {
+        linfo->stmts[i] = loop->stmts[i]->id;
+    }
+
+    linfo->band = -1;
+    for (i=0; i<nbands; i++) {
+        if (band_has_loop(bands[i], loop)) {
+            linfo->band = i;
+            break;
+        }
+    }
+
+    linfo->is_parallel = pluto_loop_is_parallel(prog, loop);
+    linfo->is_pipelined = !linfo->is_parallel && linfo->band >= 0
+        && bands[linfo->band]->width >= 2;
+    linfo->is_vectorizable = linfo->is_parallel
+        && pluto_loop_is_innermost(loop, prog);
+
+    linfo->tile_size = pluto_stmt_get_tile_size(loop->stmts[0], loop->depth);
+    for (i=1; i<loop->nstmts; i++) {
+        ts = pluto_stmt_get_tile_size(loop->stmts[i], loop->depth);
+        if (ts != linfo->tile_size) {
+            linfo->tile_size = -1;
+            break;
+        }
+    }
+}
+
+
+/* Band and loop information of the final schedule of prog */
+static PlutoScheduleInfo *pluto_schedule_info_extract(PlutoProg *prog)
+{
+    int i, nbands, nploops, nloops;
+    Band **bands;
+    Ploop **ploops, **loops;
+    PlutoScheduleInfo *info;
+
+    info = (PlutoScheduleInfo *) malloc(sizeof(PlutoScheduleInfo));
+
+    pluto_compute_dep_directions(prog);
+    pluto_compute_dep_satisfaction(prog);
+    bands = pluto_get_outermost_permutable_bands(prog, &nbands);
+    info->nbands = nbands;
+    info->bands = (PlutoBandInfo *) malloc(nbands*sizeof(PlutoBandInfo));
+    for (i=0; i<nbands; i++) {
+        band_info_set(&info->bands[i], bands[i]->loop, bands[i]->width);
+    }
+
+    if (pluto_options->parallel) {
+        ploops = pluto_get_dom_parallel_loops(prog, &nploops);
+    }else{
+        ploops = NULL;
+        nploops = 0;
+    }
+    info->nploops = nploops;
+    info->ploops = (PlutoBandInfo *) malloc(nploops*sizeof(PlutoBandInfo));
+    for (i=0; i<nploops; i++) {
+        band_info_set(&info->ploops[i], ploops[i], 1);
+    }
+    pluto_loops_free(ploops, nploops);
+
+    loops = pluto_get_all_loops(prog, &nloops);
+    info->nloops = nloops;
+    info->loops = (PlutoLoopInfo *) malloc(nloops*sizeof(PlutoLoopInfo));
+    for (i=0; i<nloops; i++) {
+        loop_info_set(&info->loops[i], loops[i], bands, nbands, prog);
+    }
+    pluto_loops_free(loops, nloops);
+
+    pluto_bands_free(bands, nbands);
+
+    return info;
+}
+
+
+static int *int_array_dup(const int *a, int n)
+{
+    int *dup = (int *) malloc(n*sizeof(int));
+    memcpy(dup, a, n*sizeof(int));
+    return dup;
+}
+
+
+static PlutoScheduleInfo *pluto_schedule_info_dup(const PlutoScheduleInfo *info)
+{
+    int i;
+    PlutoScheduleInfo *dup;
+
+    dup = (PlutoScheduleInfo *) malloc(sizeof(PlutoScheduleInfo));
+
+    dup->nbands = info->nbands;
+    dup->bands = (PlutoBandInfo *) malloc(info->nbands*sizeof(PlutoBandInfo));
+    for (i=0; i<info->nbands; i++) {
+        dup->bands[i] = info->bands[i];
+        dup->bands[i].stmts = int_array_dup(info->bands[i].stmts,
+                info->bands[i].nstmts);
+    }
+
+    dup->nploops = info->nploops;
+    dup->ploops = (PlutoBandInfo *) malloc(info->nploops*sizeof(PlutoBandInfo));
+    for (i=0; i<info->nploops; i++) {
+        dup->ploops[i] = info->ploops[i];
+        dup->ploops[i].stmts = int_array_dup(info->ploops[i].stmts,
+                info->ploops[i].nstmts);
+    }
+
+    dup->nloops = info->nloops;
+    dup->loops = (PlutoLoopInfo *) malloc(info->nloops*sizeof(PlutoLoopInfo));
+    for (i=0; i<info->nloops; i++) {
+        dup->loops[i] = info->loops[i];
+        dup->loops[i].stmts = int_array_dup(info->loops[i].stmts,
+                info->loops[i].nstmts);
+    }
+
+    return dup;
+}
+
+
+/* Bytes taken by info (for the cache's memory accounting) */
+static size_t pluto_schedule_info_size(const PlutoScheduleInfo *info)
+{
+    int i;
+    size_t size;
+
+    size = sizeof(PlutoScheduleInfo)
+        + (info->nbands+info->nploops)*sizeof(PlutoBandInfo)
+        + info->nloops*sizeof(PlutoLoopInfo);
+    for (i=0; i<info->nbands; i++) {
+        size += info->bands[i].nstmts*sizeof(int);
+    }
+    for (i=0; i<info->nploops; i++) {
+        size += info->ploops[i].nstmts*sizeof(int);
+    }
+    for (i=0; i<info->nloops; i++) {
+        size += info->loops[i].nstmts*sizeof(int);
+    }
+
+    return size;
+}
+
+
+static void print_stmt_ids(FILE *fp, const int *stmts, int nstmts)
+{
+    int i;
+
+    fprintf(fp, "{");
+    for (i=0; i<nstmts; i++) {
+        fprintf(fp, "S_%d%s", stmts[i], (i < nstmts-1)? ", ": "");
+    }
+    fprintf(fp, "}");
+}
+
+
+void pluto_schedule_info_print(FILE *fp, const PlutoScheduleInfo *info)
+{
+    int i;
+
+    fprintf(fp, "Permutable bands: %d\n", info->nbands);
+    for (i=0; i<info->nbands; i++) {
+        fprintf(fp, "\tband %d: t%d to t%d of ", i, info->bands[i].depth+1,
+                info->bands[i].depth+info->bands[i].width);
+        print_stmt_ids(fp, info->bands[i].stmts, info->bands[i].nstmts);
+        fprintf(fp, "\n");
+    }
+
+    fprintf(fp, "Loops: %d\n", info->nloops);
+    for (i=0; i<info->nloops; i++) {
+        const PlutoLoopInfo *linfo = &info->loops[i];
+        fprintf(fp, "\tt%d of ", linfo->depth+1);
+        print_stmt_ids(fp, linfo->stmts, linfo->nstmts);
+        if (linfo->band >= 0) fprintf(fp, " band %d", linfo->band);
+        if (linfo->is_parallel) fprintf(fp, " parallel");
+        if (linfo->is_pipelined) fprintf(fp, " pipelined");
+        if (linfo->is_vectorizable) fprintf(fp, " vectorizable");
+        if (linfo->tile_size > 0) fprintf(fp, " tile size %d", linfo->tile_size);
+        if (linfo->tile_size == -1) fprintf(fp, " tile size varies");
+        fprintf(fp, "\n");
+    }
+}
+
+
+void pluto_schedule_info_free(PlutoScheduleInfo *info)
+{
+    int i;
+
+    if (info == NULL) return;
+
+    for (i=0; i<info->nbands; i++) {
+        free(info->bands[i].stmts);
+    }
+    for (i=0; i<info->nploops; i++) {
+        free(info->ploops[i].stmts);
+    }
+    for (i=0; i<info->nloops; i++) {
+        free(info->loops[i].stmts);
+    }
+    free(info->bands);
+    free(info->ploops);
+    free(info->loops);
+    free(info);
+}
+
+
+/*
+ * Find the transformations of prog, and tile them or skew them for
+ * parallelism as per options; returns 1 on failure. Sets *t_t to the time
+ * taken by pluto_auto_transform
+ */
+static int libpluto_transform(PlutoProg *prog, double *t_t)
+{
+    int nbands, n_ibands, retval;
+    double t_start;
+    Band **bands, **ibands;
+
+    t_start = rtclock();
+    retval = pluto_auto_transform(prog);
+    *t_t = rtclock() - t_start;
+
+    if (retval) {
+        if (!pluto_options->silent) {
+            printf("[libpluto] failure, returning NULL schedules\n");
+        }
+        return 1;
+    }
+
+    pluto_compute_dep_directions(prog);
+    pluto_compute_dep_satisfaction(prog);
+
+    if (!pluto_options->silent) {
+        fprintf(stdout, "[pluto] Affine transformations\n\n");
+        /* Print out transformations */
+        pluto_transformations_pretty_print(prog);
+    }
+
+    bands = pluto_get_outermost_permutable_bands(prog, &nbands);
+    ibands = pluto_get_innermost_permutable_bands(prog, &n_ibands);
+    printf("Outermost tilable bands: %d bands\n", nbands);
+    pluto_bands_print(bands, nbands);
+    printf("Innermost tilable bands: %d bands\n", n_ibands);
+    pluto_bands_print(ibands, n_ibands);
+    pluto_bands_free(bands, nbands);
+    pluto_bands_free(ibands, n_ibands);
+
+    if (pluto_options->tile) {
+        pluto_tile(prog);
+    }else{
+        if (pluto_options->intratileopt) {
+            pluto_intra_tile_optimize(prog, 0);
+        }
+    }
+
+    if ((pluto_options->parallel) && !pluto_options->tile && !pluto_options->identity)   {
+        /* Obtain wavefront/pipelined parallelization by skewing if
+         * necessary */
+        pluto_compute_dep_satisfaction(prog);
+        bands = pluto_get_outermost_permutable_bands(prog, &nbands);
+        retval = pluto_create_tile_schedule(prog, bands, nbands);
+        pluto_bands_free(bands, nbands);
+
+        /* If the user hasn't supplied --tile and there is only pipelined
+         * parallelism, we will warn the user */
+        if (retval)   {
+            printf("[pluto] WARNING: pipelined parallelism exists and --tile is not used.\n");
+            printf("[pluto] WARNING: use --tile for better parallelization \n");
+            fprintf(stdout, "[pluto] After skewing:\n");
+            pluto_transformations_pretty_print(prog);
+            /* IF_DEBUG(pluto_print_hyperplane_properties(prog);); */
+        }
+    }
+
+    return 0;
+}
+
+
 /*
  * Output schedules are isl relations that have dims in the order
  * isl_dim_out, isl_dim_in, div, param, const
+ *
+ * If info is not NULL, the band and loop information of the schedule is
+ * returned in it
  */
-__isl_give isl_union_map *pluto_schedule(isl_union_set *domains, 
-        isl_union_map *dependences, 
+__isl_give isl_union_map *pluto_schedule_with_info(isl_union_set *domains,
+        isl_union_map *dependences, PlutoScheduleInfo **info,
         PlutoOptions *options_l)
 {
-    int i, j, nbands, n_ibands, retval;
+    int i, j;
     isl_ctx *ctx;
     isl_space *space;
     double t_t, t_all, t_start;
@@ -206,6 +525,8 @@ __isl_give isl_union_map *pluto_schedule(isl_union_set *domains,
     ctx = isl_union_set_get_ctx(domains);
     space = isl_union_set_get_space(domains);
 
+    if (info) *info = NULL;
+
     // isl_union_set_dump(domains);
     // isl_union_map_dump(dependences);
 
@@ -213,7 +534,7 @@ __isl_give isl_union_map *pluto_schedule(isl_union_set *domains,
     prog->options = options_l;
 
     /* global var */
-    options = options_l;
+    pluto_options = options_l;
 
 
     prog->nvar = -1;
@@ -260,118 +581,504 @@ __isl_give isl_union_map *pluto_schedule(isl_union_set *domains,
     IF_DEBUG(pluto_prog_print(stdout, prog););
 
     t_start = rtclock();
-    retval = pluto_auto_transform(prog);
-    t_t = rtclock() - t_start;
-
-    if (retval) {
+    if (libpluto_transform(prog, &t_t)) {
         /* Failure */
         pluto_prog_free(prog);
         isl_space_free(space);
+        return NULL;
+    }
 
-        if (!options->silent) {
-            printf("[libpluto] failure, returning NULL schedules\n");
+    if (pluto_options->parallel && !pluto_options->silent) {
+        int nploops;
+        Ploop **ploops = pluto_get_dom_parallel_loops(prog, &nploops);
+        printf("[pluto_mark_parallel] %d parallel loops\n", nploops);
+        pluto_loops_print(ploops, nploops);
+        printf("\n");
+        pluto_loops_free(ploops, nploops);
+    }
+
+    if (info) {
+        *info = pluto_schedule_info_extract(prog);
+        IF_DEBUG(pluto_schedule_info_print(stdout, *info););
+    }
+
+    // pluto_stmts_print(stdout, prog->stmts, prog->nstmts);
+
+    /* Construct isl_union_map for pluto schedules */
+    isl_union_map *schedules = isl_union_map_empty(isl_space_copy(space));
+    for (i=0; i<prog->nstmts; i++) {
+        isl_basic_map *bmap;
+        isl_map *map;
+        Stmt *stmt = prog->stmts[i];
+        PlutoConstraints *sched = normalize_domain_schedule(stmt, prog);
+        // pluto_constraints_print(stdout, sched);
+
+        bmap = isl_basic_map_from_pluto_constraints(ctx, sched,
+                sched->ncols - stmt->trans->nrows - prog->npar - 1, 
+                stmt->trans->nrows, prog->npar);
+        bmap = isl_basic_map_project_out(bmap, isl_dim_in, 0, sched->ncols - stmt->trans->nrows - stmt->domain->ncols);
+        char name[20];
+        snprintf(name, sizeof(name), "S_%d", i);
+        map = isl_map_from_basic_map(bmap);
+
+        /* Copy ids of the original parameter dimensions  */
+        for (j=0; j<isl_space_dim(space, isl_dim_param); j++) {
+            isl_id *id = isl_space_get_dim_id(space, isl_dim_param, j);
+            map = isl_map_set_dim_id(map, isl_dim_param, j, id);
         }
 
-        return NULL;
+        map = isl_map_set_tuple_name(map, isl_dim_in, name);
+        schedules = isl_union_map_union(schedules, isl_union_map_from_map(map));
+
+        pluto_constraints_free(sched);
     }
 
-    pluto_compute_dep_directions(prog);
-    pluto_compute_dep_satisfaction(prog);
+    pluto_prog_free(prog);
+    isl_space_free(space);
 
-    if (!options->silent) {
-        fprintf(stdout, "[pluto] Affine transformations\n\n");
-        /* Print out transformations */
-        pluto_transformations_pretty_print(prog);
+    t_all = rtclock() - t_start;
+
+    if (pluto_options->time && !pluto_options->silent) {
+        printf("[pluto] Auto-transformation time: %0.6lfs\n", t_t);
+        printf("[pluto] Other/Misc time: %0.6lfs\n", t_all-t_t);
+        printf("[pluto] Total time: %0.6lfs\n", t_all);
     }
 
-    Band **bands, **ibands;
-    bands = pluto_get_outermost_permutable_bands(prog, &nbands);
-    ibands = pluto_get_innermost_permutable_bands(prog, &n_ibands);
-    printf("Outermost tilable bands: %d bands\n", nbands);
-    pluto_bands_print(bands, nbands);
-    printf("Innermost tilable bands: %d bands\n", n_ibands);
-    pluto_bands_print(ibands, n_ibands);
+    return schedules;
+}
 
-    if (options->tile) {
-        pluto_tile(prog);
-    }else{
-        if (options->intratileopt) {
-            pluto_intra_tile_optimize(prog, 0);
-        }
+
+__isl_give isl_union_map *pluto_schedule(isl_union_set *domains, 
+        isl_union_map *dependences, 
+        PlutoOptions *options_l)
+{
+    return pluto_schedule_with_info(domains, dependences, NULL, options_l);
+}
+
+
+/* Number of hash buckets of a schedule cache */
+#define SCHEDULE_CACHE_NBUCKETS 1024
+
+struct schedule_cache_entry {
+    char *key;
+    unsigned long long hash;
+
+    /* The schedule as printed by isl */
+    char *schedule;
+    PlutoScheduleInfo *info;
+
+    /* Bytes accounted for this entry */
+    size_t size;
+
+    /* Next entry in the same bucket */
+    struct schedule_cache_entry *chain;
+    /* Neighbors in the LRU list (most recently used first) */
+    struct schedule_cache_entry *prev;
+    struct schedule_cache_entry *next;
+};
+
+struct plutoScheduleCache {
+    struct schedule_cache_entry *buckets[SCHEDULE_CACHE_NBUCKETS];
+
+    /* Most and least recently used entries */
+    struct schedule_cache_entry *head;
+    struct schedule_cache_entry *tail;
+
+    size_t size;
+    size_t max_size;
+
+    long num_lookups;
+    long num_hits;
+
+    /* Guards all of the above; one cache may be used by several threads */
+    pthread_mutex_t lock;
+};
+
+
+PlutoScheduleCache *pluto_schedule_cache_alloc(size_t max_bytes)
+{
+    PlutoScheduleCache *cache;
+
+    cache = (PlutoScheduleCache *) calloc(1, sizeof(PlutoScheduleCache));
+    cache->max_size = max_bytes;
+    pthread_mutex_init(&cache->lock, NULL);
+
+    return cache;
+}
+
+
+static void schedule_cache_entry_free(struct schedule_cache_entry *entry)
+{
+    free(entry->key);
+    free(entry->schedule);
+    pluto_schedule_info_free(entry->info);
+    free(entry);
+}
+
+
+void pluto_schedule_cache_free(PlutoScheduleCache *cache)
+{
+    struct schedule_cache_entry *entry, *next;
+
+    if (cache == NULL) return;
+
+    for (entry=cache->head; entry != NULL; entry=next) {
+        next = entry->next;
+        schedule_cache_entry_free(entry);
     }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
 
-    if ((options->parallel) && !options->tile && !options->identity)   {
-        /* Obtain wavefront/pipelined parallelization by skewing if
-         * necessary */
-        int nbands;
-        Band **bands;
-        pluto_compute_dep_satisfaction(prog);
-        bands = pluto_get_outermost_permutable_bands(prog, &nbands);
-        bool retval = pluto_create_tile_schedule(prog, bands, nbands);
-        pluto_bands_free(bands, nbands);
 
-        /* If the user hasn't supplied --tile and there is only pipelined
-         * parallelism, we will warn the user */
-        if (retval)   {
-            printf("[pluto] WARNING: pipelined parallelism exists and --tile is not used.\n");
-            printf("[pluto] WARNING: use --tile for better parallelization \n");
-            fprintf(stdout, "[pluto] After skewing:\n");
-            pluto_transformations_pretty_print(prog);
-            /* IF_DEBUG(pluto_print_hyperplane_properties(prog);); */
+void pluto_schedule_cache_get_stats(PlutoScheduleCache *cache,
+        long *num_lookups, long *num_hits, size_t *size)
+{
+    pthread_mutex_lock(&cache->lock);
+    *num_lookups = cache->num_lookups;
+    *num_hits = cache->num_hits;
+    *size = cache->size;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+static void schedule_cache_unlink(PlutoScheduleCache *cache,
+        struct schedule_cache_entry *entry)
+{
+    if (entry->prev) entry->prev->next = entry->next;
+    else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else cache->tail = entry->prev;
+}
+
+
+static void schedule_cache_push_front(PlutoScheduleCache *cache,
+        struct schedule_cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry;
+    else cache->tail = entry;
+    cache->head = entry;
+}
+
+
+/* Remove entry from the cache and free it */
+static void schedule_cache_evict(PlutoScheduleCache *cache,
+        struct schedule_cache_entry *entry)
+{
+    struct schedule_cache_entry **p;
+
+    for (p=&cache->buckets[entry->hash % SCHEDULE_CACHE_NBUCKETS]; *p != entry;
+            p=&(*p)->chain)
+        ;
+    *p = entry->chain;
+
+    schedule_cache_unlink(cache, entry);
+    cache->size -= entry->size;
+    schedule_cache_entry_free(entry);
+}
+
+
+/* Called with the lock held; a hit becomes the most recently used entry */
+static struct schedule_cache_entry *schedule_cache_find(
+        PlutoScheduleCache *cache, const char *key, unsigned long long hash)
+{
+    struct schedule_cache_entry *entry;
+
+    for (entry=cache->buckets[hash % SCHEDULE_CACHE_NBUCKETS]; entry != NULL;
+            entry=entry->chain) {
+        if (entry->hash == hash && !strcmp(entry->key, key)) break;
+    }
+
+    if (entry && entry != cache->head) {
+        schedule_cache_unlink(cache, entry);
+        schedule_cache_push_front(cache, entry);
+    }
+
+    return entry;
+}
+
+
+/* Insert a new entry, evicting the least recently used ones to stay
+ * within max_size; entries larger than max_size aren't kept. Takes
+ * ownership of key, schedule and info */
+static void schedule_cache_insert(PlutoScheduleCache *cache, char *key,
+        unsigned long long hash, char *schedule, PlutoScheduleInfo *info)
+{
+    struct schedule_cache_entry *entry;
+    size_t size;
+
+    size = sizeof(struct schedule_cache_entry) + strlen(key) + 1
+        + strlen(schedule) + 1 + pluto_schedule_info_size(info);
+
+    pthread_mutex_lock(&cache->lock);
+
+    /* Another thread may have scheduled the same input meanwhile */
+    if (size > cache->max_size || schedule_cache_find(cache, key, hash)) {
+        pthread_mutex_unlock(&cache->lock);
+        free(key);
+        free(schedule);
+        pluto_schedule_info_free(info);
+        return;
+    }
+
+    while (cache->size + size > cache->max_size) {
+        schedule_cache_evict(cache, cache->tail);
+    }
+
+    entry = (struct schedule_cache_entry *) malloc(sizeof(*entry));
+    entry->key = key;
+    entry->hash = hash;
+    entry->schedule = schedule;
+    entry->info = info;
+    entry->size = size;
+    entry->chain = cache->buckets[hash % SCHEDULE_CACHE_NBUCKETS];
+    cache->buckets[hash % SCHEDULE_CACHE_NBUCKETS] = entry;
+    schedule_cache_push_front(cache, entry);
+    cache->size += size;
+
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+/* Temporary data structure used to print the sets/maps of a union in
+ * canonical order */
+struct key_strs {
+    char **strs;
+    int n;
+};
+
+static int key_add_set(__isl_take isl_set *set, void *user)
+{
+    struct key_strs *ks = (struct key_strs *) user;
+    isl_printer *p = isl_printer_to_str(isl_set_get_ctx(set));
+
+    p = isl_printer_print_set(p, set);
+    ks->strs = (char **) realloc(ks->strs, (ks->n+1)*sizeof(char *));
+    ks->strs[ks->n++] = isl_printer_get_str(p);
+
+    isl_printer_free(p);
+    isl_set_free(set);
+    return 0;
+}
+
+static int key_add_map(__isl_take isl_map *map, void *user)
+{
+    struct key_strs *ks = (struct key_strs *) user;
+    isl_printer *p = isl_printer_to_str(isl_map_get_ctx(map));
+
+    p = isl_printer_print_map(p, map);
+    ks->strs = (char **) realloc(ks->strs, (ks->n+1)*sizeof(char *));
+    ks->strs[ks->n++] = isl_printer_get_str(p);
+
+    isl_printer_free(p);
+    isl_map_free(map);
+    return 0;
+}
+
+static int compare_strs(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/* Print the sorted strings and free them */
+static __isl_give isl_printer *key_print_strs(__isl_take isl_printer *p,
+        struct key_strs *ks)
+{
+    int i;
+
+    qsort(ks->strs, ks->n, sizeof(char *), compare_strs);
+    for (i=0; i<ks->n; i++) {
+        p = isl_printer_print_str(p, ks->strs[i]);
+        p = isl_printer_print_str(p, "\n");
+        free(ks->strs[i]);
+    }
+    free(ks->strs);
+    ks->strs = NULL;
+    ks->n = 0;
+
+    return p;
+}
+
+
+#define KEY_OPTION(name) \
+    p = isl_printer_print_str(p, #name " "); \
+    p = isl_printer_print_int(p, options_l->name); \
+    p = isl_printer_print_str(p, "\n")
+
+/*
+ * Key of the schedule cache: each domain and dependence relation printed
+ * by isl and sorted (the order in which a union is traversed isn't
+ * canonical), the options that can change the schedule, and tile.sizes
+ * (read by pluto_tile from the working directory)
+ */
+static char *schedule_cache_key(isl_union_set *domains,
+        isl_union_map *dependences, const PlutoOptions *options_l)
+{
+    int c;
+    char *key;
+    FILE *fp;
+    isl_printer *p;
+    struct key_strs ks = {NULL, 0};
+
+    p = isl_printer_to_str(isl_union_set_get_ctx(domains));
+
+    isl_union_set_foreach_set(domains, &key_add_set, &ks);
+    p = key_print_strs(p, &ks);
+    p = isl_printer_print_str(p, "deps\n");
+    isl_union_map_foreach_map(dependences, &key_add_map, &ks);
+    p = key_print_strs(p, &ks);
+
+    KEY_OPTION(tile);
+    KEY_OPTION(intratileopt);
+    KEY_OPTION(lbtile);
+    KEY_OPTION(partlbtile);
+    KEY_OPTION(parallel);
+    KEY_OPTION(innerpar);
+    KEY_OPTION(rar);
+    KEY_OPTION(fuse);
+    KEY_OPTION(forceparallel);
+    KEY_OPTION(multipar);
+    KEY_OPTION(l2tile);
+    KEY_OPTION(ft);
+    KEY_OPTION(lt);
+    KEY_OPTION(identity);
+    KEY_OPTION(nodepbound);
+    KEY_OPTION(coeff_bound);
+    KEY_OPTION(pipsolve);
+    KEY_OPTION(islsolve);
+    KEY_OPTION(glpk);
+    KEY_OPTION(iss);
+    KEY_OPTION(flic);
+    KEY_OPTION(lpredun);
+    KEY_OPTION(cluster);
+
+    if (options_l->tile && (fp = fopen("tile.sizes", "r")) != NULL) {
+        char buf[2];
+        buf[1] = '\0';
+        p = isl_printer_print_str(p, "tile.sizes\n");
+        while ((c = fgetc(fp)) != EOF) {
+            buf[0] = c;
+            p = isl_printer_print_str(p, buf);
         }
+        fclose(fp);
+    }
+
+    key = isl_printer_get_str(p);
+    isl_printer_free(p);
+
+    return key;
+}
+
+
+/* 64-bit FNV-1a */
+static unsigned long long hash_str(const char *str)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (; *str; str++) {
+        hash ^= (unsigned char) *str;
+        hash *= 1099511628211ULL;
     }
 
-    if (options->parallel && !options->silent) {
-        int nploops;
-        Ploop **ploops = pluto_get_dom_parallel_loops(prog, &nploops);
-        printf("[pluto_mark_parallel] %d parallel loops\n", nploops);
-        pluto_loops_print(ploops, nploops);
-        printf("\n");
-        pluto_loops_free(ploops, nploops);
+    return hash;
+}
+
+
+struct set_param_ids_data {
+    isl_space *space;
+    isl_union_map *umap;
+};
+
+static int set_param_ids(__isl_take isl_map *map, void *user)
+{
+    int j;
+    struct set_param_ids_data *data = (struct set_param_ids_data *) user;
+
+    for (j=0; j<isl_space_dim(data->space, isl_dim_param); j++) {
+        isl_id *id = isl_space_get_dim_id(data->space, isl_dim_param, j);
+        map = isl_map_set_dim_id(map, isl_dim_param, j, id);
     }
+    data->umap = isl_union_map_union(data->umap, isl_union_map_from_map(map));
 
-    // pluto_stmts_print(stdout, prog->stmts, prog->nstmts);
+    return 0;
+}
 
-    /* Construct isl_union_map for pluto schedules */
-    isl_union_map *schedules = isl_union_map_empty(isl_space_copy(space));
-    for (i=0; i<prog->nstmts; i++) {
-        isl_basic_map *bmap;
-        isl_map *map;
-        Stmt *stmt = prog->stmts[i];
-        PlutoConstraints *sched = normalize_domain_schedule(stmt, prog);
-        // pluto_constraints_print(stdout, sched);
 
-        bmap = isl_basic_map_from_pluto_constraints(ctx, sched,
-                sched->ncols - stmt->trans->nrows - prog->npar - 1, 
-                stmt->trans->nrows, prog->npar);
-        bmap = isl_basic_map_project_out(bmap, isl_dim_in, 0, sched->ncols - stmt->trans->nrows - stmt->domain->ncols);
-        char name[20];
-        snprintf(name, sizeof(name), "S_%d", i);
-        map = isl_map_from_basic_map(bmap);
+/*
+ * Same as pluto_schedule, but the schedule is looked up in (and, if
+ * computed, added to) cache; on a hit, the schedule is rebuilt in the
+ * context of domains and pluto_auto_transform is not run. Like
+ * pluto_schedule_with_info, the band and loop information is returned in
+ * *info if info isn't NULL
+ */
+__isl_give isl_union_map *pluto_schedule_cached(PlutoScheduleCache *cache,
+        isl_union_set *domains, isl_union_map *dependences,
+        PlutoScheduleInfo **info, PlutoOptions *options_l)
+{
+    char *key, *str;
+    unsigned long long hash;
+    isl_ctx *ctx;
+    isl_printer *printer;
+    isl_union_map *schedules;
+    struct schedule_cache_entry *entry;
+    struct set_param_ids_data data;
+    PlutoScheduleInfo *sinfo;
 
-        /* Copy ids of the original parameter dimensions  */
-        for (j=0; j<isl_space_dim(space, isl_dim_param); j++) {
-            isl_id *id = isl_space_get_dim_id(space, isl_dim_param, j);
-            map = isl_map_set_dim_id(map, isl_dim_param, j, id);
-        }
+    /* global var */
+    pluto_options = options_l;
 
-        map = isl_map_set_tuple_name(map, isl_dim_in, name);
-        schedules = isl_union_map_union(schedules, isl_union_map_from_map(map));
+    ctx = isl_union_set_get_ctx(domains);
 
-        pluto_constraints_free(sched);
-    }
+    key = schedule_cache_key(domains, dependences, options_l);
+    hash = hash_str(key);
 
-    pluto_prog_free(prog);
-    isl_space_free(space);
+    pthread_mutex_lock(&cache->lock);
+    cache->num_lookups++;
+    entry = schedule_cache_find(cache, key, hash);
+    if (entry) {
+        cache->num_hits++;
+        str = strdup(entry->schedule);
+        sinfo = info? pluto_schedule_info_dup(entry->info): NULL;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (entry) {
+        IF_DEBUG(printf("[libpluto] schedule cache hit\n"););
+        free(key);
+
+        /* Parameter ids may carry user data that isl text doesn't */
+        data.space = isl_union_set_get_space(domains);
+        data.umap = isl_union_map_empty(isl_space_copy(data.space));
+        schedules = isl_union_map_read_from_str(ctx, str);
+        isl_union_map_foreach_map(schedules, &set_param_ids, &data);
+        isl_union_map_free(schedules);
+        isl_space_free(data.space);
+        free(str);
+
+        if (info) *info = sinfo;
+        return data.umap;
+    }
 
-    t_all = rtclock() - t_start;
+    schedules = pluto_schedule_with_info(domains, dependences, &sinfo,
+            options_l);
 
-    if (options->time && !options->silent) {
-        printf("[pluto] Auto-transformation time: %0.6lfs\n", t_t);
-        printf("[pluto] Other/Misc time: %0.6lfs\n", t_all-t_t);
-        printf("[pluto] Total time: %0.6lfs\n", t_all);
+    if (schedules == NULL) {
+        /* Failures aren't cached */
+        free(key);
+        if (info) *info = NULL;
+        return NULL;
     }
 
+    printer = isl_printer_to_str(ctx);
+    printer = isl_printer_print_union_map(printer, schedules);
+    str = isl_printer_get_str(printer);
+    isl_printer_free(printer);
+
+    if (info) *info = pluto_schedule_info_dup(sinfo);
+    schedule_cache_insert(cache, key, hash, str, sinfo);
+
     return schedules;
 }
 
@@ -391,7 +1098,7 @@ Remapping *pluto_get_remapping(isl_union_set *domains,
     prog->options = options_l;
 
     /* global var */
-    options = options_l;
+    pluto_options = options_l;
 
 
     prog->nvar = -1;
@@ -444,7 +1151,7 @@ Remapping *pluto_get_remapping(isl_union_set *domains,
         pluto_prog_free(prog);
         isl_space_free(space);
 
-        if (!options->silent) {
+        if (!pluto_options->silent) {
             printf("[libpluto] failure, returning NULL schedules\n");
         }
 
@@ -454,7 +1161,7 @@ Remapping *pluto_get_remapping(isl_union_set *domains,
     pluto_compute_dep_directions(prog);
     pluto_compute_dep_satisfaction(prog);
 
-    if (!options->silent) {
+    if (!pluto_options->silent) {
         fprintf(stdout, "[pluto] Affine transformations\n\n");
         /* Print out transformations */
         pluto_transformations_pretty_print(prog);
@@ -468,10 +1175,10 @@ Remapping *pluto_get_remapping(isl_union_set *domains,
     printf("Innermost tilable bands: %d bands\n", n_ibands);
     pluto_bands_print(ibands, n_ibands);
 
-    if (options->tile) {
+    if (pluto_options->tile) {
         pluto_tile(prog);
     }else{
-        if (options->intratileopt) {
+        if (pluto_options->intratileopt) {
             pluto_intra_tile_optimize(prog, 0);
         }
     }
@@ -509,10 +1216,10 @@ int pluto_schedule_osl(osl_scop_p scop,
   }
 
 
-  options = options_l;
+  pluto_options = options_l;
 
   /* Convert clan scop to Pluto program */
-  PlutoProg *prog = scop_to_pluto_prog(scop, options);
+  PlutoProg *prog = scop_to_pluto_prog(scop, pluto_options);
 
   int dim_sum=0;
   for (i=0; i<prog->nstmts; i++) {
@@ -520,22 +1227,22 @@ int pluto_schedule_osl(osl_scop_p scop,
   }
 
   /* Make options consistent */
-  if (options->multipar == 1 && options->parallel == 0)    {
+  if (pluto_options->multipar == 1 && pluto_options->parallel == 0)    {
       fprintf(stdout, "Warning: multipar needs parallel to be on; turning on parallel\n");
-      options->parallel = 1;
+      pluto_options->parallel = 1;
   }
 
   /* Disable pre-vectorization if tile is not on */
-  if (options->tile == 0 && options->prevector == 1) {
+  if (pluto_options->tile == 0 && pluto_options->prevector == 1) {
       /* If code will not be tiled, pre-vectorization does not make
        * sense */
-      if (!options->silent)   {
+      if (!pluto_options->silent)   {
           fprintf(stdout, "[Pluto] Warning: pre-vectorization does not fit (--tile is off)\n");
       }
-      options->prevector = 0;
+      pluto_options->prevector = 0;
   }
 
-  if (!options->silent)   {
+  if (!pluto_options->silent)   {
       fprintf(stdout, "[Pluto] Number of statements: %d\n", prog->nstmts);
       fprintf(stdout, "[Pluto] Total number of loops: %d\n", dim_sum);
       fprintf(stdout, "[Pluto] Number of deps: %d\n", prog->ndeps);
@@ -545,28 +1252,28 @@ int pluto_schedule_osl(osl_scop_p scop,
 
 
   /* Auto transformation */
-  if (!options->identity) {
+  if (!pluto_options->identity) {
       pluto_auto_transform(prog);
   }
 
   pluto_compute_dep_directions(prog);
   pluto_compute_dep_satisfaction(prog);
 
-  if (!options->silent)   {
+  if (!pluto_options->silent)   {
       fprintf(stdout, "[Pluto] Affine transformations [<iter coeff's> <const>]\n\n");
       /* Print out transformations */
       pluto_transformations_pretty_print(prog);
   }
 
-  if (options->tile)   {
+  if (pluto_options->tile)   {
       pluto_tile(prog);
   }else{
-      if (options->intratileopt) {
+      if (pluto_options->intratileopt) {
           pluto_intra_tile_optimize(prog, 0); 
       }
   }
 
-  if (options->parallel && !options->tile && !options->identity)   {
+  if (pluto_options->parallel && !pluto_options->tile && !pluto_options->identity)   {
       /* Obtain wavefront/pipelined parallelization by skewing if
        * necessary */
       int nbands;
@@ -587,7 +1294,7 @@ int pluto_schedule_osl(osl_scop_p scop,
 }
   }
 
-  if (options->unroll || options->polyunroll)    {
+  if (pluto_options->unroll || pluto_options->polyunroll)    {
       /* Will generate a .unroll file */
       /* plann/plorc needs a .params */
       FILE *paramsFP = fopen(".params", "w");
@@ -601,11 +1308,11 @@ int pluto_schedule_osl(osl_scop_p scop,
       pluto_detect_mark_unrollable_loops(prog);
   }
 
-  if (options->polyunroll)    {
+  if (pluto_options->polyunroll)    {
       /* Experimental */
       for (i=0; i<prog->num_hyperplanes; i++)   {
           if (prog->hProps[i].unroll)  {
-              unroll_phis(prog, i, options->ufactor);
+              unroll_phis(prog, i, pluto_options->ufactor);
           }
       }
   }
@@ -616,7 +1323,7 @@ int pluto_schedule_osl(osl_scop_p scop,
   /* Replace the osl_scop's original domains and scatterings
    * by ones newly created by pluto
    */
-  pluto_populate_scop (scop, prog, options);
+  pluto_populate_scop (scop, prog, pluto_options);
 
   pluto_prog_free(prog);
 
@@ -633,7 +1340,7 @@ __isl_give isl_union_map *pluto_parallel_schedule_with_remapping(isl_union_set *
         Remapping** remap,
         PlutoOptions *options_l)
 {
-    int i, j, nbands, n_ibands, retval;
+    int i, j;
     isl_ctx *ctx;
     isl_space *space;
     double t_t, t_all, t_start;
@@ -645,7 +1352,7 @@ __isl_give isl_union_map *pluto_parallel_schedule_with_remapping(isl_union_set *
     prog->options = options_l;
 
     /* global var */
-    options = options_l;
+    pluto_options = options_l;
 
 
     prog->nvar = -1;
@@ -692,70 +1399,16 @@ __isl_give isl_union_map *pluto_parallel_schedule_with_remapping(isl_union_set *
     IF_DEBUG(pluto_prog_print(stdout, prog););
 
     t_start = rtclock();
-    retval = pluto_auto_transform(prog);
-    t_t = rtclock() - t_start;
-
-    if (retval) {
+    if (libpluto_transform(prog, &t_t)) {
         /* Failure */
         pluto_prog_free(prog);
         isl_space_free(space);
-
-        if (!options->silent) {
-            printf("[libpluto] failure, returning NULL schedules\n");
-        }
-
         return NULL;
     }
 
-    pluto_compute_dep_directions(prog);
-    pluto_compute_dep_satisfaction(prog);
-
-    if (!options->silent) {
-        fprintf(stdout, "[pluto] Affine transformations\n\n");
-        /* Print out transformations */
-        pluto_transformations_pretty_print(prog);
-    }
-
-    Band **bands, **ibands;
-    bands = pluto_get_outermost_permutable_bands(prog, &nbands);
-    ibands = pluto_get_innermost_permutable_bands(prog, &n_ibands);
-    printf("Outermost tilable bands: %d bands\n", nbands);
-    pluto_bands_print(bands, nbands);
-    printf("Innermost tilable bands: %d bands\n", n_ibands);
-    pluto_bands_print(ibands, n_ibands);
-
-    if (options->tile) {
-        pluto_tile(prog);
-    }else{
-        if (options->intratileopt) {
-            pluto_intra_tile_optimize(prog, 0);
-        }
-    }
-
-    if ((options->parallel) && !options->tile && !options->identity)   {
-        /* Obtain wavefront/pipelined parallelization by skewing if
-         * necessary */
-        int nbands;
-        Band **bands;
-        pluto_compute_dep_satisfaction(prog);
-        bands = pluto_get_outermost_permutable_bands(prog, &nbands);
-        bool retval = pluto_create_tile_schedule(prog, bands, nbands);
-        pluto_bands_free(bands, nbands);
-
-        /* If the user hasn't supplied --tile and there is only pipelined
-         * parallelism, we will warn the user */
-        if (retval)   {
-            printf("[pluto] WARNING: pipelined parallelism exists and --tile is not used.\n");
-            printf("[pluto] WARNING: use --tile for better parallelization \n");
-            fprintf(stdout, "[pluto] After skewing:\n");
-            pluto_transformations_pretty_print(prog);
-            /* IF_DEBUG(pluto_print_hyperplane_properties(prog);); */
-        }
-    }
-
-    if (options->parallel) {
+    if (pluto_options->parallel) {
         *ploops = pluto_get_parallel_loops(prog, nploops);
-        if (!options->silent) {
+        if (!pluto_options->silent) {
             printf("[pluto_mark_parallel] %d parallel loops\n", *nploops);
             pluto_loops_print(*ploops, *nploops);
             printf("\n");
@@ -776,7 +1429,7 @@ __isl_give isl_union_map *pluto_parallel_schedule_with_remapping(isl_union_set *
     for(i = 0; i < prog->nstmts; i++) {
          remapping->stmt_inv_matrices[i] = pluto_stmt_get_remapping(prog->stmts[i],
                 &remapping->stmt_divs[i]);
-         if (!options->silent) {
+         if (!pluto_options->silent) {
              printf("[libpluto] Statement %d Id- %d\n", i, prog->stmts[i]->id);
              pluto_matrix_print(stdout, remapping->stmt_inv_matrices[i]);
          }
@@ -816,7 +1469,7 @@ __isl_give isl_union_map *pluto_parallel_schedule_with_remapping(isl_union_set *
 
     t_all = rtclock() - t_start;
 
-    if (options->time && !options->silent) {
+    if (pluto_options->time && !pluto_options->silent) {
         printf("[pluto] Auto-transformation time: %0.6lfs\n", t_t);
         printf("[pluto] Other/Misc time: %0.6lfs\n", t_all-t_t);
         printf("[pluto] Total time: %0.6lfs\n", t_all);
@@ -917,3 +1570,362 @@ void pluto_remapping_free(Remapping *remapping) {
 void pluto_schedules_strbuf_free(char *schedules_str_buffer) {
   free(schedules_str_buffer);
 }
+
+
+/* Reader of a flat buffer (see pluto_schedule_flat) */
+struct flat_reader {
+    const int64 *buf;
+    long len;
+    long pos;
+
+    /* Set when reading past the end or on an inconsistent value */
+    int error;
+};
+
+static int64 flat_get(struct flat_reader *r)
+{
+    if (r->pos >= r->len) {
+        r->error = 1;
+        return 0;
+    }
+    return r->buf[r->pos++];
+}
+
+/* Largest count or dimensionality accepted: sums of a few of them (the
+ * columns of a dependence polyhedron) still fit in an int */
+#define FLAT_MAX_COUNT (INT_MAX/4)
+
+/*
+ * A count of items that take at least words_per_item words each further on
+ * in the buffer, or, for words_per_item == 0, a dimensionality (at most the
+ * length of the buffer). Anything larger can't be backed by the buffer and
+ * is rejected before it is used to size allocations or loops
+ */
+static int flat_get_count(struct flat_reader *r, int words_per_item)
+{
+    int64 val = flat_get(r);
+    long left = r->len - r->pos;
+
+    if (r->error || val < 0 || val > FLAT_MAX_COUNT || val > r->len
+            || (words_per_item > 0 && val > left/words_per_item)) {
+        r->error = 1;
+        return 0;
+    }
+
+    return val;
+}
+
+
+/* A system of constraints of a flat buffer, with ncols columns expected */
+static PlutoConstraints *flat_get_constraints(struct flat_reader *r, int ncols)
+{
+    int i, j;
+    int64 nrows;
+    PlutoConstraints *cst;
+
+    nrows = flat_get(r);
+    if (r->error || flat_get(r) != ncols || nrows < 0 || nrows > INT_MAX
+            || nrows > (r->len - r->pos)/(ncols+1)) {
+        r->error = 1;
+        return NULL;
+    }
+
+    cst = pluto_constraints_alloc(PLMAX(1, nrows), ncols);
+    cst->nrows = nrows;
+    for (i=0; i<nrows; i++) {
+        cst->is_eq[i] = (flat_get(r) != 0);
+        for (j=0; j<ncols; j++) {
+            cst->val[i][j] = flat_get(r);
+        }
+    }
+
+    return cst;
+}
+
+
+static Stmt *flat_get_stmt(struct flat_reader *r, int id, PlutoProg *prog)
+{
+    int i, dim, npieces;
+    Stmt *stmt;
+    PlutoMatrix *trans;
+    PlutoConstraints *piece;
+
+    /* Each piece takes at least its nrows and ncols */
+    dim = flat_get_count(r, 0);
+    npieces = flat_get_count(r, 2);
+    if (r->error) return NULL;
+
+    trans = pluto_matrix_alloc(0, dim+prog->npar+1);
+    stmt = pluto_stmt_alloc(dim, NULL, trans);
+    pluto_matrix_free(trans);
+
+    stmt->type = ORIG;
+    stmt->id = id;
+
+    for (i=0; i<npieces && !r->error; i++) {
+        piece = flat_get_constraints(r, dim+prog->npar+1);
+        if (piece == NULL) break;
+        if (stmt->domain) {
+            stmt->domain = pluto_constraints_unionize_simple(stmt->domain, piece);
+            pluto_constraints_free(piece);
+        }else{
+            stmt->domain = piece;
+        }
+    }
+    if (stmt->domain == NULL) {
+        stmt->domain = pluto_constraints_empty(dim+prog->npar+1);
+    }
+
+    for (i=0; i<dim; i++) {
+        char *iter = malloc(5);
+        sprintf(iter, "i%d",  i);
+        stmt->iterators[i] = iter;
+        stmt->is_orig_loop[i] = true;
+    }
+    pluto_constraints_set_names_range(stmt->domain, stmt->iterators, 0, 0, dim);
+    pluto_constraints_set_names_range(stmt->domain, prog->params, dim, 0,
+            prog->npar);
+
+    return stmt;
+}
+
+
+static Dep *flat_get_dep(struct flat_reader *r, int id, PlutoProg *prog)
+{
+    int j, src_dim, dest_dim;
+    int64 src, dest;
+    Dep *dep;
+    Stmt **stmts = prog->stmts;
+
+    dep = pluto_dep_alloc();
+    dep->id = id;
+    dep->type = OSL_DEPENDENCE_RAW;
+    dep->dirvec = NULL;
+    dep->src_acc = NULL;
+    dep->dest_acc = NULL;
+    src = flat_get(r);
+    dest = flat_get(r);
+    if (r->error || src < 0 || src >= prog->nstmts
+            || dest < 0 || dest >= prog->nstmts) {
+        r->error = 1;
+        return dep;
+    }
+    dep->src = src;
+    dep->dest = dest;
+
+    src_dim = stmts[dep->src]->dim;
+    dest_dim = stmts[dep->dest]->dim;
+    dep->dpolytope = flat_get_constraints(r, src_dim+dest_dim+prog->npar+1);
+    if (dep->dpolytope == NULL) return dep;
+    dep->bounding_poly = pluto_constraints_dup(dep->dpolytope);
+    pluto_dep_detect_uniform(dep, stmts);
+
+    pluto_constraints_set_names_range(dep->dpolytope,
+            stmts[dep->src]->iterators, 0, 0, src_dim);
+    /* suffix the destination iterators with a '*/
+    char **dnames = malloc(PLMAX(1, dest_dim)*sizeof(char *));
+    for (j=0; j<dest_dim; j++) {
+        dnames[j] = malloc(strlen(stmts[dep->dest]->iterators[j])+2);
+        strcpy(dnames[j], stmts[dep->dest]->iterators[j]);
+        strcat(dnames[j], "'");
+    }
+    pluto_constraints_set_names_range(dep->dpolytope, dnames, src_dim, 0,
+            dest_dim);
+    for (j=0; j<dest_dim; j++) {
+        free(dnames[j]);
+    }
+    free(dnames);
+    pluto_constraints_set_names_range(dep->dpolytope, prog->params,
+            src_dim+dest_dim, 0, prog->npar);
+
+    return dep;
+}
+
+
+/* Build a PlutoProg from a flat input buffer; NULL if it's malformed */
+static PlutoProg *pluto_prog_from_flat(const int64 *buf)
+{
+    int i, nstmts, npar, ndeps;
+    struct flat_reader r = {buf, 0, 2, 0};
+    PlutoProg *prog;
+
+    if (buf[0] != PLUTO_FLAT_VERSION || buf[1] < 5) return NULL;
+    r.len = buf[1];
+
+    /* A statement takes at least dim and npieces, a dependence at least
+     * src, dest, nrows, and ncols */
+    nstmts = flat_get_count(&r, 2);
+    npar = flat_get_count(&r, 0);
+    ndeps = flat_get_count(&r, 4);
+    if (r.error) return NULL;
+
+    prog = pluto_prog_alloc();
+    prog->options = pluto_options;
+
+    prog->npar = npar;
+    prog->params = (char **) malloc(PLMAX(1, npar)*sizeof(char *));
+    for (i=0; i<npar; i++) {
+        char *param = malloc(5);
+        sprintf(param, "p%d", i);
+        prog->params[i] = param;
+    }
+
+    prog->nvar = -1;
+    prog->stmts = (nstmts >= 1)? (Stmt **) malloc(nstmts*sizeof(Stmt *)): NULL;
+    for (i=0; i<nstmts && !r.error; i++) {
+        prog->stmts[i] = flat_get_stmt(&r, i, prog);
+        if (prog->stmts[i] == NULL) break;
+        prog->nstmts++;
+        prog->nvar = PLMAX(prog->nvar, prog->stmts[i]->dim);
+    }
+
+    prog->deps = (Dep **) malloc(PLMAX(1, ndeps)*sizeof(Dep *));
+    for (i=0; i<ndeps && !r.error; i++) {
+        prog->deps[i] = flat_get_dep(&r, i, prog);
+        prog->ndeps++;
+    }
+
+    if (r.error || r.pos != r.len) {
+        pluto_prog_free(prog);
+        return NULL;
+    }
+
+    return prog;
+}
+
+
+/* Growable flat output buffer */
+struct flat_writer {
+    int64 *buf;
+    long len;
+    long alloc;
+};
+
+static void flat_put(struct flat_writer *w, int64 val)
+{
+    if (w->len == w->alloc) {
+        w->alloc = PLMAX(64, 2*w->alloc);
+        w->buf = (int64 *) realloc(w->buf, w->alloc*sizeof(int64));
+    }
+    w->buf[w->len++] = val;
+}
+
+static void flat_put_constraints(struct flat_writer *w,
+        const PlutoConstraints *cst)
+{
+    int i, j;
+
+    flat_put(w, cst->nrows);
+    flat_put(w, cst->ncols);
+    for (i=0; i<cst->nrows; i++) {
+        flat_put(w, cst->is_eq[i]);
+        for (j=0; j<cst->ncols; j++) {
+            flat_put(w, cst->val[i][j]);
+        }
+    }
+}
+
+
+/*
+ * pluto_schedule_str without isl: the domains and dependences are read
+ * from, and the schedules, remappings and parallel loops written to, flat
+ * int64 buffers (format in libpluto.h). Returns NULL if the input is
+ * malformed or no schedule is found; free the result with pluto_flat_free
+ */
+int64 *pluto_schedule_flat(const int64 *input, PlutoOptions *options_l)
+{
+    int i, j, nploops;
+    int *divs;
+    double t_t, t_all, t_start;
+    PlutoProg *prog;
+    PlutoMatrix *remap;
+    PlutoConstraints *sched;
+    Ploop **ploops;
+    struct flat_writer w = {NULL, 0, 0};
+
+    /* global var */
+    pluto_options = options_l;
+
+    prog = pluto_prog_from_flat(input);
+    if (prog == NULL) {
+        fprintf(stderr, "[libpluto] malformed flat input\n");
+        return NULL;
+    }
+
+    IF_DEBUG(pluto_prog_print(stdout, prog););
+
+    t_start = rtclock();
+    if (libpluto_transform(prog, &t_t)) {
+        pluto_prog_free(prog);
+        return NULL;
+    }
+
+    if (pluto_options->parallel) {
+        ploops = pluto_get_parallel_loops(prog, &nploops);
+    }else{
+        ploops = NULL;
+        nploops = 0;
+    }
+
+    flat_put(&w, PLUTO_FLAT_VERSION);
+    /* Length; set at the end */
+    flat_put(&w, 0);
+    flat_put(&w, prog->nstmts);
+    flat_put(&w, prog->npar);
+
+    for (i=0; i<prog->nstmts; i++) {
+        Stmt *stmt = prog->stmts[i];
+
+        /* Remapping is w.r.t the tiled domain; get it before the tile
+         * space dimensions are moved to the schedule */
+        remap = pluto_stmt_get_remapping(stmt, &divs);
+        sched = normalize_domain_schedule(stmt, prog);
+
+        flat_put(&w, stmt->trans->nrows);
+        flat_put(&w, sched->ncols - stmt->trans->nrows - stmt->domain->ncols);
+        flat_put_constraints(&w, sched);
+
+        flat_put(&w, remap->nrows);
+        flat_put(&w, remap->ncols);
+        for (j=0; j<remap->nrows; j++) {
+            flat_put(&w, divs[j]);
+        }
+        for (j=0; j<remap->nrows*remap->ncols; j++) {
+            flat_put(&w, remap->val[j/remap->ncols][j%remap->ncols]);
+        }
+
+        pluto_constraints_free(sched);
+        pluto_matrix_free(remap);
+        free(divs);
+    }
+
+    flat_put(&w, nploops);
+    for (i=0; i<nploops; i++) {
+        flat_put(&w, ploops[i]->depth);
+        flat_put(&w, ploops[i]->nstmts);
+        for (j=0; j<ploops[i]->nstmts; j++) {
+            flat_put(&w, ploops[i]->stmts[j]->id);
+        }
+    }
+    pluto_loops_free(ploops, nploops);
+
+    w.buf[1] = w.len;
+
+    pluto_prog_free(prog);
+
+    t_all = rtclock() - t_start;
+
+    if (pluto_options->time && !pluto_options->silent) {
+        printf("[pluto] Auto-transformation time: %0.6lfs\n", t_t);
+        printf("[pluto] Other/Misc time: %0.6lfs\n", t_all-t_t);
+        printf("[pluto] Total time: %0.6lfs\n", t_all);
+    }
+
+    return w.buf;
+}
+
+
+void pluto_flat_free(int64 *buf)
+{
+    free(buf);
+}
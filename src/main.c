@@ -43,13 +43,52 @@
 #include "math_support.h"
 #include "post_transform.h"
 #include "program.h"
+#include "profile.h"
+#include "cache.h"
 #include "version.h"
 
 #include "clan/clan.h"
 #include "candl/candl.h"
 #include "candl/scop.h"
 
-PlutoOptions *options;
+__thread PlutoOptions *pluto_options;
+
+
+/* Names of the output (.pluto.c) and .cloog files for srcFileName; the
+ * caller frees both */
+static void get_out_file_names(const char *srcFileName, char **outFileName,
+        char **cloogFileName)
+{
+    if (pluto_options->out_file == NULL)  {
+        /* Get basename, remove .c extension and append a new one */
+        char *basec, *bname;
+        basec = strdup(srcFileName);
+        bname = basename(basec);
+
+        /* max size when tiled.* */
+        *outFileName = malloc(strlen(bname)+strlen(".pluto.c")+1);
+        *cloogFileName = malloc(strlen(bname)+strlen(".pluto.cloog")+1);
+
+        if (strlen(bname) >= 2 && !strcmp(bname+strlen(bname)-2, ".c")) {
+            strncpy(*outFileName, bname, strlen(bname)-2);
+            strncpy(*cloogFileName, bname, strlen(bname)-2);
+            (*outFileName)[strlen(bname)-2] = '\0';
+            (*cloogFileName)[strlen(bname)-2] = '\0';
+        }else{
+            strcpy(*outFileName, bname);
+            strcpy(*cloogFileName, bname);
+        }
+        strcat(*outFileName, ".pluto.c");
+        free(basec);
+    }else{
+        *outFileName = strdup(pluto_options->out_file);
+        *cloogFileName = malloc(strlen(pluto_options->out_file)+strlen(".pluto.cloog")+1);
+        strcpy(*cloogFileName, pluto_options->out_file);
+    }
+
+    strcat(*cloogFileName, ".pluto.cloog");
+}
+
 
 void usage_message(void)
 {
@@ -61,6 +100,7 @@ void usage_message(void)
     fprintf(stdout, "                                 (disabled by default)\n");
     fprintf(stdout, "       --islsolve [default]      Use ISL as ILP solver (default)\n");
     fprintf(stdout, "       --pipsolve                Use PIP as ILP solver\n");
+    fprintf(stdout, "       --portfolio               Race ISL and PIP on each scheduling ILP; take the first answer\n");
 #ifdef GLPK
     fprintf(stdout, "       --glpk                    Use GLPK as ILP solver\n");
 #endif
@@ -83,6 +123,8 @@ void usage_message(void)
     fprintf(stdout, "       --nofuse                  Do not fuse across SCCs of data dependence graph\n");
     fprintf(stdout, "       --maxfuse                 Maximal fusion\n");
     fprintf(stdout, "       --smartfuse [default]     Heuristic (in between nofuse and maxfuse)\n");
+    fprintf(stdout, "       --cluster                 Schedule statements of a loop body with identical domains together\n");
+    fprintf(stdout, "                                 (smaller ILP; disabled by default)\n");
     fprintf(stdout, "\n   Index Set Splitting        \n");
     fprintf(stdout, "       --iss                  \n");
     fprintf(stdout, "\n   Code generation       Options to control Cloog code generation\n");
@@ -95,6 +137,16 @@ void usage_message(void)
     fprintf(stdout, "       --ufactor=<factor>        Unroll-jam factor (default is 8)\n");
     fprintf(stdout, "       --forceparallel=<bitvec>  6 bit-vector of depths (1-indexed) to force parallel (0th bit represents depth 1)\n");
     fprintf(stdout, "       --readscop                Read input from a scoplib file\n");
+    fprintf(stdout, "       --threads=<n>             Use <n> threads to build dependence constraints and solve\n");
+    fprintf(stdout, "                                 independent parts of the scheduling ILP (the latter only\n");
+    fprintf(stdout, "                                 with --islsolve; default is 1)\n");
+    fprintf(stdout, "       --lpredun                 Remove redundant constraints with LP while applying Farkas lemma (disabled by default)\n");
+    fprintf(stdout, "       --presolve                Presolve the scheduling ILP before each solve (disabled by default)\n");
+    fprintf(stdout, "       --profile=<file>          Write a compile-time profile (phase times, solver calls) to <file> as JSON\n");
+    fprintf(stdout, "       --capture-ilp=<dir>       Write every ILP lexmin and emptiness query to a file in <dir> (see ilp_bench)\n");
+    fprintf(stdout, "       --cache-dir=<dir>         Reuse transformations found in earlier runs on the same input from <dir>\n");
+    fprintf(stdout, "       --cache-output            With --cache-dir, also reuse the generated code verbatim\n");
+    fprintf(stdout, "                                 (ignored with --unroll, --polyunroll, --prevector)\n");
     fprintf(stdout, "       --bee                     Generate pragmas for Bee+Cl@k\n\n");
     fprintf(stdout, "       --indent  | -i            Indent generated code (disabled by default)\n");
     fprintf(stdout, "       --silent  | -q            Silent mode; no output as long as everything goes fine (disabled by default)\n");
@@ -142,76 +194,85 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    options = pluto_options_alloc();
+    pluto_options = pluto_options_alloc();
 
-    const struct option pluto_options[] =
+    const struct option long_options[] =
     {
-        {"fast-lin-ind-check", no_argument, &options->flic, 1},
-        {"flic", no_argument, &options->flic, 1},
-        {"tile", no_argument, &options->tile, 1},
-        {"notile", no_argument, &options->tile, 0},
-        {"intratileopt", no_argument, &options->intratileopt, 1},
-        {"nointratileopt", no_argument, &options->intratileopt, 0},
-        {"lbtile", no_argument, &options->lbtile, 1},
-        {"diamond-tile", no_argument, &options->lbtile, 1},
-        {"part-diamond-tile", no_argument, &options->partlbtile, 1},
-        {"partlbtile", no_argument, &options->partlbtile, 1},
-        {"debug", no_argument, &options->debug, true},
-        {"moredebug", no_argument, &options->moredebug, true},
-        {"rar", no_argument, &options->rar, 1},
-        {"identity", no_argument, &options->identity, 1},
-        {"nofuse", no_argument, &options->fuse, NO_FUSE},
-        {"maxfuse", no_argument, &options->fuse, MAXIMAL_FUSE},
-        {"smartfuse", no_argument, &options->fuse, SMART_FUSE},
-        {"parallel", no_argument, &options->parallel, 1},
-        {"parallelize", no_argument, &options->parallel, 1},
-        {"innerpar", no_argument, &options->innerpar, 1},
-        {"iss", no_argument, &options->iss, 1},
-        {"unroll", no_argument, &options->unroll, 1},
-        {"nounroll", no_argument, &options->unroll, 0},
-        {"polyunroll", no_argument, &options->polyunroll, 1},
-        {"bee", no_argument, &options->bee, 1},
+        {"fast-lin-ind-check", no_argument, &pluto_options->flic, 1},
+        {"flic", no_argument, &pluto_options->flic, 1},
+        {"tile", no_argument, &pluto_options->tile, 1},
+        {"notile", no_argument, &pluto_options->tile, 0},
+        {"intratileopt", no_argument, &pluto_options->intratileopt, 1},
+        {"nointratileopt", no_argument, &pluto_options->intratileopt, 0},
+        {"lbtile", no_argument, &pluto_options->lbtile, 1},
+        {"diamond-tile", no_argument, &pluto_options->lbtile, 1},
+        {"part-diamond-tile", no_argument, &pluto_options->partlbtile, 1},
+        {"partlbtile", no_argument, &pluto_options->partlbtile, 1},
+        {"debug", no_argument, &pluto_options->debug, true},
+        {"moredebug", no_argument, &pluto_options->moredebug, true},
+        {"rar", no_argument, &pluto_options->rar, 1},
+        {"identity", no_argument, &pluto_options->identity, 1},
+        {"nofuse", no_argument, &pluto_options->fuse, NO_FUSE},
+        {"maxfuse", no_argument, &pluto_options->fuse, MAXIMAL_FUSE},
+        {"smartfuse", no_argument, &pluto_options->fuse, SMART_FUSE},
+        {"parallel", no_argument, &pluto_options->parallel, 1},
+        {"parallelize", no_argument, &pluto_options->parallel, 1},
+        {"innerpar", no_argument, &pluto_options->innerpar, 1},
+        {"iss", no_argument, &pluto_options->iss, 1},
+        {"unroll", no_argument, &pluto_options->unroll, 1},
+        {"nounroll", no_argument, &pluto_options->unroll, 0},
+        {"polyunroll", no_argument, &pluto_options->polyunroll, 1},
+        {"bee", no_argument, &pluto_options->bee, 1},
         {"ufactor", required_argument, 0, 'u'},
-        {"prevector", no_argument, &options->prevector, 1},
-        {"noprevector", no_argument, &options->prevector, 0},
+        {"prevector", no_argument, &pluto_options->prevector, 1},
+        {"noprevector", no_argument, &pluto_options->prevector, 0},
         {"codegen-context", required_argument, 0, 'c'},
         {"coeff-bound", required_argument, 0, 'C'},
         {"cloogf", required_argument, 0, 'F'},
         {"cloogl", required_argument, 0, 'L'},
-        {"cloogsh", no_argument, &options->cloogsh, 1},
-        {"nocloogbacktrack", no_argument, &options->cloogbacktrack, 0},
+        {"cloogsh", no_argument, &pluto_options->cloogsh, 1},
+        {"nocloogbacktrack", no_argument, &pluto_options->cloogbacktrack, 0},
         {"forceparallel", required_argument, 0, 'p'},
         {"ft", required_argument, 0, 'f'},
         {"lt", required_argument, 0, 'l'},
-        {"multipar", no_argument, &options->multipar, 1},
-        {"l2tile", no_argument, &options->l2tile, 1},
+        {"multipar", no_argument, &pluto_options->multipar, 1},
+        {"l2tile", no_argument, &pluto_options->l2tile, 1},
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {"indent", no_argument, 0, 'i'},
-        {"silent", no_argument, &options->silent, 1},
-        {"lastwriter", no_argument, &options->lastwriter, 1},
+        {"silent", no_argument, &pluto_options->silent, 1},
+        {"lastwriter", no_argument, &pluto_options->lastwriter, 1},
         {"nolastwriter", no_argument, &nolastwriter, 1},
-        {"nodepbound", no_argument, &options->nodepbound, 1},
-        {"scalpriv", no_argument, &options->scalpriv, 1},
-        {"isldep", no_argument, &options->isldep, 1},
-        {"candldep", no_argument, &options->candldep, 1},
-        {"isldepaccesswise", no_argument, &options->isldepaccesswise, 1},
-        {"isldepstmtwise", no_argument, &options->isldepaccesswise, 0},
-        {"noisldepcoalesce", no_argument, &options->isldepcoalesce, 0},
-        {"readscop", no_argument, &options->readscop, 1},
-        {"pipsolve", no_argument, &options->pipsolve, 1},
+        {"nodepbound", no_argument, &pluto_options->nodepbound, 1},
+        {"scalpriv", no_argument, &pluto_options->scalpriv, 1},
+        {"isldep", no_argument, &pluto_options->isldep, 1},
+        {"candldep", no_argument, &pluto_options->candldep, 1},
+        {"isldepaccesswise", no_argument, &pluto_options->isldepaccesswise, 1},
+        {"isldepstmtwise", no_argument, &pluto_options->isldepaccesswise, 0},
+        {"noisldepcoalesce", no_argument, &pluto_options->isldepcoalesce, 0},
+        {"readscop", no_argument, &pluto_options->readscop, 1},
+        {"pipsolve", no_argument, &pluto_options->pipsolve, 1},
 #ifdef GLPK
-        {"glpk", no_argument, &options->glpk, 1},
+        {"glpk", no_argument, &pluto_options->glpk, 1},
 #endif
-        {"islsolve", no_argument, &options->islsolve, 1},
-        {"time", no_argument, &options->time, 1},
+        {"islsolve", no_argument, &pluto_options->islsolve, 1},
+        {"time", no_argument, &pluto_options->time, 1},
+        {"threads", required_argument, 0, 'T'},
+        {"lpredun", no_argument, &pluto_options->lpredun, 1},
+        {"presolve", no_argument, &pluto_options->presolve, 1},
+        {"portfolio", no_argument, &pluto_options->portfolio, 1},
+        {"cluster", no_argument, &pluto_options->cluster, 1},
+        {"profile", required_argument, 0, 'P'},
+        {"capture-ilp", required_argument, 0, 'I'},
+        {"cache-dir", required_argument, 0, 'K'},
+        {"cache-output", no_argument, &pluto_options->cache_output, 1},
         {0, 0, 0, 0}
     };
 
 
     /* Read command-line options */
     while (1) {
-        option = getopt_long(argc, argv, "bhiqvf:l:F:L:c:o:", pluto_options,
+        option = getopt_long(argc, argv, "bhiqvf:l:F:L:c:o:", long_options,
                 &option_index);
 
         if (option == -1)   {
@@ -222,20 +283,20 @@ int main(int argc, char *argv[])
             case 0:
                 break;
             case 'F':
-                options->cloogf = atoi(optarg);
+                pluto_options->cloogf = atoi(optarg);
                 break;
             case 'L':
-                options->cloogl = atoi(optarg);
+                pluto_options->cloogl = atoi(optarg);
                 break;
             case 'b':
-                options->bee = 1;
+                pluto_options->bee = 1;
                 break;
             case 'c':
-                options->codegen_context = atoi(optarg);
+                pluto_options->codegen_context = atoi(optarg);
                 break;
             case 'C':
-                options->coeff_bound = atoi(optarg);
-                if (options->coeff_bound <= 0) {
+                pluto_options->coeff_bound = atoi(optarg);
+                if (pluto_options->coeff_bound <= 0) {
                     printf("ERROR: coeff-bound should be at least 1\n");
                     return 2;
                 }
@@ -243,7 +304,7 @@ int main(int argc, char *argv[])
             case 'd':
                 break;
             case 'f':
-                options->ft = atoi(optarg);
+                pluto_options->ft = atoi(optarg);
                 break;
             case 'g':
                 break;
@@ -254,36 +315,52 @@ int main(int argc, char *argv[])
                 /* Handled in polycc */
                 break;
             case 'l':
-                options->lt = atoi(optarg);
+                pluto_options->lt = atoi(optarg);
                 break;
             case 'm':
                 break;
             case 'n':
                 break;
             case 'o':
-                options->out_file = strdup(optarg);
+                pluto_options->out_file = strdup(optarg);
                 break;
             case 'p':
-                options->forceparallel = atoi(optarg);
+                pluto_options->forceparallel = atoi(optarg);
+                break;
+            case 'P':
+                pluto_options->profile = strdup(optarg);
+                break;
+            case 'I':
+                pluto_options->ilp_capture_dir = strdup(optarg);
+                break;
+            case 'K':
+                pluto_options->cache_dir = strdup(optarg);
                 break;
             case 'q':
-                options->silent = 1;
+                pluto_options->silent = 1;
                 break;
             case 's':
                 break;
+            case 'T':
+                pluto_options->nthreads = atoi(optarg);
+                if (pluto_options->nthreads <= 0) {
+                    printf("ERROR: threads should be at least 1\n");
+                    return 2;
+                }
+                break;
             case 'u':
-                options->ufactor = atoi(optarg);
+                pluto_options->ufactor = atoi(optarg);
                 break;
             case 'v':
                 printf("PLUTO version %s - An automatic parallelizer and locality optimizer\n\
 Copyright (C) 2007--2015  Uday Bondhugula\n\
 This is free software; see the source for copying conditions.  There is NO\n\
 warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n", PLUTO_VERSION);
-                pluto_options_free(options);
+                pluto_options_free(pluto_options);
                 return 3;
             default:
                 usage_message();
-                pluto_options_free(options);
+                pluto_options_free(pluto_options);
                 return 4;
         }
     }
@@ -294,57 +371,57 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
     }else{
         /* No non-option argument was specified */
         usage_message();
-        pluto_options_free(options);
+        pluto_options_free(pluto_options);
         return 5;
     }
 
     /* Make options consistent */
-    if (options->isldep && options->candldep) {
+    if (pluto_options->isldep && pluto_options->candldep) {
         printf("[pluto] ERROR: only one of isldep and candldep should be specified)\n");
-        pluto_options_free(options);
+        pluto_options_free(pluto_options);
         usage_message();
         return 1;
     }
 
     /* isldep is the default */
-    if (!options->isldep && !options->candldep) {
-        options->isldep = 1;
+    if (!pluto_options->isldep && !pluto_options->candldep) {
+        pluto_options->isldep = 1;
     }
 
-    if (options->lastwriter && options->candldep) {
+    if (pluto_options->lastwriter && pluto_options->candldep) {
         printf("[pluto] ERROR: --lastwriter is only supported with --isldep\n");
-        pluto_options_free(options);
+        pluto_options_free(pluto_options);
         usage_message();
         return 1;
     }
 
-    if (options->lastwriter && nolastwriter) {
+    if (pluto_options->lastwriter && nolastwriter) {
         printf("[pluto] WARNING: both --lastwriter, --nolastwriter are on\n");
         printf("[pluto] disabling --lastwriter\n");
-        options->lastwriter = 0;
+        pluto_options->lastwriter = 0;
     }
 
-    if (options->identity == 1) {
-        options->partlbtile = 0;
-        options->lbtile = 0;
+    if (pluto_options->identity == 1) {
+        pluto_options->partlbtile = 0;
+        pluto_options->lbtile = 0;
     }
 
-    if (options->partlbtile == 1 && options->lbtile == 0)    {
-        options->lbtile = 1;
+    if (pluto_options->partlbtile == 1 && pluto_options->lbtile == 0)    {
+        pluto_options->lbtile = 1;
     }
 
-    if (options->lbtile == 1 && options->tile == 0)    {
-        options->tile = 1;
+    if (pluto_options->lbtile == 1 && pluto_options->tile == 0)    {
+        pluto_options->tile = 1;
     }
 
-    if (options->multipar == 1 && options->parallel == 0)    {
+    if (pluto_options->multipar == 1 && pluto_options->parallel == 0)    {
         fprintf(stdout, "Warning: multipar needs parallel to be on; turning on parallel\n");
-        options->parallel = 1;
+        pluto_options->parallel = 1;
     }
 
-    if (options->multipar == 1 && options->parallel == 0)    {
+    if (pluto_options->multipar == 1 && pluto_options->parallel == 0)    {
         fprintf(stdout, "Warning: multipar needs parallel to be on; turning on parallel\n");
-        options->parallel = 1;
+        pluto_options->parallel = 1;
     }
 
 
@@ -367,13 +444,13 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
 
       if (!src_fp)   {
           fprintf(stderr, "pluto: error opening source file: '%s'\n", srcFileName);
-          pluto_options_free(options);
+          pluto_options_free(pluto_options);
           return 6;
       }
 
       clan_options_p clanOptions = clan_options_malloc();
 
-      if (options->readscop){
+      if (pluto_options->readscop){
           osl_interface_p registry = osl_interface_get_default_registry();
           t_start = rtclock();
           scop = osl_scop_pread(src_fp, registry, PLUTO_OSL_PRECISION);
@@ -387,7 +464,7 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
       if (!scop || !scop->statement)   {
           fprintf(stderr, "Error extracting polyhedra from source file: \'%s'\n",
                   srcFileName);
-          pluto_options_free(options);
+          pluto_options_free(pluto_options);
           return 8;
       }
       FILE *srcfp = fopen(".srcfilename", "w");
@@ -401,8 +478,48 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
       /* IF_DEBUG(clan_scop_print_dot_scop(stdout, scop, clanOptions)); */
     }
 
+    pluto_profile_add_phase("scop_extraction", t_d);
+
+    char *outFileName = NULL, *cloogFileName = NULL;
+    if (strcmp(srcFileName, "stdin")) {
+        get_out_file_names(srcFileName, &outFileName, &cloogFileName);
+    }
+
+    /* Only the output file is cached; the .unroll and .params files written
+     * for plorc with these options would be missing or stale on a hit */
+    if (pluto_options->cache_output && (pluto_options->unroll
+                || pluto_options->polyunroll || pluto_options->prevector)) {
+        IF_DEBUG(printf("[pluto] --cache-output disabled with --unroll/--polyunroll/--prevector\n"););
+        pluto_options->cache_output = 0;
+    }
+
+    /* Key of this input in the cache */
+    PlutoCacheKey cache_key_s, *cache_key = NULL;
+    if (pluto_options->cache_dir
+            && pluto_cache_key(scop, pluto_options, &cache_key_s) == 0) {
+        cache_key = &cache_key_s;
+    }
+
+    if (cache_key && pluto_options->cache_output && outFileName
+            && pluto_cache_restore_output(cache_key, outFileName)) {
+        /* Nothing else to do */
+        FILE *tmpfp = fopen(".outfilename", "w");
+        if (tmpfp)    {
+            fprintf(tmpfp, "%s\n", outFileName);
+            fclose(tmpfp);
+        }
+        PLUTO_MESSAGE(printf("[pluto] Output reused from cache; written to %s\n",
+                    outFileName););
+        pluto_cache_key_clear(cache_key);
+        free(outFileName);
+        free(cloogFileName);
+        pluto_options_free(pluto_options);
+        osl_scop_free(scop);
+        return 0;
+    }
+
     /* Convert clan scop to Pluto program */
-    prog = scop_to_pluto_prog(scop, options);
+    prog = scop_to_pluto_prog(scop, pluto_options);
 
     /* Backup irregular program portion in .scop. */
     osl_irregular_p irreg_ext = NULL;
@@ -419,7 +536,7 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
     }
 
    
-    if (!options->silent)   {
+    if (!pluto_options->silent)   {
         fprintf(stdout, "[pluto] Number of statements: %d\n", prog->nstmts);
         fprintf(stdout, "[pluto] Total number of loops: %d\n", dim_sum);
         fprintf(stdout, "[pluto] Number of deps: %d\n", prog->ndeps);
@@ -427,7 +544,7 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
         fprintf(stdout, "[pluto] Number of parameters: %d\n", prog->npar);
     }
 
-    if (options->iss) {
+    if (pluto_options->iss) {
         // PlutoConstraints *dom = pluto_constraints_read(stdin);
         // printf("Input set\n");
         // pluto_constraints_compact_print(stdout, dom);
@@ -445,31 +562,41 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
     }
 
     t_start = rtclock();
-    /* Auto transformation */
-    if (!options->identity) {
-        pluto_auto_transform(prog);
+    /* Auto transformation; the cached transformation is for the statements
+     * of the input, and so isn't used once ISS has split them */
+    if (!pluto_options->identity) {
+        int use_cache = cache_key && !pluto_options->iss;
+        if (use_cache && pluto_cache_restore_schedule(prog, cache_key)) {
+            PLUTO_MESSAGE(printf("[pluto] Transformation reused from cache\n"););
+        }else{
+            pluto_auto_transform(prog);
+            if (use_cache) pluto_cache_store_schedule(prog, cache_key);
+        }
     }
     t_t = rtclock() - t_start;
+    pluto_profile_add_phase("auto_transform", t_t);
 
     pluto_compute_dep_directions(prog);
     pluto_compute_dep_satisfaction(prog);
 
-    if (!options->silent)   {
+    if (!pluto_options->silent)   {
         fprintf(stdout, "[pluto] Affine transformations [<iter coeff's> <param> <const>]\n\n");
         /* Print out transformations */
         pluto_transformations_pretty_print(prog);
         /* pluto_print_hyperplane_properties(prog); */
     }
 
-    if (options->tile)   {
+    if (pluto_options->tile)   {
+        t_start = rtclock();
         pluto_tile(prog);
+        pluto_profile_add_phase("tiling", rtclock() - t_start);
     }else{
-        if (options->intratileopt) {
+        if (pluto_options->intratileopt) {
             pluto_intra_tile_optimize(prog, 0);
         }
     }
 
-    if (options->parallel && !options->tile && !options->identity)   {
+    if (pluto_options->parallel && !pluto_options->tile && !pluto_options->identity)   {
         /* Obtain wavefront/pipelined parallelization by skewing if
          * necessary */
         int nbands;
@@ -489,7 +616,7 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
         }
     }
 
-    if (options->unroll || options->polyunroll)    {
+    if (pluto_options->unroll || pluto_options->polyunroll)    {
         /* Will generate a .unroll file */
         /* plann/plorc needs a .params */
         FILE *paramsFP = fopen(".params", "w");
@@ -503,18 +630,18 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
         pluto_detect_mark_unrollable_loops(prog);
     }
 
-    if (options->polyunroll)    {
+    if (pluto_options->polyunroll)    {
         /* Experimental */
         for (i=0; i<prog->num_hyperplanes; i++)   {
             if (prog->hProps[i].unroll)  {
-                unroll_phis(prog, i, options->ufactor);
+                unroll_phis(prog, i, pluto_options->ufactor);
             }
         }
     }
 
     if(!strcmp(srcFileName, "stdin")){  
         //input stdin == output stdout
-        pluto_populate_scop(scop, prog, options);
+        pluto_populate_scop(scop, prog, pluto_options);
         osl_scop_print(stdout, scop);
     }else{  // do the usual Pluto stuff
   
@@ -524,69 +651,45 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
        * performed, changed loop order/iterator names will be missed  */
       gen_unroll_file(prog);
   
-      char *outFileName;
-      char *cloogFileName;
-      if (options->out_file == NULL)  {
-          /* Get basename, remove .c extension and append a new one */
-          char *basec, *bname;
-          basec = strdup(srcFileName);
-          bname = basename(basec);
-  
-          /* max size when tiled.* */
-          outFileName = alloca(strlen(bname)+strlen(".pluto.c")+1);
-          cloogFileName = alloca(strlen(bname)+strlen(".pluto.cloog")+1);
-  
-          if (strlen(bname) >= 2 && !strcmp(bname+strlen(bname)-2, ".c")) {
-              strncpy(outFileName, bname, strlen(bname)-2);
-              strncpy(cloogFileName, bname, strlen(bname)-2);
-              outFileName[strlen(bname)-2] = '\0';
-              cloogFileName[strlen(bname)-2] = '\0';
-          }else{
-              strcpy(outFileName, bname);
-              strcpy(cloogFileName, bname);
+      /* The CLooG input is built in memory; a .cloog file is only written
+       * for debugging, or when clan's <irregular> tag has to be passed on
+       * (only CLooG's file reader understands it) */
+      cloogfp = NULL;
+      if (pluto_options->debug || pluto_options->moredebug || irroption != NULL) {
+          cloogfp = fopen(cloogFileName, "w+");
+          if (!cloogfp)   {
+              fprintf(stderr, "[Pluto] Can't open .cloog file: '%s'\n", cloogFileName);
+              pluto_options_free(pluto_options);
+              pluto_prog_free(prog);
+              return 9;
           }
-          strcat(outFileName, ".pluto.c");
-          free(basec);
-      }else{
-          outFileName = options->out_file;
-          cloogFileName = alloca(strlen(options->out_file)+1);
-          strcpy(cloogFileName, options->out_file);
-      }
-  
-      strcat(cloogFileName, ".pluto.cloog");
-  
-      cloogfp = fopen(cloogFileName, "w+");
-      if (!cloogfp)   {
-          fprintf(stderr, "[Pluto] Can't open .cloog file: '%s'\n", cloogFileName);
-          pluto_options_free(options);
-          pluto_prog_free(prog);
-          return 9;
       }
   
       outfp = fopen(outFileName, "w");
       if (!outfp) {
           fprintf(stderr, "[Pluto] Can't open file '%s' for writing\n", outFileName);
-          pluto_options_free(options);
+          pluto_options_free(pluto_options);
           pluto_prog_free(prog);
-          fclose(cloogfp);
+          if (cloogfp) fclose(cloogfp);
           return 10;
       }
   
-      /* Generate .cloog file */
-      pluto_gen_cloog_file(cloogfp, prog);
-      /* Add the <irregular> tag from clan, if any */
-      if (irroption != NULL) {
-          fprintf(cloogfp, "<irregular>\n%s\n</irregular>\n\n", irroption);
-          free(irroption);
+      if (cloogfp) {
+          /* Generate .cloog file */
+          pluto_gen_cloog_file(cloogfp, prog);
+          /* Add the <irregular> tag from clan, if any */
+          if (irroption != NULL) {
+              fprintf(cloogfp, "<irregular>\n%s\n</irregular>\n\n", irroption);
+          }
+          rewind(cloogfp);
       }
   
-      rewind(cloogfp);
-  
-  
       /* Generate code using Cloog and add necessary stuff before/after code */
       t_start = rtclock();
-      pluto_multicore_codegen(cloogfp, outfp, prog);
+      pluto_multicore_codegen(irroption != NULL? cloogfp: NULL, outfp, prog);
+      free(irroption);
       t_c = rtclock() - t_start;
+      pluto_profile_add_phase("codegen", t_c);
   
       FILE *tmpfp = fopen(".outfilename", "w");
       if (tmpfp)    {
@@ -595,26 +698,68 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n"
           PLUTO_MESSAGE(printf( "[Pluto] Output written to %s\n", outFileName););
       }
   
-      fclose(cloogfp);
+      if (cloogfp) fclose(cloogfp);
       fclose(outfp);
 
+      if (cache_key && pluto_options->cache_output) {
+          pluto_cache_store_output(cache_key, outFileName);
+      }
+
     }
 
 
     t_all = rtclock() - t_start_all;
 
-    if (options->time && !options->silent) {
+    if (pluto_options->time && !pluto_options->silent) {
+        PlutoFMStats fm_stats = prog->solver->fm_stats;
+
         printf("\n[pluto] Timing statistics\n[pluto] SCoP extraction + dependence analysis time: %0.6lfs\n", t_d);
         printf("[pluto] Auto-transformation time: %0.6lfs\n", t_t);
         printf("[pluto] Code generation time: %0.6lfs\n", t_c);
         printf("[pluto] Other/Misc time: %0.6lfs\n", t_all-t_c-t_t-t_d);
         printf("[pluto] Total time: %0.6lfs\n", t_all);
+        printf("[pluto] Solver calls: %ld (emptiness: %ld, lexmin: %ld, min/max: %ld)\n",
+                pluto_solver_session_num_calls(prog->solver),
+                prog->solver->num_is_empty_calls, prog->solver->num_lexmin_calls,
+                prog->solver->num_range_calls);
+        printf("[pluto] Lexmin calls on a reused base system: %ld\n",
+                prog->solver->num_base_hits);
+        if (pluto_options->portfolio) {
+            printf("[pluto] Portfolio: %ld answered by ISL, %ld by PIP\n",
+                    prog->solver->num_isl_wins, prog->solver->num_pip_wins);
+        }
+        printf("[pluto] Farkas cache hits: %ld/%ld (%0.1lf%%)\n",
+                prog->farkas_cache->num_hits, prog->farkas_cache->num_lookups,
+                prog->farkas_cache->num_lookups?
+                100.0*prog->farkas_cache->num_hits/prog->farkas_cache->num_lookups: 0.0);
+        printf("[pluto] FM eliminations: %ld (peak rows: %d, %0.2lfus/elimination; rows dropped: %ld Imbert, %ld LP)\n",
+                fm_stats.num_elims, fm_stats.peak_rows,
+                fm_stats.num_elims? 1e6*fm_stats.time/fm_stats.num_elims: 0.0,
+                fm_stats.num_imbert_dropped, fm_stats.num_lp_dropped);
         printf("[pluto] All times: %0.6lf %0.6lf %.6lf %.6lf\n", t_d, t_t, t_c,
              t_all-t_c-t_t-t_d);
     }
 
+    if (pluto_options->profile) {
+        FILE *proffp = fopen(pluto_options->profile, "w");
+        if (proffp) {
+            pluto_profile_add_phase("total", t_all);
+            pluto_profile_print_json(proffp, &prog->solver->fm_stats);
+            fclose(proffp);
+            PLUTO_MESSAGE(printf("[pluto] Profile written to %s\n", pluto_options->profile););
+        }else{
+            fprintf(stderr, "[pluto] WARNING: can't open profile file: '%s'\n",
+                    pluto_options->profile);
+        }
+        pluto_profile_free();
+    }
+
+    if (cache_key) pluto_cache_key_clear(cache_key);
+    free(outFileName);
+    free(cloogFileName);
+
     pluto_prog_free(prog);
-    pluto_options_free(options);
+    pluto_options_free(pluto_options);
 
     osl_scop_free(scop);
 
@@ -33,6 +33,7 @@
 #include "program.h"
 #include "transforms.h"
 #include "ddg.h"
+#include "profile.h"
 #include "version.h"
 
 /* Iterative search modes */
@@ -40,7 +41,6 @@
 #define LAZY 1
 
 int dep_satisfaction_update(PlutoProg *prog, int level);
-bool dep_satisfaction_test(Dep *dep, PlutoProg *prog, int level);
 
 int get_num_unsatisfied_deps(Dep **deps, int ndeps);
 int get_num_unsatisfied_inter_stmt_deps(Dep **deps, int ndeps);
@@ -113,6 +113,10 @@ void pluto_dep_satisfaction_reset(PlutoProg *prog)
  * Conservative but powerful enough: until a dependence has been completely
  * satisfied (a level at which it is completely satisifed), a non-zero
  * dependence component would set satvec for that level to one
+ *
+ * Satisfaction at each level is known from the direction computation for
+ * rows it has already seen (see get_dep_direction), and so only (dep,
+ * level) pairs whose hyperplanes have changed since are sent to the solver
  */
 void pluto_compute_dep_satisfaction(PlutoProg *prog)
 {
@@ -208,19 +212,18 @@ int num_inter_scc_deps (Stmt *stmts, Dep *deps, int ndeps)
  *                 = LAZY: at least one of the hyperplanes for non-full statements 
  *  should be a loop hyperplane as opposed to all 
  */
-PlutoConstraints *get_non_trivial_sol_constraints(const PlutoProg *prog,
+PlutoSparseConstraints *get_non_trivial_sol_constraints(const PlutoProg *prog,
         bool hyp_search_mode)
 {
-    PlutoConstraints *nzcst;
-    int i, j, stmt_offset, nvar, npar, nstmts;
+    PlutoSparseConstraints *nzcst;
+    int i, j, stmt_offset, nvar, npar, nstmts, nz_added;
 
     Stmt **stmts = prog->stmts;
     nstmts = prog->nstmts;
     nvar = prog->nvar;
     npar = prog->npar;
 
-    nzcst = pluto_constraints_alloc(nstmts, CST_WIDTH);
-    nzcst->ncols = CST_WIDTH;
+    nzcst = pluto_sparse_constraints_alloc(nstmts, nstmts*(nvar+1), CST_WIDTH);
 
     if (hyp_search_mode == EAGER) {
         for (i=0; i<nstmts; i++) {
@@ -230,16 +233,18 @@ PlutoConstraints *get_non_trivial_sol_constraints(const PlutoProg *prog,
                 continue;
             }
             stmt_offset = npar+1+i*(nvar+1);
+            pluto_sparse_constraints_add_constraint(nzcst, 0);
             for (j=0; j<nvar; j++)  {
                 if (stmts[i]->is_orig_loop[j] == 1) {
-                    nzcst->val[nzcst->nrows][stmt_offset+j] = 1;
+                    pluto_sparse_constraints_add_coeff(nzcst, stmt_offset+j, 1);
                 }
             }
-            nzcst->val[nzcst->nrows][CST_WIDTH-1] = -1;
-            nzcst->nrows++;
+            pluto_sparse_constraints_add_coeff(nzcst, CST_WIDTH-1, -1);
         }
     }else{
         assert(hyp_search_mode == LAZY);
+        pluto_sparse_constraints_add_constraint(nzcst, 0);
+        nz_added = 0;
         for (i=0; i<nstmts; i++) {
             /* Don't add the constraint if enough solutions have been found */
             if (pluto_stmt_get_num_ind_hyps(stmts[i]) >= stmts[i]->dim_orig)   {
@@ -249,12 +254,12 @@ PlutoConstraints *get_non_trivial_sol_constraints(const PlutoProg *prog,
             stmt_offset = npar+1+i*(nvar+1);
             for (j=0; j<nvar; j++)  {
                 if (stmts[i]->is_orig_loop[j] == 1) {
-                    nzcst->val[0][stmt_offset+j] = 1;
+                    pluto_sparse_constraints_add_coeff(nzcst, stmt_offset+j, 1);
                 }
             }
-            nzcst->val[0][CST_WIDTH-1] = -1;
+            nz_added = 1;
         }
-        nzcst->nrows = 1;
+        if (nz_added) pluto_sparse_constraints_add_coeff(nzcst, CST_WIDTH-1, -1);
     }
 
     return nzcst;
@@ -263,33 +268,33 @@ PlutoConstraints *get_non_trivial_sol_constraints(const PlutoProg *prog,
 /**
  * Bounds for Pluto ILP variables
  */
-static PlutoConstraints *get_coeff_bounding_constraints(PlutoProg *prog)
+static PlutoSparseConstraints *get_coeff_bounding_constraints(PlutoProg *prog)
 {
     int i, npar, nstmts, nvar;
-    PlutoConstraints *cst;
+    PlutoSparseConstraints *cst;
 
     npar = prog->npar;
     nstmts = prog->nstmts;
     nvar = prog->nvar;
 
-    cst = pluto_constraints_alloc(1, CST_WIDTH);
+    cst = pluto_sparse_constraints_alloc(2*CST_WIDTH, 4*CST_WIDTH, CST_WIDTH);
 
     if (prog->num_hyperplanes == 0) return cst;
 
     /* Lower bound for bounding coefficients (all non-negative) */
     for (i=0; i<npar+1; i++)  {
-        pluto_constraints_add_lb(cst, i, 0);
+        pluto_sparse_constraints_add_lb(cst, i, 0);
     }
     /* Lower bound for transformation coefficients (all non-negative) */
     for (i=0; i<cst->ncols-npar-1-1; i++)  {
         IF_DEBUG2(printf("Adding lower bound %d for transformation coefficients\n", 0););
-        pluto_constraints_add_lb(cst, npar+1+i, 0);
+        pluto_sparse_constraints_add_lb(cst, npar+1+i, 0);
     }
 
-    if (options->coeff_bound != -1) {
+    if (pluto_options->coeff_bound != -1) {
         for (i=0; i<cst->ncols-npar-1-1; i++)  {
-            IF_DEBUG2(printf("Adding upper bound %d for transformation coefficients\n", options->coeff_bound););
-            pluto_constraints_add_ub(cst, npar+1+i, options->coeff_bound);
+            IF_DEBUG2(printf("Adding upper bound %d for transformation coefficients\n", pluto_options->coeff_bound););
+            pluto_sparse_constraints_add_ub(cst, npar+1+i, pluto_options->coeff_bound);
         }
     }else{
         /* Add upper bounds for transformation coefficients */
@@ -304,7 +309,7 @@ static PlutoConstraints *get_coeff_bounding_constraints(PlutoProg *prog)
         if (ub >= 10)   {
             for (i=0; i<cst->ncols-npar-1-1; i++)  {
                 IF_DEBUG2(printf("Adding upper bound %d for transformation coefficients\n", ub););
-                pluto_constraints_add_ub(cst, npar+1+i, ub);
+                pluto_sparse_constraints_add_ub(cst, npar+1+i, ub);
             }
         }
     }
@@ -353,14 +358,22 @@ static PlutoConstraints *get_coeff_bounding_constraints_for_cone_complement(Plut
  * This calls pluto_constraints_lexmin, but before doing that does some preprocessing
  * - removes variables that we know will be assigned 0 - also do some
  *   permutation/substitution of variables
+ *
+ * Both are done with a single column map: the reduced, permuted system is
+ * gathered from 'cst' in one pass, and the solution is scattered back
+ * through the same map; the system is converted only by the solver. Only the coefficients of statements with
+ * in_block[i] set are solved for (all if in_block is NULL); those of the
+ * others are dropped and are 0 in the solution, and so 'cst' shouldn't
+ * involve them
  */
-int64 *pluto_prog_constraints_lexmin(PlutoConstraints *cst, PlutoProg *prog)
+static int64 *pluto_prog_constraints_lexmin_block(const PlutoSparseConstraints *cst,
+        PlutoProg *prog, const int *in_block, PlutoSolverSession *ss)
 {
     Stmt **stmts;
-    int i, j, k;
-    int nstmts, nvar, npar, del_count;
+    int i, j, q;
+    int nstmts, nvar, npar;
     int64 *sol, *fsol;
-    PlutoConstraints *newcst;
+    PlutoSparseConstraints *newcst;
 
     stmts = prog->stmts;
     nstmts = prog->nstmts;
@@ -371,79 +384,315 @@ int64 *pluto_prog_constraints_lexmin(PlutoConstraints *cst, PlutoProg *prog)
 
     /* Remove redundant variables - that don't appear in your outer loops */
     int redun[npar+1+nstmts*(nvar+1)+1];
+    /* Column of each variable in newcst (-1 if removed) */
+    int colmap[npar+1+nstmts*(nvar+1)+1];
     for (i=0; i<npar+1; i++)    {
         redun[i] = 0;
     }
 
     for (i=0; i<nstmts; i++)    {
+        int out = in_block && !in_block[i];
         for (j=0; j<nvar; j++)    {
-            redun[npar+1+i*(nvar+1)+j] = !stmts[i]->is_orig_loop[j];
+            redun[npar+1+i*(nvar+1)+j] = out || !stmts[i]->is_orig_loop[j];
         }
-        redun[npar+1+i*(nvar+1)+nvar] = 0;
+        redun[npar+1+i*(nvar+1)+nvar] = out;
     }
     redun[npar+1+nstmts*(nvar+1)] = 0;
 
-    del_count = 0;
-    newcst = pluto_constraints_dup(cst);
-    for (j = 0; j < cst->ncols-1; j++) {
-        if (redun[j]) {
-            pluto_constraints_remove_dim(newcst, j-del_count);
-            del_count++;
-        }
+    q = 0;
+    for (j = 0; j < cst->ncols; j++) {
+        colmap[j] = redun[j]? -1: q++;
     }
 
     /* Permute the constraints so that if all else is the same, the original
      * hyperplane order is preserved (no strong reason to do this) */
-    j = npar + 1;
     for (i=0; i<nstmts; i++)    {
-        for (k=j; k<j+(stmts[i]->dim_orig)/2; k++) {
-            pluto_constraints_interchange_cols(newcst, k, j + (stmts[i]->dim_orig - 1 - (k-j)));
-
+        if (in_block && !in_block[i]) continue;
+        int first = colmap[npar+1+i*(nvar+1)+nvar] - stmts[i]->dim_orig;
+        for (j=0; j<nvar; j++) {
+            int c = npar+1+i*(nvar+1)+j;
+            if (colmap[c] >= 0) {
+                colmap[c] = first + (stmts[i]->dim_orig - 1 - (colmap[c]-first));
+            }
         }
-        j += stmts[i]->dim_orig+1;
     }
 
-    IF_DEBUG(printf("[pluto] pluto_prog_constraints_lexmin (%d variables, %d constraints)\n",
-                cst->ncols-1, cst->nrows););
+    /* Reduced and permuted system, gathered straight from cst */
+    newcst = pluto_sparse_constraints_gather_cols(cst, colmap, q);
+
+    IF_DEBUG(printf("[pluto] pluto_prog_constraints_lexmin (%d variables, %d constraints, %d non-zeros)\n",
+                newcst->ncols-1, cst->nrows, pluto_sparse_constraints_get_nnz(cst)););
 
 #ifdef GLPK
-    if (options->glpk) {
-        pluto_prog_constraints_lexmin_glpk(newcst, prog);
+    if (pluto_options->glpk) {
+        PlutoConstraints *dcst = pluto_sparse_constraints_to_constraints(newcst);
+        pluto_prog_constraints_lexmin_glpk(dcst, prog);
+        pluto_constraints_free(dcst);
     }
 #endif
     /* Solve the constraints */
-    sol = pluto_constraints_lexmin(newcst, DO_NOT_ALLOW_NEGATIVE_COEFF);
+    sol = pluto_sparse_constraints_lexmin(newcst, DO_NOT_ALLOW_NEGATIVE_COEFF, ss);
     /* print_polylib_visual_sets("csts", newcst); */
 
-
     fsol = NULL;
     if (sol) {
-        int k1, k2, q;
-        int64 tmp;
-        /* Permute the solution in line with the permuted cst */
-        j = npar + 1;
-        for (i=0; i<nstmts; i++)    {
-            for (k=j; k<j+(stmts[i]->dim_orig)/2; k++) {
-                k1 = k;
-                k2 = j + (stmts[i]->dim_orig - 1 - (k-j));
-                tmp = sol[k1];
-                sol[k1] = sol[k2];
-                sol[k2] = tmp;
+        fsol = (int64 *) malloc((cst->ncols-1)*sizeof(int64));
+
+        /* Undo the permutation and fill the soln with zeros for the
+         * redundant variables */
+        for (j=0; j<cst->ncols-1; j++) {
+            fsol[j] = colmap[j] == -1? 0: sol[colmap[j]];
+        }
+        free(sol);
+    }
+
+    pluto_sparse_constraints_free(newcst);
+
+    return fsol;
+}
+
+
+static int find_block_root(int *parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+/*
+ * Group statements into blocks such that no row of 'cst' involves the
+ * coefficients of statements from two different blocks (the u and w
+ * columns, shared by all, are not considered). block[i] is set to the
+ * block of statement i; returns the number of blocks
+ */
+static int get_ilp_blocks(const PlutoSparseConstraints *cst,
+        const PlutoProg *prog, int *block)
+{
+    int i, k, nblocks;
+    int nstmts = prog->nstmts;
+    int nvar = prog->nvar;
+    int npar = prog->npar;
+    int parent[nstmts];
+
+    for (i=0; i<nstmts; i++) {
+        parent[i] = i;
+    }
+
+    for (i=0; i<cst->nrows; i++) {
+        int first = -1;
+        for (k=cst->start[i]; k<cst->start[i+1]; k++) {
+            int c = cst->col[k];
+            if (c < npar+1 || c >= npar+1+nstmts*(nvar+1)) continue;
+            int s = find_block_root(parent, (c-npar-1)/(nvar+1));
+            if (first == -1) {
+                first = s;
+            }else if (s != first) {
+                parent[s] = first;
+            }
+        }
+    }
+
+    nblocks = 0;
+    for (i=0; i<nstmts; i++) {
+        block[i] = -1;
+    }
+    for (i=0; i<nstmts; i++) {
+        int r = find_block_root(parent, i);
+        if (block[r] == -1) block[r] = nblocks++;
+        block[i] = block[r];
+    }
+
+    return nblocks;
+}
+
+
+/*
+ * Solve for the lexmin of each of the nblocks systems bcst[] (with
+ * in_block[b] giving the statements of system b); with more than one
+ * thread, the blocks are solved concurrently, each in its own solver
+ * session. Piplib and GLPK are not thread-safe: multiple threads are only
+ * used with --islsolve
+ */
+static void pluto_prog_constraints_lexmin_blocks(PlutoSparseConstraints **bcst,
+        int **in_block, int nblocks, PlutoProg *prog, int64 **bsol)
+{
+    int b, nthreads;
+    PlutoOptions *caller_options = pluto_options;
+
+    nthreads = (pluto_options->islsolve && !pluto_options->glpk)?
+        pluto_options->nthreads: 1;
+
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads) \
+    if(nthreads > 1)
+    for (b=0; b<nblocks; b++) {
+        /* options is thread-local */
+        pluto_options = caller_options;
+        if (bcst[b] == NULL) continue;
+        if (nthreads > 1) {
+            PlutoSolverSession *ss = pluto_solver_session_alloc();
+            bsol[b] = pluto_prog_constraints_lexmin_block(bcst[b], prog,
+                    in_block[b], ss);
+#pragma omp critical (solver_session)
+            {
+                prog->solver->num_lexmin_calls += ss->num_lexmin_calls;
+                prog->solver->num_is_empty_calls += ss->num_is_empty_calls;
+                prog->solver->num_range_calls += ss->num_range_calls;
+                prog->solver->num_base_hits += ss->num_base_hits;
+                prog->solver->num_isl_wins += ss->num_isl_wins;
+                prog->solver->num_pip_wins += ss->num_pip_wins;
             }
-            j += stmts[i]->dim_orig+1;
+            pluto_solver_session_free(ss);
+        }else{
+            bsol[b] = pluto_prog_constraints_lexmin_block(bcst[b], prog,
+                    in_block[b], prog->solver);
+        }
+    }
+}
+
+
+/*
+ * Lexmin for the Pluto ILP. The statements' coefficients often split into
+ * blocks coupled only through the shared u and w (e.g., statements in
+ * different connected components of the DDG, or separated by cuts at
+ * outer levels): then each block is solved on its own. If z_b is the
+ * lexmin (u, w) of block b, the lexmin (u, w) of the whole system is at
+ * least lexmax_b z_b; when that is feasible for every block, it's the
+ * answer, and with (u, w) fixed, the blocks are independent (the lexmin
+ * of each is its part of the global lexmin). Blocks with z_b below it
+ * are solved again with (u, w) fixed; if one of them turns out to be
+ * infeasible, the whole system is solved at once
+ */
+int64 *pluto_prog_constraints_lexmin(const PlutoSparseConstraints *cst, PlutoProg *prog)
+{
+    int i, j, b, nblocks, nresolve;
+    int nstmts = prog->nstmts;
+    int nvar = prog->nvar;
+    int npar = prog->npar;
+    int block[nstmts];
+    int64 *fsol;
+
+    nblocks = get_ilp_blocks(cst, prog, block);
+
+    if (nblocks <= 1) {
+        return pluto_prog_constraints_lexmin_block(cst, prog, NULL, prog->solver);
+    }
+
+    IF_DEBUG(printf("[pluto] pluto_prog_constraints_lexmin: %d independent blocks\n", nblocks););
+
+    PlutoSparseConstraints *bcst[nblocks];
+    int *in_block[nblocks];
+    int64 *bsol[nblocks];
+
+    for (b=0; b<nblocks; b++) {
+        bcst[b] = pluto_sparse_constraints_alloc(cst->nrows/nblocks+1,
+                pluto_sparse_constraints_get_nnz(cst)/nblocks+1, cst->ncols);
+        in_block[b] = (int *) malloc(nstmts*sizeof(int));
+        for (i=0; i<nstmts; i++) {
+            in_block[b][i] = (block[i] == b);
+        }
+        bsol[b] = NULL;
+    }
+
+    /* Distribute the rows; those only on u and w go to every block. Rows
+     * keep their order, and so the base rows of cst are the base of each
+     * block */
+    for (i=0; i<cst->nrows; i++) {
+        int s = -1;
+        for (j=cst->start[i]; j<cst->start[i+1]; j++) {
+            int c = cst->col[j];
+            if (c >= npar+1 && c < npar+1+nstmts*(nvar+1)) {
+                s = (c-npar-1)/(nvar+1);
+                break;
+            }
+        }
+        for (b=0; b<nblocks; b++) {
+            if (s >= 0 && block[s] != b) continue;
+            pluto_sparse_constraints_add_row(bcst[b], cst, i);
+            if (i < cst->nbase) bcst[b]->nbase = bcst[b]->nrows;
+        }
+    }
+
+    pluto_prog_constraints_lexmin_blocks(bcst, in_block, nblocks, prog, bsol);
+
+    fsol = NULL;
+
+    /* The whole system is infeasible if any block is */
+    for (b=0; b<nblocks; b++) {
+        if (bsol[b] == NULL) break;
+    }
+
+    if (b == nblocks) {
+        /* zmax = lexmax_b z_b */
+        int64 *zmax = bsol[0];
+        for (b=1; b<nblocks; b++) {
+            for (j=0; j<npar+1 && bsol[b][j] == zmax[j]; j++)
+                ;
+            if (j < npar+1 && bsol[b][j] > zmax[j]) zmax = bsol[b];
+        }
+
+        /* Fix (u, w) for the blocks that didn't attain zmax */
+        nresolve = 0;
+        for (b=0; b<nblocks; b++) {
+            for (j=0; j<npar+1 && bsol[b][j] == zmax[j]; j++)
+                ;
+            if (j == npar+1) {
+                pluto_sparse_constraints_free(bcst[b]);
+                bcst[b] = NULL;
+                continue;
+            }
+            for (j=0; j<npar+1; j++) {
+                pluto_sparse_constraints_add_constraint(bcst[b], 1);
+                pluto_sparse_constraints_add_coeff(bcst[b], j, 1);
+                pluto_sparse_constraints_add_coeff(bcst[b], cst->ncols-1, -zmax[j]);
+            }
+            nresolve++;
         }
 
         fsol = (int64 *) malloc((cst->ncols-1)*sizeof(int64));
+        for (j=0; j<npar+1; j++) {
+            fsol[j] = zmax[j];
+        }
 
-        /* Fill the soln with zeros for the redundant variables */
-        q = 0;
-        for (j=0; j<cst->ncols-1; j++) {
-            fsol[j] = redun[j]? 0: sol[q++];
+        if (nresolve >= 1) {
+            IF_DEBUG(printf("[pluto] pluto_prog_constraints_lexmin: re-solving %d block(s) with u, w fixed\n", nresolve););
+            int64 *rsol[nblocks];
+            for (b=0; b<nblocks; b++) {
+                rsol[b] = NULL;
+            }
+            pluto_prog_constraints_lexmin_blocks(bcst, in_block, nblocks, prog, rsol);
+            for (b=0; b<nblocks; b++) {
+                if (bcst[b] == NULL) continue;
+                if (rsol[b] == NULL) {
+                    free(fsol);
+                    fsol = NULL;
+                }else{
+                    free(bsol[b]);
+                    bsol[b] = rsol[b];
+                }
+            }
+        }
+
+        if (fsol) {
+            for (i=0; i<nstmts; i++) {
+                for (j=0; j<nvar+1; j++) {
+                    int c = npar+1+i*(nvar+1)+j;
+                    fsol[c] = bsol[block[i]][c];
+                }
+            }
+        }else{
+            IF_DEBUG(printf("[pluto] pluto_prog_constraints_lexmin: blocks coupled via u, w; solving together\n"););
+            fsol = pluto_prog_constraints_lexmin_block(cst, prog, NULL, prog->solver);
         }
-        free(sol);
     }
 
-    pluto_constraints_free(newcst);
+    for (b=0; b<nblocks; b++) {
+        pluto_sparse_constraints_free(bcst[b]);
+        free(in_block[b]);
+        free(bsol[b]);
+    }
 
     return fsol;
 }
@@ -452,15 +701,13 @@ int64 *pluto_prog_constraints_lexmin(PlutoConstraints *cst, PlutoProg *prog)
 /* Is there an edge between some vertex of SCC1 and some vertex of SCC2? */
 int ddg_sccs_direct_connected(Graph *g, PlutoProg *prog, int scc1, int scc2)
 {
-    int i, j;
+    int i, e;
 
     for (i=0; i<prog->nstmts; i++)  {
         if (prog->stmts[i]->scc_id == scc1)  {
-            for (j=0; j<prog->nstmts; j++)  {
-                if (prog->stmts[j]->scc_id == scc2)  {
-                    if (g->adj->val[i][j] > 0)  {
-                        return 1;
-                    }
+            for (e=0; e<g->vertices[i].nout; e++)  {
+                if (prog->stmts[g->vertices[i].out[e].dest]->scc_id == scc2)  {
+                    return 1;
                 }
             }
         }
@@ -694,12 +941,12 @@ void cut_conservative(PlutoProg *prog, Graph *ddg)
  * linearly independent solutions will get a new linearly independent
  * hyperplane (this is enough to make progress)
  */
-PlutoConstraints *get_linear_ind_constraints(const PlutoProg *prog, 
-        const PlutoConstraints *cst, bool lin_ind_mode)
+PlutoSparseConstraints *get_linear_ind_constraints(const PlutoProg *prog, 
+        const PlutoSparseConstraints *cst, bool lin_ind_mode)
 {
     int npar, nvar, nstmts, i, j, k, orthosum;
     int orthonum[prog->nstmts];
-    PlutoConstraints ***orthcst;
+    PlutoSparseConstraints ***orthcst;
     Stmt **stmts;
 
     IF_DEBUG(printf("[pluto] get_linear_ind_constraints\n"););
@@ -709,7 +956,7 @@ PlutoConstraints *get_linear_ind_constraints(const PlutoProg *prog,
     nstmts = prog->nstmts;
     stmts = prog->stmts;
 
-    orthcst = (PlutoConstraints ***) malloc(nstmts*sizeof(PlutoConstraints **));
+    orthcst = (PlutoSparseConstraints ***) malloc(nstmts*sizeof(PlutoSparseConstraints **));
 
     orthosum = 0;
 
@@ -720,7 +967,8 @@ PlutoConstraints *get_linear_ind_constraints(const PlutoProg *prog,
         orthosum += orthonum[j];
     }
 
-    PlutoConstraints *indcst = pluto_constraints_alloc(1, CST_WIDTH);
+    PlutoSparseConstraints *indcst = pluto_sparse_constraints_alloc(1,
+            nstmts*(nvar+1)+1, CST_WIDTH);
 
     if (orthosum >= 1) {
         if (lin_ind_mode == EAGER) {
@@ -728,30 +976,33 @@ PlutoConstraints *get_linear_ind_constraints(const PlutoProg *prog,
             for (j=0; j<nstmts; j++)    {
                 if (orthonum[j] >= 1)   {
                     IF_DEBUG2(printf("Added ortho constraints for S%d\n", j+1););
-                    pluto_constraints_add(indcst, orthcst[j][orthonum[j]-1]);
+                    pluto_sparse_constraints_add(indcst, orthcst[j][orthonum[j]-1]);
                 }
             }
         }else{
             assert(lin_ind_mode == LAZY);
             /* At least one stmt should have a linearly independent hyperplane */
+            pluto_sparse_constraints_add_constraint(indcst, 0);
             for (i=0; i<prog->nstmts; i++) {
-                /* Everything was initialized to zero */
                 if (orthonum[i] >= 1) {
-                    for (j=0; j<CST_WIDTH-1; j++) {
-                        indcst->val[0][j] += orthcst[i][orthonum[i]-1]->val[0][j];
+                    PlutoSparseConstraints *ortho = orthcst[i][orthonum[i]-1];
+                    for (k=ortho->start[0]; k<ortho->start[1]; k++) {
+                        if (ortho->col[k] < CST_WIDTH-1) {
+                            pluto_sparse_constraints_add_coeff(indcst,
+                                    ortho->col[k], ortho->val[k]);
+                        }
                     }
                 }
             }
-            indcst->val[0][CST_WIDTH-1] = -1;
-            indcst->nrows = 1;
+            pluto_sparse_constraints_add_coeff(indcst, CST_WIDTH-1, -1);
             IF_DEBUG2(printf("Added \"at least one\" linear ind constraints\n"););
-            IF_DEBUG2(pluto_constraints_pretty_print(stdout, indcst););
+            IF_DEBUG2(pluto_sparse_constraints_pretty_print(stdout, indcst););
         }
     }
 
     for (j=0; j<nstmts; j++)    {
         for (k=0; k<orthonum[j]; k++)   {
-            pluto_constraints_free(orthcst[j][k]);
+            pluto_sparse_constraints_free(orthcst[j][k]);
         }
         free(orthcst[j]);
     }
@@ -775,8 +1026,8 @@ int find_permutable_hyperplanes(PlutoProg *prog, bool hyp_search_mode,
 {
     int num_sols_found, j, k;
     int64 *bestsol;
-    PlutoConstraints *basecst, *nzcst, *boundcst;
-    PlutoConstraints *currcst;
+    PlutoSparseConstraints *basecst, *nzcst, *boundcst;
+    PlutoSparseConstraints *currcst;
 
     int nstmts = prog->nstmts;
     Stmt **stmts = prog->stmts;
@@ -789,30 +1040,35 @@ int find_permutable_hyperplanes(PlutoProg *prog, bool hyp_search_mode,
 
     if (max_sols == 0) return 0;
 
+    double t_start = pluto_profile_clock();
+
     /* Don't free basecst */
     basecst = get_permutability_constraints(prog);
     boundcst = get_coeff_bounding_constraints(prog);
-    pluto_constraints_add(basecst, boundcst);
-    pluto_constraints_free(boundcst);
+    pluto_sparse_constraints_add(basecst, boundcst);
+    pluto_sparse_constraints_free(boundcst);
     // print_polylib_visual_sets("pluto", basecst);
 
     num_sols_found = 0;
     /* We don't expect to add a lot to basecst - just ortho constraints
      * and trivial soln avoidance constraints; instead of duplicating basecst,
      * we will just allocate once and copy each time */
-    currcst = pluto_constraints_alloc(basecst->nrows+nstmts+nvar*nstmts, 
+    currcst = pluto_sparse_constraints_alloc(basecst->nrows+nstmts+nvar*nstmts, 
+            pluto_sparse_constraints_get_nnz(basecst)+2*nstmts*(nvar+1)*(nvar+1),
             CST_WIDTH);
 
     do{
-        pluto_constraints_copy(currcst, basecst);
+        pluto_sparse_constraints_copy(currcst, basecst);
+        /* Only what's added below changes from one hyperplane to the next */
+        currcst->nbase = basecst->nrows;
         nzcst = get_non_trivial_sol_constraints(prog, hyp_search_mode);
-        pluto_constraints_add(currcst, nzcst);
-        pluto_constraints_free(nzcst);
+        pluto_sparse_constraints_add(currcst, nzcst);
+        pluto_sparse_constraints_free(nzcst);
 
-        PlutoConstraints *indcst = get_linear_ind_constraints(prog, currcst, hyp_search_mode);
+        PlutoSparseConstraints *indcst = get_linear_ind_constraints(prog, currcst, hyp_search_mode);
         // print_polylib_visual_sets("ind", indcst);
         IF_DEBUG2(printf("linear independence constraints\n"));
-        IF_DEBUG2(pluto_constraints_pretty_print(stdout, indcst););
+        IF_DEBUG2(pluto_sparse_constraints_pretty_print(stdout, indcst););
 
         if (indcst->nrows == 0) {
             /* If you don't have any independence constraints, we would end 
@@ -821,12 +1077,12 @@ int find_permutable_hyperplanes(PlutoProg *prog, bool hyp_search_mode,
             IF_DEBUG(printf("No linearly independent rows\n"););
             bestsol = NULL;
         }else{
-            pluto_constraints_add(currcst, indcst);
+            pluto_sparse_constraints_add(currcst, indcst);
             IF_DEBUG(printf("[pluto] (Band %d) Solving for hyperplane #%d\n", band_depth+1, num_sols_found+1));
             // IF_DEBUG2(pluto_constraints_pretty_print(stdout, currcst));
             bestsol = pluto_prog_constraints_lexmin(currcst, prog);
         }
-        pluto_constraints_free(indcst);
+        pluto_sparse_constraints_free(indcst);
 
         if (bestsol != NULL)    {
             IF_DEBUG(fprintf(stdout, "[pluto] find_permutable_hyperplanes: found a hyperplane\n"));
@@ -860,7 +1116,10 @@ int find_permutable_hyperplanes(PlutoProg *prog, bool hyp_search_mode,
         }
     }while (num_sols_found < max_sols && bestsol != NULL);
 
-    pluto_constraints_free(currcst);
+    pluto_sparse_constraints_free(currcst);
+
+    pluto_profile_add_band(band_depth, num_sols_found,
+            pluto_profile_clock() - t_start);
 
     /* Same number of solutions are found for each stmt */
     return num_sols_found;
@@ -1041,6 +1300,8 @@ void pluto_compute_dep_directions(PlutoProg *prog)
 
     Dep **deps = prog->deps;
 
+    double t_start = pluto_profile_clock();
+
     for (i=0; i<prog->ndeps; i++)   {
         if (deps[i]->dirvec != NULL)  {
             free(deps[i]->dirvec);
@@ -1050,6 +1311,8 @@ void pluto_compute_dep_directions(PlutoProg *prog)
             deps[i]->dirvec[level] = get_dep_direction(deps[i], prog, level);
         }
     }
+
+    pluto_profile_add_phase("dep_directions", pluto_profile_clock() - t_start);
 }
 
 void pluto_detect_hyperplane_types_stmtwise(PlutoProg *prog)
@@ -1457,7 +1720,7 @@ void denormalize_domains(PlutoProg *prog)
  */
 PlutoMatrix *get_face_with_concurrent_start(PlutoProg *prog, Band *band)
 {
-    PlutoConstraints *bcst;
+    PlutoSparseConstraints *fcst, *bcst;
     int s, _s, j, nz, nvar, npar;
     PlutoMatrix *conc_start_faces;
 
@@ -1467,15 +1730,17 @@ PlutoMatrix *get_face_with_concurrent_start(PlutoProg *prog, Band *band)
     npar = prog->npar;
     nvar = prog->nvar;
 
-    PlutoConstraints *fcst = get_feautrier_schedule_constraints(prog, 
+    PlutoConstraints *fcst_d = get_feautrier_schedule_constraints(prog, 
             band->loop->stmts, band->loop->nstmts);
+    fcst = pluto_sparse_constraints_from_constraints(fcst_d);
+    pluto_constraints_free(fcst_d);
 
     bcst = get_coeff_bounding_constraints(prog);
-    pluto_constraints_add(fcst, bcst);
-    pluto_constraints_free(bcst);
+    pluto_sparse_constraints_add(fcst, bcst);
+    pluto_sparse_constraints_free(bcst);
 
     int64 *sol = pluto_prog_constraints_lexmin(fcst, prog);
-    pluto_constraints_free(fcst);
+    pluto_sparse_constraints_free(fcst);
 
     if (!sol) {
         IF_DEBUG(printf("[pluto] get_face_with_concurrent_start: no valid 1-d schedules \n"););
@@ -1543,7 +1808,7 @@ PlutoMatrix *get_face_with_concurrent_start(PlutoProg *prog, Band *band)
  * for statements in the band
  */
 int find_cone_complement_hyperplane(Band *band, PlutoMatrix *conc_start_faces, int evict_pos, 
-        int cone_complement_pos, PlutoConstraints *basecst, PlutoProg *prog, 
+        int cone_complement_pos, PlutoSparseConstraints *basecst, PlutoProg *prog, 
         PlutoMatrix **cone_complement_hyps)
 {
     int i, s, j, k, lambda_k, nstmts, nvar, npar;
@@ -1584,7 +1849,7 @@ int find_cone_complement_hyperplane(Band *band, PlutoMatrix *conc_start_faces, i
 
             lastcst->val[lastcst->nrows-1][stmt_offset2] = -(conc_start_faces->val[s][j]);
 
-            if (options->partlbtile) {
+            if (pluto_options->partlbtile) {
                 lastcst->val[lastcst->nrows-1][stmt_offset2+1] = 
                     stmt->trans->val[cone_complement_pos][j];
             }else{
@@ -1605,9 +1870,10 @@ int find_cone_complement_hyperplane(Band *band, PlutoMatrix *conc_start_faces, i
      * con_start_cst serves the same purpose as Pluto ILP formulation, but 
      * with expanded constraint-width to incorporate lambdas
      *
-     * No need of non-zero solution constraints
+     * No need of non-zero solution constraints; the system is grown
+     * column-wise below, which is done on the dense form
      */
-    con_start_cst = pluto_constraints_dup(basecst);
+    con_start_cst = pluto_sparse_constraints_to_constraints(basecst);
 
     PlutoConstraints *boundcst = get_coeff_bounding_constraints_for_cone_complement(prog);
     pluto_constraints_add(con_start_cst, boundcst);
@@ -1623,7 +1889,8 @@ int find_cone_complement_hyperplane(Band *band, PlutoMatrix *conc_start_faces, i
     // pluto_constraints_pretty_print(stdout, con_start_cst);
 
     /* pluto_constraints_lexmin is being called directly */
-    bestsol = pluto_constraints_lexmin(con_start_cst, ALLOW_NEGATIVE_COEFF);
+    bestsol = pluto_constraints_lexmin(con_start_cst, ALLOW_NEGATIVE_COEFF,
+            prog->solver);
     pluto_constraints_free(con_start_cst);
 
     /* pluto_constraints_lexmin is being called directly */
@@ -1730,7 +1997,7 @@ static void swap_hyperplanes(int64 *h1, int64 *h2, int ncols)
  * All dependences are reset to unsatisfied before starting
  *
  */ 
-int pluto_auto_transform(PlutoProg *prog)
+static int pluto_auto_transform_stmts(PlutoProg *prog)
 {
     int i, j, s, nsols, conc_start_found, depth;
     /* The maximum number of linearly independent solutions needed across all
@@ -1802,7 +2069,7 @@ int pluto_auto_transform(PlutoProg *prog)
                     num_ind_sols_found));
     }else{
         num_ind_sols_found = 0;
-        if (options->fuse == SMART_FUSE)    {
+        if (pluto_options->fuse == SMART_FUSE)    {
             cut_scc_dim_based(prog,ddg);
         }
     }
@@ -1816,7 +2083,7 @@ int pluto_auto_transform(PlutoProg *prog)
          * (maximum across all statements) */
         int num_sols_left;
 
-        if (options->fuse == NO_FUSE)   {
+        if (pluto_options->fuse == NO_FUSE)   {
             ddg_compute_scc(prog);
             cut_all_sccs(prog, ddg);
         }
@@ -1849,7 +2116,7 @@ int pluto_auto_transform(PlutoProg *prog)
         
         if (nsols >= 1) {
             /* Diamond tiling: done for the first band of permutable loops */
-            if (options->lbtile && nsols >= 2 && !conc_start_found) {
+            if (pluto_options->lbtile && nsols >= 2 && !conc_start_found) {
                 conc_start_found = pluto_diamond_tile(prog);
             }
 
@@ -1865,10 +2132,10 @@ int pluto_auto_transform(PlutoProg *prog)
             ddg_compute_scc(prog);
 
             if (get_num_unsatisfied_inter_scc_deps(prog) >= 1) {
-                if (options->fuse == NO_FUSE)  {
+                if (pluto_options->fuse == NO_FUSE)  {
                     /* No fuse */
                     cut_all_sccs(prog, ddg);
-                }else if (options->fuse == SMART_FUSE)  {
+                }else if (pluto_options->fuse == SMART_FUSE)  {
                     /* Smart fuse (default) */
                     cut_smart(prog, ddg);
                 }else{
@@ -1887,7 +2154,7 @@ int pluto_auto_transform(PlutoProg *prog)
                     /* There is a problem; solutions should have been found if
                      * there were no inter-scc deps, and some unsatisfied deps
                      * existed */
-                    if (options->debug || options->moredebug) {
+                    if (pluto_options->debug || pluto_options->moredebug) {
                         printf("\tNumber of unsatisfied deps: %d\n",
                                 get_num_unsatisfied_deps(prog->deps, prog->ndeps));
                         printf("\tNumber of unsatisfied inter-scc deps: %d\n",
@@ -1922,7 +2189,7 @@ int pluto_auto_transform(PlutoProg *prog)
     }while (!pluto_transformations_full_ranked(prog) || 
             !deps_satisfaction_check(prog));
 
-    if (options->lbtile && !conc_start_found) {
+    if (pluto_options->lbtile && !conc_start_found) {
         PLUTO_MESSAGE(printf("[pluto] Diamond tiling not possible/useful\n"););
     }
 
@@ -1942,6 +2209,260 @@ int pluto_auto_transform(PlutoProg *prog)
 }
 
 
+/*
+ * Are all instances of 'dep' (between statements of the same
+ * dimensionality) from and to the same iteration?
+ */
+static bool dep_is_loop_independent(const Dep *dep, const PlutoProg *prog)
+{
+    int k, sign, row;
+    bool is_empty;
+    int dim = prog->stmts[dep->src]->dim;
+    PlutoConstraints *cst;
+
+    cst = pluto_constraints_alloc(dep->dpolytope->nrows+1, dep->dpolytope->ncols);
+    pluto_constraints_copy(cst, dep->dpolytope);
+    row = cst->nrows;
+    pluto_constraints_add_inequality(cst);
+
+    is_empty = true;
+    for (k=0; k<dim && is_empty; k++) {
+        for (sign=1; sign>=-1 && is_empty; sign-=2) {
+            /* sign*(t_k - s_k) >= 1 */
+            pluto_constraints_zero_row(cst, row);
+            cst->val[row][k] = -sign;
+            cst->val[row][dim+k] = sign;
+            cst->val[row][cst->ncols-1] = -1;
+            is_empty = pluto_constraints_is_empty(cst, prog->solver);
+        }
+    }
+    pluto_constraints_free(cst);
+
+    return is_empty;
+}
+
+
+/*
+ * Can 'stmt' join the cluster of the statements right before it in
+ * the original program? It should be in the same SCC, have the same
+ * domain, and be in the same loop body, i.e., its original schedule
+ * differs only in the innermost (scalar) dimension
+ */
+static bool stmt_is_clusterable_with(const Stmt *stmt, const Stmt *prev)
+{
+    int i, j;
+    const PlutoMatrix *t1, *t2;
+    const PlutoConstraints *d1, *d2;
+
+    if (stmt->scc_id != prev->scc_id) return false;
+    if (stmt->dim != prev->dim || stmt->dim_orig != prev->dim_orig) return false;
+
+    for (i=0; i<stmt->dim; i++) {
+        if (stmt->is_orig_loop[i] != prev->is_orig_loop[i]) return false;
+    }
+
+    d1 = stmt->domain;
+    d2 = prev->domain;
+    if (d1->nrows != d2->nrows || d1->ncols != d2->ncols || d1->next || d2->next) {
+        return false;
+    }
+    for (i=0; i<d1->nrows; i++) {
+        if (d1->is_eq[i] != d2->is_eq[i]) return false;
+        for (j=0; j<d1->ncols; j++) {
+            if (d1->val[i][j] != d2->val[i][j]) return false;
+        }
+    }
+
+    t1 = stmt->trans;
+    t2 = prev->trans;
+    if (t1->nrows == 0 || t1->nrows != t2->nrows || t1->ncols != t2->ncols) {
+        return false;
+    }
+    for (i=0; i<t1->nrows-1; i++) {
+        for (j=0; j<t1->ncols; j++) {
+            if (t1->val[i][j] != t2->val[i][j]) return false;
+        }
+    }
+    if (!pluto_is_hyperplane_scalar(stmt, t1->nrows-1) 
+            || !pluto_is_hyperplane_scalar(prev, t2->nrows-1)) {
+        return false;
+    }
+    for (j=0; j<t1->ncols-1; j++) {
+        if (t1->val[t1->nrows-1][j] != t2->val[t2->nrows-1][j]) return false;
+    }
+
+    return t1->val[t1->nrows-1][t1->ncols-1] > t2->val[t2->nrows-1][t2->ncols-1];
+}
+
+
+/*
+ * Statement clustering: consecutive statements of a loop body that
+ * belong to the same SCC and have identical domains (typical of
+ * unrolled kernels) are given the same hyperplanes; only the first
+ * statement of each cluster (the representative) takes part in the
+ * Pluto ILP, which shrinks its width and the number of dependences to
+ * apply Farkas lemma on. A dependence between two statements of a
+ * cluster is allowed only if it's loop-independent; such dependences
+ * are satisfied by a final scalar dimension that orders a cluster's
+ * statements as in the original program. Other dependences are carried
+ * over to the representatives
+ */
+static int pluto_auto_transform_clustered(PlutoProg *prog)
+{
+    int i, j, k, ncl, ncdeps, ret;
+    int nstmts = prog->nstmts;
+    Stmt **stmts = prog->stmts;
+    int ndeps = prog->ndeps;
+    Dep **deps = prog->deps;
+
+    /* Cluster (in the order of representatives) of each statement and its
+     * position within the cluster */
+    int cl[nstmts], pos[nstmts];
+
+    prog->ddg = ddg_create(prog);
+    ddg_compute_scc(prog);
+    graph_free(prog->ddg);
+    prog->ddg = NULL;
+
+    ncl = 0;
+    for (i=0; i<nstmts; i++) {
+        if (i >= 1 && stmt_is_clusterable_with(stmts[i], stmts[i-1])) {
+            /* All deps between stmts[i] and the rest of the cluster should
+             * be loop-independent */
+            for (k=0; k<ndeps; k++) {
+                Dep *dep = deps[k];
+                if (pluto_options->rar == 0 && IS_RAR(dep->type)) continue;
+                if ((dep->src == i && dep->dest < i && cl[dep->dest] == ncl-1) ||
+                        (dep->dest == i && dep->src < i && cl[dep->src] == ncl-1)) {
+                    if (!dep_is_loop_independent(dep, prog)) break;
+                }
+            }
+            if (k == ndeps) {
+                cl[i] = ncl-1;
+                pos[i] = pos[i-1]+1;
+                continue;
+            }
+        }
+        cl[i] = ncl++;
+        pos[i] = 0;
+    }
+
+    if (ncl == nstmts) {
+        return pluto_auto_transform_stmts(prog);
+    }
+
+    PLUTO_MESSAGE(printf("[pluto] Statement clustering: %d statements scheduled as %d\n",
+                nstmts, ncl););
+
+    /* Representatives (renumbered) and dependences between them */
+    Stmt **cstmts = (Stmt **) malloc(ncl*sizeof(Stmt *));
+    Dep **cdeps = (Dep **) malloc(PLMAX(1,ndeps)*sizeof(Dep *));
+    for (i=0; i<nstmts; i++) {
+        if (pos[i] == 0) {
+            cstmts[cl[i]] = stmts[i];
+            stmts[i]->id = cl[i];
+        }
+    }
+    ncdeps = 0;
+    for (k=0; k<ndeps; k++) {
+        Dep *dep = deps[k];
+        if (dep->src != dep->dest && cl[dep->src] == cl[dep->dest]) continue;
+        Dep *cdep = pluto_dep_dup(dep);
+        cdep->id = ncdeps;
+        cdep->src = cl[dep->src];
+        cdep->dest = cl[dep->dest];
+        /* These are in the layout of the full program's ILP */
+        pluto_sparse_constraints_free(cdep->cst);
+        pluto_sparse_constraints_free(cdep->bounding_cst);
+        cdep->cst = NULL;
+        cdep->bounding_cst = NULL;
+        pluto_dep_detect_uniform(cdep, cstmts);
+        cdeps[ncdeps++] = cdep;
+    }
+
+    IF_DEBUG(printf("[pluto] Clustered program: %d statements, %d deps\n", ncl, ncdeps););
+
+    pluto_sparse_constraints_free(prog->globcst);
+    prog->globcst = NULL;
+    prog->stmts = cstmts;
+    prog->nstmts = ncl;
+    prog->deps = cdeps;
+    prog->ndeps = ncdeps;
+    pluto_prog_invalidate_dep_index(prog);
+
+    ret = pluto_auto_transform_stmts(prog);
+
+    graph_free(prog->ddg);
+    pluto_sparse_constraints_free(prog->globcst);
+    prog->globcst = NULL;
+    for (k=0; k<ncdeps; k++) {
+        pluto_dep_free(cdeps[k]);
+    }
+    free(cdeps);
+    free(cstmts);
+    prog->stmts = stmts;
+    prog->nstmts = nstmts;
+    prog->deps = deps;
+    prog->ndeps = ndeps;
+    pluto_prog_invalidate_dep_index(prog);
+    for (i=0; i<nstmts; i++) {
+        stmts[i]->id = i;
+    }
+
+    if (ret == 0) {
+        /* Expand the representatives' hyperplanes to the other members */
+        Stmt *rep = NULL;
+        for (i=0; i<nstmts; i++) {
+            Stmt *stmt = stmts[i];
+            if (pos[i] == 0) {
+                rep = stmt;
+                continue;
+            }
+            pluto_matrix_free(stmt->trans);
+            stmt->trans = pluto_matrix_dup(rep->trans);
+            free(stmt->hyp_types);
+            stmt->hyp_types = (PlutoHypType *) malloc(rep->trans->nrows*sizeof(PlutoHypType));
+            memcpy(stmt->hyp_types, rep->hyp_types, rep->trans->nrows*sizeof(PlutoHypType));
+            if (rep->evicted_hyp) {
+                stmt->evicted_hyp = pluto_matrix_dup(rep->evicted_hyp);
+                stmt->evicted_hyp_pos = rep->evicted_hyp_pos;
+            }
+        }
+
+        /* Order a cluster's statements as in the original program */
+        pluto_prog_add_hyperplane(prog, prog->num_hyperplanes, H_SCALAR);
+        for (i=0; i<nstmts; i++) {
+            Stmt *stmt = stmts[i];
+            pluto_stmt_add_hyperplane(stmt, H_SCALAR, stmt->trans->nrows);
+            for (j=0; j<stmt->trans->ncols-1; j++) {
+                stmt->trans->val[stmt->trans->nrows-1][j] = 0;
+            }
+            stmt->trans->val[stmt->trans->nrows-1][stmt->trans->ncols-1] = pos[i];
+        }
+    }
+
+    prog->ddg = ddg_create(prog);
+    ddg_compute_scc(prog);
+
+    pluto_dep_satisfaction_reset(prog);
+    for (i=0; i<prog->num_hyperplanes; i++) {
+        dep_satisfaction_update(prog, i);
+    }
+
+    return ret;
+}
+
+
+int pluto_auto_transform(PlutoProg *prog)
+{
+    if (pluto_options->cluster && prog->nstmts >= 2) {
+        return pluto_auto_transform_clustered(prog);
+    }
+
+    return pluto_auto_transform_stmts(prog);
+}
+
+
 int get_num_unsatisfied_deps(Dep **deps, int ndeps)
 {
     int i, count;
@@ -1999,93 +2520,71 @@ int get_num_unsatisfied_inter_scc_deps(PlutoProg *prog)
 
 void ddg_print(Graph *g)
 {
-    pluto_matrix_print(stdout, g->adj);
+    graph_print(stdout, g);
 }
 
 
-/*
- * Update the DDG - should be called when some dependences
- * are satisfied
- **/
-void ddg_update(Graph *g, PlutoProg *prog)
+/* Make the edges of g reflect the current satisfaction status of prog's
+ * dependences: an edge is added for a dependence that is unsatisfied and
+ * isn't in the graph yet, and removed for one that has been satisfied
+ * since. RAR deps are never in the graph */
+static void ddg_sync_edges(Graph *g, PlutoProg *prog)
 {
-    int i, j;
+    int i;
     Dep *dep;
+    bool unsat;
 
-    IF_DEBUG(printf("[pluto] updating DDG\n"););
-
-    for (i=0; i<g->nVertices; i++) 
-        for (j=0; j<g->nVertices; j++)
-            g->adj->val[i][j] = 0;
+    if (g->ndeps != prog->ndeps) {
+        /* Deps were added or removed; start over */
+        graph_clear_edges(g);
+        free(g->dep_edges);
+        g->dep_edges = (bool *) calloc(PLMAX(prog->ndeps, 1), sizeof(bool));
+        g->ndeps = prog->ndeps;
+    }
 
     for (i=0; i<prog->ndeps; i++)   {
         dep = prog->deps[i];
         if (IS_RAR(dep->type)) continue;
-        /* Number of unsatisfied dependences b/w src and dest is stored in the
-         * adjacency matrix */
-        g->adj->val[dep->src][dep->dest] += !dep_is_satisfied(dep);
+        unsat = !dep_is_satisfied(dep);
+        if (unsat == g->dep_edges[i]) continue;
+        /* It's a multi-graph: the number of unsatisfied dependences b/w src
+         * and dest is the multiplicity of the edge */
+        if (unsat) {
+            graph_add_edges(g, dep->src, dep->dest, 1);
+        }else{
+            graph_remove_edges(g, dep->src, dep->dest, 1);
+        }
+        g->dep_edges[i] = unsat;
     }
 }
 
 
-/* 
- * Create the DDG (RAR deps not included) from the unsatisfied deps
- */
-Graph *ddg_create(PlutoProg *prog)
+/*
+ * Update the DDG - should be called when some dependences
+ * are satisfied
+ **/
+void ddg_update(Graph *g, PlutoProg *prog)
 {
-    int i;
-
-    Graph *g = graph_alloc(prog->nstmts);
-
-    for (i=0; i<prog->ndeps; i++)   {
-        Dep *dep = prog->deps[i];
-        /* no input dep edges in the graph */
-        if (IS_RAR(dep->type)) continue;
-        /* remember it's a multi-graph */
-        g->adj->val[dep->src][dep->dest] += !dep_is_satisfied(dep);
-    }
+    IF_DEBUG(printf("[pluto] updating DDG\n"););
 
-    return g;
+    ddg_sync_edges(g, prog);
 }
 
 
 /* 
- * Get the dimensionality of the stmt with max dimensionality in the SCC
+ * Create the DDG (RAR deps not included) from the unsatisfied deps
  */
-static int get_max_orig_dim_in_scc(PlutoProg *prog, int scc_id)
-{
-    int i;
-
-    int max = -1;
-    for (i=0; i<prog->nstmts; i++)  {
-        Stmt *stmt = prog->stmts[i];
-        if (stmt->scc_id == scc_id) {
-            max = PLMAX(max,stmt->dim_orig);
-        }
-    }
-
-    return max;
-}
-
-/* Number of vertices in a given SCC */
-static int get_scc_size(PlutoProg *prog, int scc_id)
+Graph *ddg_create(PlutoProg *prog)
 {
-    int i;
-    Stmt *stmt;
+    Graph *g = graph_alloc(prog->nstmts);
 
-    int num = 0;
-    for (i=0; i<prog->nstmts; i++)  {
-        stmt = prog->stmts[i];
-        if (stmt->scc_id == scc_id) {
-            num++;
-        }
-    }
+    ddg_sync_edges(g, prog);
 
-    return num;
+    return g;
 }
 
 
-/* Compute the SCCs of a graph (usig Kosaraju's algorithm) */
+/* Compute the SCCs of the DDG (using Tarjan's algorithm) */
 void ddg_compute_scc(PlutoProg *prog)
 {
     int i;
@@ -2094,28 +2593,19 @@ void ddg_compute_scc(PlutoProg *prog)
 
     Graph *g = prog->ddg;
 
-    dfs(g);
-
-    Graph *gT = graph_transpose(g);
-
-    dfs_for_scc(gT);
-
-    g->num_sccs = gT->num_sccs;
-
-    for (i=0; i<g->nVertices; i++)  {
-        g->vertices[i].scc_id = gT->vertices[i].scc_id;
-        int stmt_id = gT->vertices[i].id;
-        assert(stmt_id == i);
-        prog->stmts[i]->scc_id = g->vertices[i].scc_id;
-    }
+    graph_compute_sccs(g);
 
     for (i=0; i<g->num_sccs; i++)  {
-        g->sccs[i].max_dim = get_max_orig_dim_in_scc(prog, i);
-        g->sccs[i].size = get_scc_size (prog, i);
-        g->sccs[i].id = gT->sccs[i].id;
+        g->sccs[i].max_dim = -1;
     }
 
-    graph_free(gT);
+    for (i=0; i<g->nVertices; i++)  {
+        int scc_id = g->vertices[i].scc_id;
+        prog->stmts[i]->scc_id = scc_id;
+        /* Dimensionality of the stmt with max dimensionality in the SCC */
+        g->sccs[scc_id].max_dim = PLMAX(g->sccs[scc_id].max_dim,
+                prog->stmts[i]->dim_orig);
+    }
 
     graph_print_sccs(g);
 }
@@ -2149,60 +2639,54 @@ PlutoConstraints *pluto_stmt_get_schedule(const Stmt *stmt)
 }
 
 
-/* Update a dependence with a new constraint added to the statement domain */
-void pluto_update_deps(Stmt *stmt, PlutoConstraints *cst, PlutoProg *prog)
+/* Add cst (a constraint on stmt's domain) to the dependence polyhedra of the
+ * deps in list having stmt as source (lists->out) and as destination
+ * (lists->in) */
+static void pluto_update_stmt_deps(Stmt *stmt, PlutoConstraints *cst,
+        Dep **deps, const PlutoStmtDepLists *lists, Stmt **stmts)
 {
     int i, c;
+    int s = stmt->id;
 
-    Stmt **stmts = prog->stmts;
-
-    assert(cst->ncols == stmt->domain->ncols);
-
-    for (i=0; i<prog->ndeps; i++) {
-        Dep *dep = prog->deps[i];
-        if (stmts[dep->src] == stmt) {
-            PlutoConstraints *cst_l = pluto_constraints_dup(cst);
-            Stmt *tstmt = stmts[dep->dest];
-            for (c=0; c<tstmt->dim; c++) {
-                pluto_constraints_add_dim(cst_l, stmt->dim, NULL);
-            }
-            pluto_constraints_add(dep->dpolytope, cst_l);
-            pluto_constraints_free(cst_l);
-        }
-        if (stmts[dep->dest] == stmt) {
-            PlutoConstraints *cst_l = pluto_constraints_dup(cst);
-            Stmt *sstmt = stmts[dep->src];
-            for (c=0; c<sstmt->dim; c++) {
-                pluto_constraints_add_dim(cst_l, 0, NULL);
-            }
-            pluto_constraints_add(dep->dpolytope, cst_l);
-            pluto_constraints_free(cst_l);
+    for (i=lists->out_start[s]; i<lists->out_start[s+1]; i++) {
+        Dep *dep = deps[lists->out[i]];
+        PlutoConstraints *cst_l = pluto_constraints_dup(cst);
+        Stmt *tstmt = stmts[dep->dest];
+        for (c=0; c<tstmt->dim; c++) {
+            pluto_constraints_add_dim(cst_l, stmt->dim, NULL);
         }
+        pluto_constraints_add(dep->dpolytope, cst_l);
+        pluto_constraints_free(cst_l);
     }
 
-    for (i=0; i<prog->ntransdeps; i++) {
-        Dep *dep = prog->transdeps[i];
-        if (stmts[dep->src] == stmt) {
-            PlutoConstraints *cst_l = pluto_constraints_dup(cst);
-            Stmt *tstmt = stmts[dep->dest];
-            for (c=0; c<tstmt->dim; c++) {
-                pluto_constraints_add_dim(cst_l, stmt->dim, NULL);
-            }
-            pluto_constraints_add(dep->dpolytope, cst_l);
-            pluto_constraints_free(cst_l);
-        }
-        if (stmts[dep->dest] == stmt) {
-            PlutoConstraints *cst_l = pluto_constraints_dup(cst);
-            Stmt *sstmt = stmts[dep->src];
-            for (c=0; c<sstmt->dim; c++) {
-                pluto_constraints_add_dim(cst_l, 0, NULL);
-            }
-            pluto_constraints_add(dep->dpolytope, cst_l);
-            pluto_constraints_free(cst_l);
+    for (i=lists->in_start[s]; i<lists->in_start[s+1]; i++) {
+        Dep *dep = deps[lists->in[i]];
+        PlutoConstraints *cst_l = pluto_constraints_dup(cst);
+        Stmt *sstmt = stmts[dep->src];
+        for (c=0; c<sstmt->dim; c++) {
+            pluto_constraints_add_dim(cst_l, 0, NULL);
         }
+        pluto_constraints_add(dep->dpolytope, cst_l);
+        pluto_constraints_free(cst_l);
     }
 }
 
+
+/* Update a dependence with a new constraint added to the statement domain */
+void pluto_update_deps(Stmt *stmt, PlutoConstraints *cst, PlutoProg *prog)
+{
+    const PlutoDepIndex *index;
+
+    assert(cst->ncols == stmt->domain->ncols);
+    assert(prog->stmts[stmt->id] == stmt);
+
+    index = pluto_prog_get_dep_index(prog);
+
+    pluto_update_stmt_deps(stmt, cst, prog->deps, &index->deps, prog->stmts);
+    pluto_update_stmt_deps(stmt, cst, prog->transdeps, &index->transdeps,
+            prog->stmts);
+}
+
 /* Are these statements completely fused until the innermost level */
 int pluto_are_stmts_fused(Stmt **stmts, int nstmts, const PlutoProg *prog)
 {
@@ -2233,7 +2717,7 @@ int pluto_diamond_tile(PlutoProg *prog)
      * and we won't get the constraints we want */
 
     /* Don't free basecst */
-    PlutoConstraints *basecst = get_permutability_constraints(prog);
+    PlutoSparseConstraints *basecst = get_permutability_constraints(prog);
 
     pluto_compute_dep_directions(prog);
     pluto_compute_dep_satisfaction(prog);
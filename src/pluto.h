@@ -43,10 +43,10 @@
 #define PLUTO_OSL_PRECISION 0
 #endif
 
-#define IF_DEBUG(foo) {if (options->debug || options->moredebug) { foo; }}
-#define IF_DEBUG2(foo) {if (options->moredebug) {foo; }}
-#define IF_MORE_DEBUG(foo) {if (options->moredebug) {foo; }}
-#define PLUTO_MESSAGE(foo) {if (!options->silent) { foo; }}
+#define IF_DEBUG(foo) {if (pluto_options->debug || pluto_options->moredebug) { foo; }}
+#define IF_DEBUG2(foo) {if (pluto_options->moredebug) {foo; }}
+#define IF_MORE_DEBUG(foo) {if (pluto_options->moredebug) {foo; }}
+#define PLUTO_MESSAGE(foo) {if (!pluto_options->silent) { foo; }}
 
 #define MAX_TILING_LEVELS 2
 
@@ -63,7 +63,8 @@ typedef enum dirvec_type {DEP_MINUS='-', DEP_ZERO='0', DEP_PLUS='+', DEP_STAR='*
 typedef enum hyptype {H_UNKNOWN=0, H_LOOP, H_TILE_SPACE_LOOP,
     H_SCALAR} PlutoHypType;
 
-/* Candl dependences are not marked uniform/non-uniform */
+/* Candl dependences are not marked uniform/non-uniform; uniform
+ * dependences are detected from their polyhedra instead (Dep::distvec) */
 #define IS_UNIFORM(type) (0)
 #define IS_RAR(type) (type == OSL_DEPENDENCE_RAR)
 #define IS_RAW(type) (type == OSL_DEPENDENCE_RAW)
@@ -163,6 +164,30 @@ struct stmt_access_pair{
 };
 
 
+/*
+ * Directions computed so far for a dependence (see get_dep_direction): one
+ * entry per distinct pair of source and target hyperplanes; entries are
+ * dropped when the dependence polyhedron or the source statement's
+ * dimensionality changes
+ */
+struct pluto_dep_dir_cache {
+    /* Entry i: source hyperplane followed by target hyperplane (len[i]
+     * coefficients in all), the direction for it (a DepDir), and whether
+     * the dependence is satisfied by it (0/1); -1 when not yet known */
+    int64 **hyps;
+    int *len;
+    int *dirs;
+    int *sat;
+    int nentries;
+    int alloc_entries;
+
+    /* Copy of the dependence polyhedron the entries were computed for,
+     * and the source statement's dimensionality then */
+    PlutoConstraints *dpoly;
+    int src_dim;
+};
+typedef struct pluto_dep_dir_cache PlutoDepDirCache;
+
 struct dependence{
 
     /* Unique number of the dependence: starts with 0  */
@@ -217,14 +242,21 @@ struct dependence{
     int *satvec;
 
     /* Constraints for preserving this dependence while bounding 
-     * its distance */
-    PlutoConstraints *cst;
+     * its distance (in the global format of the Pluto ILP) */
+    PlutoSparseConstraints *cst;
 
     /* Constraints for bounding dependence distance */
-    PlutoConstraints *bounding_cst;
+    PlutoSparseConstraints *bounding_cst;
 
     /* Dependence direction in transformed space */
     DepDir *dirvec;
+
+    /* Directions already computed; NULL if none */
+    PlutoDepDirCache *dircache;
+
+    /* Constant distance vector (dest - src) along each dimension of the
+     * statement if this is a uniform self dependence; NULL otherwise */
+    int64 *distvec;
 };
 typedef struct dependence Dep;
 
@@ -257,6 +289,34 @@ struct hyperplane_properties{
 };
 typedef struct hyperplane_properties HyperplaneProperties;
 
+/* Dependences of a list (prog->deps or prog->transdeps) grouped by
+ * statement: deps with statement s as the source are at positions
+ * out[out_start[s]], ..., out[out_start[s+1]-1] of the list; likewise, 'in'
+ * for s as the destination */
+struct pluto_stmt_dep_lists{
+    int *out_start;
+    int *out;
+    int *in_start;
+    int *in;
+};
+typedef struct pluto_stmt_dep_lists PlutoStmtDepLists;
+
+/* Per-statement dependence lists of a program; see pluto_prog_get_dep_index */
+struct pluto_dep_index{
+    PlutoStmtDepLists deps;
+    PlutoStmtDepLists transdeps;
+
+    /* What the lists were built from; they are rebuilt if any of this
+     * changes or if valid is cleared */
+    Dep **dep_list;
+    int ndeps;
+    Dep **transdep_list;
+    int ntransdeps;
+    int nstmts;
+    bool valid;
+};
+typedef struct pluto_dep_index PlutoDepIndex;
+
 struct plutoProg{
     /* Array of statements */
     Stmt **stmts;
@@ -310,7 +370,17 @@ struct plutoProg{
     /* Codegen context */
     PlutoConstraints *codegen_context;
     /* Temp autotransform data */
-    PlutoConstraints *globcst;
+    PlutoSparseConstraints *globcst;
+
+    /* Solver session (isl context, query counts) for all emptiness and
+     * lexmin queries made on this program */
+    PlutoSolverSession *solver;
+
+    /* Farkas lemma results for the dependence polyhedra */
+    PlutoFarkasCache *farkas_cache;
+
+    /* Incoming/outgoing dependences of each statement */
+    PlutoDepIndex *dep_index;
 
     /* Hyperplane that was replaced in case concurrent start 
      * had been found*/
@@ -320,6 +390,8 @@ struct plutoProg{
 };
 typedef struct plutoProg PlutoProg;
 
+#define PLUTO_BITS_PER_WORD (8*sizeof(unsigned long))
+
 /*
  * A Ploop is NOT an AST loop; this is a dimension in the scattering tree
  * which is not a scalar one. Ploop exists in the polyhedral representation
@@ -330,6 +402,11 @@ typedef struct pLoop{
     int depth;
     Stmt **stmts;
     int nstmts;
+
+    /* Bitset of the ids of stmts (bit i of word i/PLUTO_BITS_PER_WORD);
+     * use pluto_loop_has_stmt to test membership */
+    unsigned long *stmt_set;
+    int stmt_set_len;
 } Ploop;
 
 struct pluto_dep_list {
@@ -368,8 +445,13 @@ typedef struct band{
 
 /* Globally visible, easily accessible data */
 /* It's declared in main.c (for pluto binary) and in libpluto.c for 
- * the library */
-extern PlutoOptions *options;
+ * the library. It is thread-local so that libpluto can be called from
+ * several threads at once: the pluto_schedule* entry points set it from
+ * their options argument, and threads Pluto starts itself (OpenMP regions,
+ * the --portfolio PIP thread) copy it from the thread that started them.
+ * It isn't exported from libpluto, so that it can't clash with a client's
+ * own symbols */
+extern __thread PlutoOptions *pluto_options __attribute__ ((visibility ("hidden")));
 
 void dep_alloc_members(Dep *);
 void dep_free(Dep *);
@@ -383,14 +465,14 @@ void pluto_detect_hyperplane_types_stmtwise(PlutoProg *prog);
 void pluto_compute_satisfaction_vectors(PlutoProg *prog);
 void pluto_compute_dep_directions(PlutoProg *prog);
 
-PlutoConstraints *get_permutability_constraints(PlutoProg *);
+PlutoSparseConstraints *get_permutability_constraints(PlutoProg *);
 PlutoConstraints *get_feautrier_schedule_constraints(PlutoProg *prog, Stmt **, int);
-PlutoConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
-        const PlutoConstraints *currcst, int *orthonum);
+PlutoSparseConstraints **get_stmt_ortho_constraints(Stmt *stmt, const PlutoProg *prog,
+        const PlutoSparseConstraints *currcst, int *orthonum);
 PlutoConstraints *get_global_independence_cst(
         PlutoConstraints ***ortho_cst, int *orthonum, 
         const PlutoProg *prog);
-PlutoConstraints *get_non_trivial_sol_constraints(const PlutoProg *, bool);
+PlutoSparseConstraints *get_non_trivial_sol_constraints(const PlutoProg *, bool);
 
 int pluto_auto_transform(PlutoProg *prog);
 int  pluto_multicore_codegen(FILE *fp, FILE *outfp, const PlutoProg *prog);
@@ -399,7 +481,9 @@ int  find_permutable_hyperplanes(PlutoProg *prog, bool lin_ind_mode,
         int max_sols, int band_depth);
 
 void detect_hyperplane_type(Stmt *stmts, int nstmts, Dep *deps, int ndeps, int, int, int);
-DepDir  get_dep_direction(const Dep *dep, const PlutoProg *prog, int level);
+DepDir  get_dep_direction(Dep *dep, const PlutoProg *prog, int level);
+bool dep_satisfaction_test(Dep *dep, PlutoProg *prog, int level);
+void pluto_dep_dir_cache_free(PlutoDepDirCache *cache);
 
 void getInnermostTilableBand(PlutoProg *prog, int *bandStart, int *bandEnd);
 void getOutermostTilableBand(PlutoProg *prog, int *bandStart, int *bandEnd);
@@ -449,6 +533,7 @@ void pluto_band_print(const Band *band);
 Band **pluto_get_outermost_permutable_bands(PlutoProg *prog, int *ndbands);
 Ploop *pluto_loop_dup(Ploop *l);
 int pluto_loop_is_parallel(const PlutoProg *prog, Ploop *loop);
+int pluto_loop_has_stmt(const Ploop *loop, int stmt_id);
 int pluto_loop_is_parallel_for_stmt(const PlutoProg *prog, const Ploop *loop, 
         const Stmt *stmt);
 int pluto_loop_has_satisfied_dep_with_component(const PlutoProg *prog, 
@@ -457,6 +542,7 @@ void pluto_bands_free(Band **bands, int nbands);
 int pluto_is_hyperplane_loop(const Stmt *stmt, int level);
 void pluto_detect_hyperplane_types(PlutoProg *prog);
 void pluto_tile_band(PlutoProg *prog, Band *band, int *tile_sizes);
+int pluto_stmt_get_tile_size(const Stmt *stmt, int level);
 
 Ploop **pluto_get_loops_under(Stmt **stmts, int nstmts, int depth,
         const PlutoProg *prog, int *num);
@@ -476,6 +562,7 @@ int pluto_detect_mark_unrollable_loops(PlutoProg *prog);
 int pluto_are_stmts_fused(Stmt **stmts, int nstmts, const PlutoProg *prog);
 
 void pluto_iss_dep(PlutoProg *prog);
-PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms, int npar, PlutoConstraints *);
+PlutoConstraints *pluto_find_iss(const PlutoConstraints **doms, int ndoms, int npar,
+        PlutoConstraints *, PlutoSolverSession *ss);
 void pluto_iss(Stmt *stmt, PlutoConstraints **cuts, int num_cuts, PlutoProg *prog);
 #endif
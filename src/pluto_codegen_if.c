@@ -30,6 +30,11 @@
 #include <stdbool.h>
 
 #include <cloog/cloog.h>
+#include <cloog/isl/cloog.h>
+
+#include <isl/ctx.h>
+#include <isl/set.h>
+#include <isl/map.h>
 
 #include "version.h"
 
@@ -38,6 +43,7 @@
 #include "constraints.h"
 #include "program.h"
 #include "ast_transform.h"
+#include "profile.h"
 
 static int get_first_point_loop(Stmt *stmt, const PlutoProg *prog)
 {
@@ -85,7 +91,7 @@ void pluto_gen_cloog_file(FILE *fp, const PlutoProg *prog)
 
     /* Context: setting conditions on parameters */
     PlutoConstraints *ctx = pluto_constraints_dup(prog->context);
-    pluto_constraints_intersect_isl(ctx, prog->codegen_context);
+    pluto_constraints_intersect_isl(ctx, prog->codegen_context, prog->solver);
     pluto_constraints_print_polylib(fp, ctx);
     pluto_constraints_free(ctx);
 
@@ -134,6 +140,94 @@ void pluto_gen_cloog_file(FILE *fp, const PlutoProg *prog)
     }
 }
 
+/* Parametric isl set from cst (possibly a union); the columns of cst are
+ * [dim set dims, npar params, const] */
+static __isl_give isl_set *cloog_isl_set_from_pluto_constraints(
+        const PlutoConstraints *cst, int npar, char **params, isl_ctx *ctx)
+{
+    int i;
+    int dim = cst->ncols - npar - 1;
+    isl_set *set = isl_set_empty(isl_space_set_alloc(ctx, npar, dim));
+
+    for (; cst != NULL; cst = cst->next) {
+        isl_basic_map *bmap = isl_basic_map_from_pluto_constraints(ctx, cst,
+                0, dim, npar);
+        set = isl_set_union(set, isl_set_from_basic_set(isl_basic_map_range(bmap)));
+    }
+
+    for (i=0; i<npar; i++) {
+        set = isl_set_set_dim_name(set, isl_dim_param, i, params[i]);
+    }
+
+    return set;
+}
+
+
+/* Build the CLooG input (context, domains, scatterings and names) directly
+ * from the transformations computed; this is what pluto_gen_cloog_file
+ * would print and CLooG would parse back */
+static CloogInput *pluto_gen_cloog_input(const PlutoProg *prog, isl_ctx *ctx)
+{
+    int i;
+    char name[16];
+    CloogDomain *context;
+    CloogUnionDomain *ud;
+
+    Stmt **stmts = prog->stmts;
+    int nstmts = prog->nstmts;
+    int npar = prog->npar;
+
+    IF_DEBUG(printf("[pluto] generating Cloog input...\n"));
+
+    /* Context: setting conditions on parameters */
+    PlutoConstraints *cst = pluto_constraints_dup(prog->context);
+    pluto_constraints_intersect_isl(cst, prog->codegen_context, prog->solver);
+    context = cloog_domain_from_isl_set(
+            cloog_isl_set_from_pluto_constraints(cst, npar, prog->params, ctx));
+    pluto_constraints_free(cst);
+
+    ud = cloog_union_domain_alloc(npar);
+
+    for (i=0; i<nstmts; i++)    {
+        CloogDomain *domain;
+        CloogScattering *scattering = NULL;
+
+        domain = cloog_domain_from_isl_set(cloog_isl_set_from_pluto_constraints(
+                    stmts[i]->domain, npar, prog->params, ctx));
+
+        if (stmts[0]->trans != NULL) {
+            int j;
+            isl_map *map;
+            PlutoConstraints *sched = pluto_stmt_get_schedule(stmts[i]);
+            int nrows = stmts[i]->trans->nrows;
+
+            map = isl_map_from_basic_map(isl_basic_map_from_pluto_constraints(
+                        ctx, sched, sched->ncols - nrows - npar - 1, nrows, npar));
+            for (j=0; j<npar; j++) {
+                map = isl_map_set_dim_name(map, isl_dim_param, j, prog->params[j]);
+            }
+            scattering = cloog_scattering_from_isl_map(map);
+            pluto_constraints_free(sched);
+        }
+
+        ud = cloog_union_domain_add_domain(ud, NULL, domain, scattering, NULL);
+    }
+
+    for (i=0; i<npar; i++)  {
+        ud = cloog_union_domain_set_name(ud, CLOOG_PARAM, i, prog->params[i]);
+    }
+
+    /* Setting target loop names (all stmts have same number of hyperplanes */
+    if (nstmts >= 1 && stmts[0]->trans != NULL) {
+        for (i=0; i<stmts[0]->trans->nrows; i++) {
+            snprintf(name, sizeof(name), "t%d", i+1);
+            ud = cloog_union_domain_set_name(ud, CLOOG_SCAT, i, name);
+        }
+    }
+
+    return cloog_input_alloc(context, ud);
+}
+
 static void gen_stmt_macro(const Stmt *stmt, FILE *outfp)
 {
     int j;
@@ -154,7 +248,7 @@ static void gen_stmt_macro(const Stmt *stmt, FILE *outfp)
     fprintf(outfp, ")\t");
 
     /* Generate pragmas for Bee/Cl@k */
-    if (options->bee)   {
+    if (pluto_options->bee)   {
         fprintf(outfp, " __bee_schedule");
         for (j=0; j<stmt->trans->nrows; j++)    {
             fprintf(outfp, "[");
@@ -195,7 +289,7 @@ int generate_declarations(const PlutoProg *prog, FILE *outfp)
         fprintf(outfp, ";\n\n");
     }
 
-    if (options->parallel)   {
+    if (pluto_options->parallel)   {
         fprintf(outfp, "\tint lb, ub, lbp, ubp, lb2, ub2;\n");
     }
     /* For vectorizable loop bound replacement */
@@ -211,6 +305,9 @@ int generate_declarations(const PlutoProg *prog, FILE *outfp)
  *
  * --cloogf, --cloogl overrides everything; next cloogf, cloogl if != -1,
  *  then the function takes care of the rest
+ *
+ * cloogfp: a .cloog file to read the CLooG input from; if NULL, the input is
+ * built in memory from prog (pluto_gen_cloog_input)
  */
 int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
         FILE *cloogfp, FILE *outfp)
@@ -218,6 +315,7 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
     CloogInput *input ;
     CloogOptions *cloogOptions ;
     CloogState *state;
+    isl_ctx *ctx;
     int i;
 
     struct clast_stmt *root;
@@ -225,7 +323,8 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
     Stmt **stmts = prog->stmts;
     int nstmts = prog->nstmts;
 
-    state = cloog_state_malloc();
+    ctx = isl_ctx_alloc();
+    state = cloog_isl_state_malloc(ctx);
     cloogOptions = cloog_options_malloc(state);
 
     cloogOptions->fs = malloc (nstmts*sizeof(int));
@@ -241,19 +340,19 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
     cloogOptions->compilable = 0;
     cloogOptions->esp = 1;
     cloogOptions->strides = 1;
-    cloogOptions->quiet = options->silent;
+    cloogOptions->quiet = pluto_options->silent;
 
     /* Generates better code in general */
-    cloogOptions->backtrack = options->cloogbacktrack;
+    cloogOptions->backtrack = pluto_options->cloogbacktrack;
 
-    if (options->cloogf >= 1 && options->cloogl >= 1) {
-        cloogOptions->f = options->cloogf;
-        cloogOptions->l = options->cloogl;
+    if (pluto_options->cloogf >= 1 && pluto_options->cloogl >= 1) {
+        cloogOptions->f = pluto_options->cloogf;
+        cloogOptions->l = pluto_options->cloogl;
     }else{
         if (cloogf >= 1 && cloogl >= 1) {
             cloogOptions->f = cloogf;
             cloogOptions->l = cloogl;
-        }else if (options->tile)   {
+        }else if (pluto_options->tile)   {
             for (i=0; i<nstmts; i++) {
                 cloogOptions->fs[i] = get_first_point_loop(stmts[i], prog)+1;
                 cloogOptions->ls[i] = prog->num_hyperplanes;
@@ -267,7 +366,7 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
         }
     }
 
-    if (!options->silent)   {
+    if (!pluto_options->silent)   {
         if (nstmts >= 1 && cloogOptions->fs[0] >= 1) {
             printf("[pluto] using statement-wise -fs/-ls options: ");
             for (i=0; i<nstmts; i++) {
@@ -281,21 +380,27 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
         }
     }
 
-    if (options->cloogsh)
+    if (pluto_options->cloogsh)
         cloogOptions->sh = 1;
 
     cloogOptions->name = "PLUTO-produced CLooG file";
 
     fprintf(outfp, "/* Start of CLooG code */\n");
     /* Get the code from CLooG */
-    IF_DEBUG(printf("[pluto] cloog_input_read\n"));
-    input = cloog_input_read(cloogfp, cloogOptions) ;
+    double t_start = pluto_profile_clock();
+    if (cloogfp != NULL) {
+        IF_DEBUG(printf("[pluto] cloog_input_read\n"));
+        input = cloog_input_read(cloogfp, cloogOptions) ;
+    }else{
+        input = pluto_gen_cloog_input(prog, ctx);
+    }
     IF_DEBUG(printf("[pluto] cloog_clast_create\n"));
     root = cloog_clast_create_from_input(input, cloogOptions);
-    if (options->prevector) {
+    pluto_profile_add_phase("cloog", pluto_profile_clock() - t_start);
+    if (pluto_options->prevector) {
         pluto_mark_vector(root, prog, cloogOptions);
     }
-    if (options->parallel) {
+    if (pluto_options->parallel) {
         pluto_mark_parallel(root, prog, cloogOptions);
     }
     clast_pprint(outfp, root, 0, cloogOptions);
@@ -305,6 +410,7 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
 
     cloog_options_free(cloogOptions);
     cloog_state_free(state);
+    isl_ctx_free(ctx);
 
     return 0;
 }
@@ -314,12 +420,12 @@ int pluto_gen_cloog_code(const PlutoProg *prog, int cloogf, int cloogl,
  * pragmas later */
 int pluto_multicore_codegen(FILE *cloogfp, FILE *outfp, const PlutoProg *prog)
 { 
-    if (options->parallel)  {
+    if (pluto_options->parallel)  {
         fprintf(outfp, "#include <omp.h>\n\n");
     }
     generate_declarations(prog, outfp);
 
-    if (options->multipar) {
+    if (pluto_options->multipar) {
         fprintf(outfp, "\tomp_set_nested(1);\n");
         fprintf(outfp, "\tomp_set_num_threads(2);\n");
     }
@@ -374,14 +480,14 @@ int pluto_omp_parallelize(PlutoProg *prog)
 
             fprintf(outfp,  ") private(");
 
-            if (options->prevector) {
+            if (pluto_options->prevector) {
                 fprintf(outfp,  "ubv,lbv,");
             }
 
             /* Lower and upper scalars for parallel loops yet to be marked */
             /* NOTE: we extract up to 2 degrees of parallelism
             */
-            if (options->multipar) {
+            if (pluto_options->multipar) {
                 for (i=num_parallel_loops+1; i<2; i++) {
                     fprintf(outfp,  "lb%d,ub%d,", i+1, i+1);
                 }
@@ -395,7 +501,7 @@ int pluto_omp_parallelize(PlutoProg *prog)
 
             num_parallel_loops++;
 
-            if (!options->multipar || num_parallel_loops == 2)   {
+            if (!pluto_options->multipar || num_parallel_loops == 2)   {
                 break;
             }
         }
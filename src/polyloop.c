@@ -22,6 +22,7 @@
  * AST is generated, a single Ploop can get separated into multiple ones.
  *
  */
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 
@@ -34,10 +35,49 @@ Ploop *pluto_loop_alloc()
     loop->nstmts = 0;
     loop->depth = -1;
     loop->stmts = NULL;
+    loop->stmt_set = NULL;
+    loop->stmt_set_len = 0;
     return loop;
 }
 
 
+/* (Re)build the membership bitset of the loop's statements; to be called
+ * once loop->stmts is set */
+static void pluto_loop_index_stmts(Ploop *loop)
+{
+    int i, max_id;
+
+    max_id = -1;
+    for (i=0; i<loop->nstmts; i++) {
+        max_id = PLMAX(max_id, loop->stmts[i]->id);
+    }
+
+    free(loop->stmt_set);
+    loop->stmt_set_len = max_id/PLUTO_BITS_PER_WORD + 1;
+    loop->stmt_set = (unsigned long *) calloc(loop->stmt_set_len,
+            sizeof(unsigned long));
+
+    for (i=0; i<loop->nstmts; i++) {
+        int id = loop->stmts[i]->id;
+        loop->stmt_set[id/PLUTO_BITS_PER_WORD] |= 1UL << (id%PLUTO_BITS_PER_WORD);
+    }
+}
+
+
+/* Is the statement with this id under the loop? Same as
+ * pluto_stmt_is_member_of(stmt_id, loop->stmts, loop->nstmts), in constant
+ * time */
+int pluto_loop_has_stmt(const Ploop *loop, int stmt_id)
+{
+    if (stmt_id < 0 || stmt_id/PLUTO_BITS_PER_WORD >= loop->stmt_set_len) {
+        return 0;
+    }
+
+    return (loop->stmt_set[stmt_id/PLUTO_BITS_PER_WORD]
+            >> (stmt_id%PLUTO_BITS_PER_WORD)) & 1;
+}
+
+
 void pluto_loop_print(const Ploop *loop)
 {
     int i;
@@ -66,6 +106,7 @@ Ploop *pluto_loop_dup(Ploop *l)
     loop->nstmts = l->nstmts;
     loop->stmts = malloc(loop->nstmts*sizeof(Stmt *));
     memcpy(loop->stmts, l->stmts, l->nstmts*sizeof(Stmt *));
+    pluto_loop_index_stmts(loop);
     return loop;
 }
 
@@ -76,6 +117,7 @@ void pluto_loop_free(Ploop *loop)
     if (loop->stmts != NULL) {
         free(loop->stmts);
     }
+    free(loop->stmt_set);
     free(loop);
 }
 
@@ -174,6 +216,7 @@ Ploop **pluto_get_loops_under(Stmt **stmts, int nstmts, int depth,
         }
         this_loop->nstmts = loop_nstmts;
         this_loop->depth = depth;
+        pluto_loop_index_stmts(this_loop);
         /* Even with H_LOOP, some statements can have a scalar dimension - at
          * least one of the statements is a real loop (doesn't happen often
          * though */
@@ -281,9 +324,8 @@ int pluto_loop_has_satisfied_dep_with_component(const PlutoProg *prog,
         Dep *dep = prog->deps[i];
         if (IS_RAR(dep->type)) continue;
         assert(dep->satvec != NULL);
-        if (pluto_stmt_is_member_of(prog->stmts[dep->src]->id, loop->stmts, loop->nstmts)
-                && pluto_stmt_is_member_of(prog->stmts[dep->dest]->id, loop->stmts, 
-                    loop->nstmts)
+        if (pluto_loop_has_stmt(loop, prog->stmts[dep->src]->id)
+                && pluto_loop_has_stmt(loop, prog->stmts[dep->dest]->id)
                 && dep->satisfaction_level < loop->depth
                 && (dep->dirvec[loop->depth] == DEP_STAR
                   || dep->dirvec[loop->depth] == DEP_PLUS
@@ -315,14 +357,17 @@ int pluto_loop_is_parallel(const PlutoProg *prog, Ploop *loop)
 
     parallel = 1;
 
-    for (i=0; i<prog->ndeps; i++) {
-        Dep *dep = prog->deps[i];
-        if (IS_RAR(dep->type)) continue;
-        assert(dep->satvec != NULL);
-        if (pluto_stmt_is_member_of(prog->stmts[dep->src]->id, loop->stmts, loop->nstmts)
-                && pluto_stmt_is_member_of(prog->stmts[dep->dest]->id, loop->stmts, 
-                    loop->nstmts)) {
-            if (dep->satvec[loop->depth]) {
+    /* Only deps going out of the loop's statements can be carried by it */
+    const PlutoDepIndex *index = pluto_prog_get_dep_index(prog);
+    for (i=0; i<loop->nstmts && parallel; i++) {
+        int e, s = loop->stmts[i]->id;
+        assert(prog->stmts[s] == loop->stmts[i]);
+        for (e=index->deps.out_start[s]; e<index->deps.out_start[s+1]; e++) {
+            Dep *dep = prog->deps[index->deps.out[e]];
+            if (IS_RAR(dep->type)) continue;
+            assert(dep->satvec != NULL);
+            if (pluto_loop_has_stmt(loop, prog->stmts[dep->dest]->id)
+                    && dep->satvec[loop->depth]) {
                 parallel = 0;
                 break;
             }
@@ -398,8 +443,8 @@ int pluto_satisfies_inter_stmt_dep(const PlutoProg *prog,
         assert(dep->satvec != NULL);
 
         if (dep->src == dep->dest
-                || !pluto_stmt_is_member_of(dep->src, loop->stmts, loop->nstmts)
-                || !pluto_stmt_is_member_of(dep->dest, loop->stmts, loop->nstmts)) {
+                || !pluto_loop_has_stmt(loop, dep->src)
+                || !pluto_loop_has_stmt(loop, dep->dest)) {
             continue;
         }
 
@@ -658,9 +703,8 @@ Band *pluto_get_permutable_band(Ploop *loop, PlutoProg *prog)
              * don't count as well (i.e., they can have negative components) */
             if (pluto_is_depth_scalar(loop, dep->satisfaction_level)) continue;
             /* Rest of the dependences need to have non-negative components */
-            if (pluto_stmt_is_member_of(prog->stmts[dep->src]->id, loop->stmts, loop->nstmts)
-                    && pluto_stmt_is_member_of(prog->stmts[dep->dest]->id, loop->stmts, 
-                        loop->nstmts)) {
+            if (pluto_loop_has_stmt(loop, prog->stmts[dep->src]->id)
+                    && pluto_loop_has_stmt(loop, prog->stmts[dep->dest]->id)) {
                 if (dep->dirvec[depth] == DEP_STAR || dep->dirvec[depth] == DEP_MINUS) 
                     break;
             }
@@ -709,8 +753,8 @@ Band *pluto_get_parallel_band(Ploop *loop, PlutoProg *prog, int *innermost_split
             if (IS_RAR(dep->type)) continue;
             /* Dependences where both the source and sink don't lie in the
              * band don't matter */
-            if (!pluto_stmt_is_member_of(prog->stmts[dep->src]->id, loop->stmts, loop->nstmts)
-                    || !pluto_stmt_is_member_of(prog->stmts[dep->dest]->id, loop->stmts, loop->nstmts))
+            if (!pluto_loop_has_stmt(loop, prog->stmts[dep->src]->id)
+                    || !pluto_loop_has_stmt(loop, prog->stmts[dep->dest]->id))
                 continue;
             assert(dep->satvec != NULL);
             /* Dependences satisfied outer to the band don't matter */
@@ -247,7 +247,7 @@ int pluto_detect_mark_unrollable_loops(PlutoProg *prog)
 
     if (bandEnd == lastloop && bandStart < bandEnd)   {
         /* Leave alone the vectorizable loop */
-        if (hProps[bandEnd].dep_prop == PARALLEL && options->prevector == 1)  {
+        if (hProps[bandEnd].dep_prop == PARALLEL && pluto_options->prevector == 1)  {
             for (i=PLMAX(bandEnd-2, bandStart); i<=bandEnd-1; i++)    {
                 if (hProps[i].type == H_TILE_SPACE_LOOP)   continue;
                 prog->hProps[i].unroll = UNROLLJAM;
@@ -266,7 +266,7 @@ int pluto_detect_mark_unrollable_loops(PlutoProg *prog)
     }else{
         /* Can unroll only the last loop of course - leave alone if it's
          * vectorizable  */
-        if (hProps[lastloop].dep_prop != PARALLEL || options->prevector == 0) {
+        if (hProps[lastloop].dep_prop != PARALLEL || pluto_options->prevector == 0) {
             hProps[lastloop].unroll = UNROLL;
             numUnrollableLoops=1;
         }
@@ -306,9 +306,9 @@ int gen_unroll_file(PlutoProg *prog)
 
     for (i=0; i<prog->num_hyperplanes; i++) {
         if (hProps[i].unroll == UNROLL)  {
-            fprintf(unrollfp, "t%d Unroll %d\n", i+1, options->ufactor);
+            fprintf(unrollfp, "t%d Unroll %d\n", i+1, pluto_options->ufactor);
         }else if (hProps[i].unroll == UNROLLJAM)    {
-            fprintf(unrollfp, "t%d UnrollJam %d\n", i+1, options->ufactor);
+            fprintf(unrollfp, "t%d UnrollJam %d\n", i+1, pluto_options->ufactor);
         }
     }
 
@@ -389,7 +389,7 @@ int pluto_intra_tile_optimize(PlutoProg *prog, int is_tiled)
         /* Detect properties again */
         pluto_compute_dep_directions(prog);
         pluto_compute_dep_satisfaction(prog);
-        if (!options->silent) {
+        if (!pluto_options->silent) {
             printf("[pluto] After intra-tile optimize\n");
             pluto_transformations_pretty_print(prog);
         }
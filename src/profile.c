@@ -0,0 +1,278 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ *
+ * Copyright (C) 2007-2012 Uday Bondhugula
+ *
+ * This file is part of Pluto.
+ *
+ * Pluto is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the file
+ * `LICENSE' in the top-level directory of this distribution.
+ *
+ * profile.c
+ *
+ * Compile-time profile (phase times, solver calls) written as JSON
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pluto.h"
+#include "constraints.h"
+#include "profile.h"
+
+#define PROF_MAX_PHASES 32
+
+struct prof_phase {
+    const char *name;
+    double time;
+    int count;
+};
+
+struct prof_band {
+    int depth;
+    int nsols;
+    double time;
+};
+
+struct prof_solver_call {
+    PlutoSolverCallType type;
+    int nrows;
+    int ncols;
+    double time;
+};
+
+struct prof_portfolio_query {
+    int nrows;
+    int ncols;
+    int nnz;
+    PlutoSolverBackend winner;
+    /* 0 if only isl was run (PIP was busy) */
+    int raced;
+    double time;
+};
+
+static struct prof_phase phases[PROF_MAX_PHASES];
+static int nphases = 0;
+
+static struct prof_band *bands = NULL;
+static int nbands = 0, alloc_bands = 0;
+
+static struct prof_solver_call *calls = NULL;
+static int ncalls = 0, alloc_calls = 0;
+
+static struct prof_portfolio_query *queries = NULL;
+static int nqueries = 0, alloc_queries = 0;
+
+static const char *call_type_names[] = {"lexmin", "is_empty", "range"};
+static const char *backend_names[] = {"isl", "pip"};
+
+
+int pluto_profile_enabled()
+{
+    return pluto_options->profile != NULL;
+}
+
+
+double pluto_profile_clock()
+{
+    struct timeval tp;
+    gettimeofday(&tp, NULL);
+    return (tp.tv_sec + tp.tv_usec*1.0e-6);
+}
+
+
+/* Time is accumulated across all occurrences of a phase */
+void pluto_profile_add_phase(const char *name, double time)
+{
+    int i;
+
+    if (!pluto_profile_enabled()) return;
+
+#pragma omp critical (profile)
+    {
+        for (i=0; i<nphases; i++) {
+            if (!strcmp(phases[i].name, name)) break;
+        }
+        if (i == nphases && nphases < PROF_MAX_PHASES) {
+            phases[i].name = name;
+            phases[i].time = 0.0;
+            phases[i].count = 0;
+            nphases++;
+        }
+        if (i < nphases) {
+            phases[i].time += time;
+            phases[i].count++;
+        }
+    }
+}
+
+
+void pluto_profile_add_band(int depth, int nsols, double time)
+{
+    if (!pluto_profile_enabled()) return;
+
+#pragma omp critical (profile)
+    {
+        if (nbands == alloc_bands) {
+            alloc_bands = alloc_bands? 2*alloc_bands: 16;
+            bands = (struct prof_band *) realloc(bands,
+                    alloc_bands*sizeof(struct prof_band));
+        }
+        bands[nbands].depth = depth;
+        bands[nbands].nsols = nsols;
+        bands[nbands].time = time;
+        nbands++;
+    }
+}
+
+
+void pluto_profile_add_solver_call(PlutoSolverCallType type, int nrows,
+        int ncols, double time)
+{
+    if (!pluto_profile_enabled()) return;
+
+#pragma omp critical (profile)
+    {
+        if (ncalls == alloc_calls) {
+            alloc_calls = alloc_calls? 2*alloc_calls: 256;
+            calls = (struct prof_solver_call *) realloc(calls,
+                    alloc_calls*sizeof(struct prof_solver_call));
+        }
+        calls[ncalls].type = type;
+        calls[ncalls].nrows = nrows;
+        calls[ncalls].ncols = ncols;
+        calls[ncalls].time = time;
+        ncalls++;
+    }
+}
+
+
+void pluto_profile_add_portfolio_query(int nrows, int ncols, int nnz,
+        PlutoSolverBackend winner, int raced, double time)
+{
+    if (!pluto_profile_enabled()) return;
+
+#pragma omp critical (profile)
+    {
+        if (nqueries == alloc_queries) {
+            alloc_queries = alloc_queries? 2*alloc_queries: 64;
+            queries = (struct prof_portfolio_query *) realloc(queries,
+                    alloc_queries*sizeof(struct prof_portfolio_query));
+        }
+        queries[nqueries].nrows = nrows;
+        queries[nqueries].ncols = ncols;
+        queries[nqueries].nnz = nnz;
+        queries[nqueries].winner = winner;
+        queries[nqueries].raced = raced;
+        queries[nqueries].time = time;
+        nqueries++;
+    }
+}
+
+
+/* Peak resident set size of the process in KB (0 if unknown) */
+static long get_peak_rss_kb()
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+/* 'fm_stats' are the Fourier-Motzkin statistics of the program */
+void pluto_profile_print_json(FILE *fp, const PlutoFMStats *fm_stats)
+{
+    int i, t, peak_rows;
+
+    peak_rows = fm_stats->peak_rows;
+
+    fprintf(fp, "{\n  \"phases\": {");
+    for (i=0; i<nphases; i++) {
+        fprintf(fp, "%s\n    \"%s\": {\"time\": %0.6lf, \"count\": %d}",
+                i? ",": "", phases[i].name, phases[i].time, phases[i].count);
+    }
+    fprintf(fp, "\n  },\n");
+
+    fprintf(fp, "  \"bands\": [");
+    for (i=0; i<nbands; i++) {
+        fprintf(fp, "%s\n    {\"depth\": %d, \"hyperplanes\": %d, \"time\": %0.6lf}",
+                i? ",": "", bands[i].depth, bands[i].nsols, bands[i].time);
+    }
+    fprintf(fp, "\n  ],\n");
+
+    fprintf(fp, "  \"solver\": {\n");
+    for (t=PROF_LEXMIN; t<=PROF_RANGE; t++) {
+        long count = 0, rows = 0, cols = 0;
+        int max_rows = 0, max_cols = 0;
+        double time = 0.0;
+        for (i=0; i<ncalls; i++) {
+            if (calls[i].type != t) continue;
+            count++;
+            rows += calls[i].nrows;
+            cols += calls[i].ncols;
+            max_rows = PLMAX(max_rows, calls[i].nrows);
+            max_cols = PLMAX(max_cols, calls[i].ncols);
+            time += calls[i].time;
+        }
+        peak_rows = PLMAX(peak_rows, max_rows);
+        fprintf(fp, "    \"%s\": {\"count\": %ld, \"rows\": %ld, \"cols\": %ld, "
+                "\"max_rows\": %d, \"max_cols\": %d, \"time\": %0.6lf},\n",
+                call_type_names[t], count, rows, cols, max_rows, max_cols, time);
+    }
+    fprintf(fp, "    \"calls\": [");
+    for (i=0; i<ncalls; i++) {
+        fprintf(fp, "%s\n      {\"type\": \"%s\", \"rows\": %d, \"cols\": %d, \"time\": %0.6lf}",
+                i? ",": "", call_type_names[calls[i].type], calls[i].nrows,
+                calls[i].ncols, calls[i].time);
+    }
+    fprintf(fp, "\n    ]\n  },\n");
+
+    fprintf(fp, "  \"portfolio\": [");
+    for (i=0; i<nqueries; i++) {
+        fprintf(fp, "%s\n    {\"rows\": %d, \"cols\": %d, \"nnz\": %d, "
+                "\"winner\": \"%s\", \"raced\": %s, \"time\": %0.6lf}",
+                i? ",": "", queries[i].nrows, queries[i].ncols, queries[i].nnz,
+                backend_names[queries[i].winner], queries[i].raced? "true": "false",
+                queries[i].time);
+    }
+    fprintf(fp, "\n  ],\n");
+
+    fprintf(fp, "  \"peak_constraint_rows\": %d,\n", peak_rows);
+    fprintf(fp, "  \"peak_rss_kb\": %ld\n", get_peak_rss_kb());
+    fprintf(fp, "}\n");
+}
+
+
+void pluto_profile_free()
+{
+    free(bands);
+    free(calls);
+    free(queries);
+    bands = NULL;
+    calls = NULL;
+    queries = NULL;
+    nbands = alloc_bands = 0;
+    ncalls = alloc_calls = 0;
+    nqueries = alloc_queries = 0;
+    nphases = 0;
+}
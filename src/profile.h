@@ -0,0 +1,50 @@
+/*
+ * PLUTO: An automatic parallelizer and locality optimizer
+ * 
+ * Copyright (C) 2007 Uday Bondhugula
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A copy of the GNU General Public Licence can be found in the 
+ * top-level directory of this program (`COPYING') 
+ *
+ */
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdio.h>
+
+/* Kinds of solver queries recorded */
+typedef enum solvercalltype {PROF_LEXMIN=0, PROF_IS_EMPTY, PROF_RANGE}
+    PlutoSolverCallType;
+
+/* ILP back ends raced with --portfolio */
+typedef enum solverbackend {SOLVER_ISL=0, SOLVER_PIP} PlutoSolverBackend;
+
+/*
+ * Compile-time profile (--profile): wall time of phases, of each band
+ * search, size/time of every solver call, and the back end that answered
+ * each --portfolio query. Nothing is recorded unless
+ * options->profile is set
+ */
+int pluto_profile_enabled();
+double pluto_profile_clock();
+void pluto_profile_add_phase(const char *name, double time);
+void pluto_profile_add_band(int depth, int nsols, double time);
+void pluto_profile_add_solver_call(PlutoSolverCallType type, int nrows,
+        int ncols, double time);
+void pluto_profile_add_portfolio_query(int nrows, int ncols, int nnz,
+        PlutoSolverBackend winner, int raced, double time);
+struct pluto_fm_stats;
+void pluto_profile_print_json(FILE *fp, const struct pluto_fm_stats *fm_stats);
+void pluto_profile_free();
+
+#endif
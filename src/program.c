@@ -35,6 +35,7 @@
 #include "math_support.h"
 #include "constraints.h"
 #include "program.h"
+#include "profile.h"
 
 #include "osl/macros.h"
 #include "osl/scop.h"
@@ -70,6 +71,7 @@ void pluto_add_dep(PlutoProg *prog, Dep *dep)
     prog->ndeps++;
     prog->deps = (Dep **) realloc(prog->deps, sizeof(Dep *)*prog->ndeps);
     prog->deps[prog->ndeps-1] = dep;
+    pluto_prog_invalidate_dep_index(prog);
 }
 
 
@@ -1007,6 +1009,7 @@ static Dep **deps_read(osl_dependence_p candlDeps, PlutoProg *prog)
         //candl_matrix_print(stdout, candl_dep->domain);
         dep->dpolytope = osl_dep_domain_to_pluto_constraints(candl_dep);
         dep->bounding_poly = pluto_constraints_dup(dep->dpolytope);
+        pluto_dep_detect_uniform(dep, stmts);
 
         pluto_constraints_set_names_range(dep->dpolytope,
                stmts[dep->src]->iterators, 0, 0, stmts[dep->src]->dim);
@@ -1538,8 +1541,10 @@ void pluto_dep_free(Dep *dep)
     if (dep->dirvec) {
         free(dep->satvec);
     }
-    pluto_constraints_free(dep->cst);
-    pluto_constraints_free(dep->bounding_cst);
+    free(dep->distvec);
+    pluto_dep_dir_cache_free(dep->dircache);
+    pluto_sparse_constraints_free(dep->cst);
+    pluto_sparse_constraints_free(dep->bounding_cst);
     free(dep);
 }
 
@@ -1914,6 +1919,7 @@ static int basic_map_extract_dep(__isl_take isl_basic_map *bmap, void *user)
     dep->type = info->type;
     dep->src = atoi(isl_basic_map_get_tuple_name(bmap, isl_dim_in) + 2);
     dep->dest = atoi(isl_basic_map_get_tuple_name(bmap, isl_dim_out) + 2);
+    pluto_dep_detect_uniform(dep, stmts);
 
     /* Inconsistent dependence if this assertion fails */
     assert(dep->dpolytope->ncols == stmts[dep->src]->dim + stmts[dep->dest]->dim 
@@ -1947,7 +1953,7 @@ static int basic_map_extract_dep(__isl_take isl_basic_map *bmap, void *user)
     // pluto_stmt_print(stdout, stmts[dep->dest]);
     // printf("Src acc: %d dest acc: %d\n", src_acc_num, dest_acc_num);
 
-    if (options->isldepaccesswise && 
+    if (pluto_options->isldepaccesswise && 
             (stmts[dep->src]->reads != NULL && stmts[dep->dest]->reads != NULL)) {
         /* Extract access function information */
         int src_acc_num, dest_acc_num;
@@ -2504,6 +2510,7 @@ PlutoProg *scop_to_pluto_prog(osl_scop_p scop, PlutoOptions *options)
     prog->scop = scop;
 
     /* Compute dependences */
+    double t_start = pluto_profile_clock();
     if (options->isldep) {
         compute_deps(scop, prog, options);
     }else{
@@ -2532,6 +2539,7 @@ PlutoProg *scop_to_pluto_prog(osl_scop_p scop, PlutoOptions *options)
         prog->transdeps = NULL;
         prog->ntransdeps = 0;
     }
+    pluto_profile_add_phase("compute_deps", pluto_profile_clock() - t_start);
 
     /* Add hyperplanes */
     if (prog->nstmts >= 1) {
@@ -2608,6 +2616,11 @@ PlutoProg *pluto_prog_alloc()
 
     prog->globcst = NULL;
 
+    prog->solver = pluto_solver_session_alloc();
+    prog->farkas_cache = pluto_farkas_cache_alloc();
+
+    prog->dep_index = (PlutoDepIndex *) calloc(1, sizeof(PlutoDepIndex));
+
     return prog;
 }
 
@@ -2655,12 +2668,110 @@ void pluto_prog_free(PlutoProg *prog)
     pluto_constraints_free(prog->context);
     pluto_constraints_free(prog->codegen_context);
 
-    pluto_constraints_free(prog->globcst);
+    pluto_sparse_constraints_free(prog->globcst);
+
+    pluto_solver_session_free(prog->solver);
+    pluto_farkas_cache_free(prog->farkas_cache);
+
+    pluto_prog_invalidate_dep_index(prog);
+    free(prog->dep_index);
 
     free(prog);
 }
 
 
+static void pluto_stmt_dep_lists_free(PlutoStmtDepLists *lists)
+{
+    free(lists->out_start);
+    free(lists->out);
+    free(lists->in_start);
+    free(lists->in);
+    lists->out_start = lists->out = lists->in_start = lists->in = NULL;
+}
+
+
+/* Group deps[0..ndeps-1] by source and by destination statement (counting
+ * sort; deps appear in each statement's list in their order in deps) */
+static void pluto_stmt_dep_lists_build(PlutoStmtDepLists *lists, Dep **deps,
+        int ndeps, int nstmts)
+{
+    int i, s;
+
+    lists->out_start = (int *) calloc(nstmts+1, sizeof(int));
+    lists->in_start = (int *) calloc(nstmts+1, sizeof(int));
+    lists->out = (int *) malloc(PLMAX(1, ndeps)*sizeof(int));
+    lists->in = (int *) malloc(PLMAX(1, ndeps)*sizeof(int));
+
+    for (i=0; i<ndeps; i++) {
+        assert(deps[i]->src < nstmts && deps[i]->dest < nstmts);
+        lists->out_start[deps[i]->src+1]++;
+        lists->in_start[deps[i]->dest+1]++;
+    }
+    for (s=0; s<nstmts; s++) {
+        lists->out_start[s+1] += lists->out_start[s];
+        lists->in_start[s+1] += lists->in_start[s];
+    }
+
+    int next_out[PLMAX(1, nstmts)], next_in[PLMAX(1, nstmts)];
+    memcpy(next_out, lists->out_start, nstmts*sizeof(int));
+    memcpy(next_in, lists->in_start, nstmts*sizeof(int));
+
+    for (i=0; i<ndeps; i++) {
+        lists->out[next_out[deps[i]->src]++] = i;
+        lists->in[next_in[deps[i]->dest]++] = i;
+    }
+}
+
+
+/* Drop the per-statement dependence lists; to be called when deps are
+ * added, removed, or have their source/destination changed in place */
+void pluto_prog_invalidate_dep_index(const PlutoProg *prog)
+{
+    PlutoDepIndex *index = prog->dep_index;
+
+    pluto_stmt_dep_lists_free(&index->deps);
+    pluto_stmt_dep_lists_free(&index->transdeps);
+    index->valid = false;
+}
+
+
+/*
+ * Incoming and outgoing dependences (of both prog->deps and
+ * prog->transdeps) of each statement, indexed by statement id, so that
+ * per-statement dependence queries are proportional to the statement's
+ * degree. Built on first use and rebuilt whenever the program's statements
+ * or dependence lists have changed
+ */
+const PlutoDepIndex *pluto_prog_get_dep_index(const PlutoProg *prog)
+{
+    PlutoDepIndex *index = prog->dep_index;
+
+    if (index->valid && index->dep_list == prog->deps
+            && index->ndeps == prog->ndeps
+            && index->transdep_list == prog->transdeps
+            && index->ntransdeps == prog->ntransdeps
+            && index->nstmts == prog->nstmts) {
+        return index;
+    }
+
+    pluto_prog_invalidate_dep_index(prog);
+
+    pluto_stmt_dep_lists_build(&index->deps, prog->deps, prog->ndeps,
+            prog->nstmts);
+    pluto_stmt_dep_lists_build(&index->transdeps, prog->transdeps,
+            prog->ntransdeps, prog->nstmts);
+
+    index->dep_list = prog->deps;
+    index->ndeps = prog->ndeps;
+    index->transdep_list = prog->transdeps;
+    index->ntransdeps = prog->ntransdeps;
+    index->nstmts = prog->nstmts;
+    index->valid = true;
+
+    return index;
+}
+
+
 PlutoOptions *pluto_options_alloc()
 {
     PlutoOptions *options;
@@ -2743,6 +2854,23 @@ PlutoOptions *pluto_options_alloc()
 
     options->time = 0;
 
+    options->nthreads = 1;
+
+    options->lpredun = 0;
+
+    options->presolve = 0;
+
+    options->portfolio = 0;
+
+    options->ilp_capture_dir = NULL;
+
+    options->cluster = 0;
+
+    options->profile = NULL;
+
+    options->cache_dir = NULL;
+    options->cache_output = 0;
+
     return options;
 }
 
@@ -2788,10 +2916,45 @@ void pluto_options_free(PlutoOptions *options)
     if (options->out_file != NULL)  {
         free(options->out_file);
     }
+    if (options->profile != NULL)  {
+        free(options->profile);
+    }
+    if (options->ilp_capture_dir != NULL)  {
+        free(options->ilp_capture_dir);
+    }
+    if (options->cache_dir != NULL)  {
+        free(options->cache_dir);
+    }
     free(options);
 }
 
 
+/*
+ * Update the distance vector of a uniform self dependence of a statement
+ * (that now has 'dim' dimensions) to which dimension 'pos' was added. A
+ * dimension added without a scattering row (time_pos == -1) is one that is
+ * sunk to a constant (pluto_sink_statement): the distance along it is zero.
+ * Any other new dimension (tile space, for eg.) doesn't in general keep the
+ * dependence uniform
+ */
+static void pluto_dep_distvec_add_dim(Dep *dep, int dim, int pos, int time_pos)
+{
+    int i;
+
+    if (time_pos != -1) {
+        free(dep->distvec);
+        dep->distvec = NULL;
+        return;
+    }
+
+    dep->distvec = (int64 *) realloc(dep->distvec, dim*sizeof(int64));
+    for (i=dim-2; i>=pos; i--) {
+        dep->distvec[i+1] = dep->distvec[i];
+    }
+    dep->distvec[pos] = 0;
+}
+
+
 /* pos: position of domain iterator 
  * time_pos: position of time iterator; iter: domain iterator; supply -1
  * if you don't want a scattering function row added for it */
@@ -2847,6 +3010,10 @@ void pluto_stmt_add_dim(Stmt *stmt, int pos, int time_pos, const char *iter,
 
     /* Update dependences */
     for (i=0; i<prog->ndeps; i++) {
+        if (prog->deps[i]->src == stmt->id && prog->deps[i]->dest == stmt->id
+                && prog->deps[i]->distvec != NULL) {
+            pluto_dep_distvec_add_dim(prog->deps[i], stmt->dim, pos, time_pos);
+        }
         if (prog->deps[i]->src == stmt->id) {
             pluto_constraints_add_dim(prog->deps[i]->dpolytope, pos, NULL);
             pluto_constraints_add_dim(prog->deps[i]->bounding_poly, pos, NULL);
@@ -2878,7 +3045,7 @@ void pluto_stmt_add_dim(Stmt *stmt, int pos, int time_pos, const char *iter,
  * anything else */
 void pluto_stmt_remove_dim(Stmt *stmt, int pos, PlutoProg *prog)
 {
-    int i, npar;
+    int i, j, npar;
 
     npar = stmt->domain->ncols - stmt->dim - 1;
 
@@ -2915,6 +3082,13 @@ void pluto_stmt_remove_dim(Stmt *stmt, int pos, PlutoProg *prog)
 
     /* Update deps */
     for (i=0; i<prog->ndeps; i++) {
+        if (prog->deps[i]->src == stmt->id && prog->deps[i]->dest == stmt->id
+                && prog->deps[i]->distvec != NULL) {
+            /* Distances along the remaining dimensions are unaffected */
+            for (j=pos; j<stmt->dim; j++) {
+                prog->deps[i]->distvec[j] = prog->deps[i]->distvec[j+1];
+            }
+        }
         if (prog->deps[i]->src == stmt->id) {
             pluto_constraints_remove_dim(prog->deps[i]->dpolytope, pos);
         }
@@ -3108,6 +3282,8 @@ Dep *pluto_dep_alloc()
     dep->cst = NULL;
     dep->bounding_cst = NULL;
     dep->src_unique_dpolytope = NULL;
+    dep->distvec = NULL;
+    dep->dircache = NULL;
 
     return dep;
 }
@@ -3136,12 +3312,86 @@ Dep *pluto_dep_dup(Dep *d)
     dep->satisfied = d->satisfied;
     dep->satisfaction_level = d->satisfaction_level;
     dep->dirvec = NULL; // TODO
-    dep->cst = d->cst? pluto_constraints_dup(d->cst): NULL;
-    dep->bounding_cst = d->bounding_cst? pluto_constraints_dup(d->bounding_cst): NULL;
+    dep->cst = d->cst? pluto_sparse_constraints_dup(d->cst): NULL;
+    dep->bounding_cst = d->bounding_cst? pluto_sparse_constraints_dup(d->bounding_cst): NULL;
+    /* Length isn't known here; callers re-detect if needed */
+    dep->distvec = NULL;
+    dep->dircache = NULL;
 
     return dep;
 }
 
+
+/*
+ * Detect whether 'dep' is a uniform dependence: a self dependence for which
+ * the distance along every dimension (t_r - s_r) is a constant implied by
+ * the equalities of its polyhedron. If so, the distance vector is stored in
+ * dep->distvec (of length the dimensionality of the statement). Purely
+ * algebraic: no solver calls
+ */
+void pluto_dep_detect_uniform(Dep *dep, Stmt **stmts)
+{
+    int i, r, dim, nvars;
+    int64 *distvec;
+    PlutoMatrix *eq, *mat;
+
+    free(dep->distvec);
+    dep->distvec = NULL;
+
+    if (dep->src != dep->dest)  return;
+
+    dim = stmts[dep->src]->dim;
+    if (dim == 0)   return;
+
+    eq = pluto_constraints_extract_equalities(dep->dpolytope);
+
+    /* Each distance needs an equality to be fixed */
+    if (eq->nrows < dim)    {
+        pluto_matrix_free(eq);
+        return;
+    }
+
+    assert(dep->dpolytope->ncols >= 2*dim+1);
+    nvars = dep->dpolytope->ncols-1;
+
+    distvec = (int64 *) malloc(dim*sizeof(int64));
+
+    for (r=0; r<dim; r++) {
+        /* [z | src iterators | dest iterators | params | const] 
+         * with z = t_r - s_r */
+        mat = pluto_matrix_dup(eq);
+        pluto_matrix_add_col(mat, 0);
+        pluto_matrix_add_row(mat, mat->nrows);
+        mat->val[mat->nrows-1][0] = 1;
+        mat->val[mat->nrows-1][1+r] = 1;
+        mat->val[mat->nrows-1][1+dim+r] = -1;
+
+        /* Project out everything but z */
+        gaussian_eliminate(mat, 1, nvars);
+
+        for (i=0; i<mat->nrows; i++) {
+            if (mat->val[i][0] != 0)    break;
+        }
+        if (i == mat->nrows || mat->val[i][1] % mat->val[i][0] != 0) {
+            /* z isn't a constant */
+            pluto_matrix_free(mat);
+            break;
+        }
+        distvec[r] = -mat->val[i][1]/mat->val[i][0];
+        pluto_matrix_free(mat);
+    }
+    pluto_matrix_free(eq);
+
+    if (r < dim)    {
+        free(distvec);
+        return;
+    }
+
+    dep->distvec = distvec;
+
+    IF_DEBUG2(printf("[pluto] Dep %d is uniform\n", dep->id+1););
+}
+
 /*
  * Only very essential information is needed to allocate; rest can be
  * populated as needed
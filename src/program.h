@@ -41,6 +41,8 @@ void pluto_deps_print(FILE *, PlutoProg *prog);
 
 PlutoProg *pluto_prog_alloc();
 void pluto_prog_free(PlutoProg *prog);
+const PlutoDepIndex *pluto_prog_get_dep_index(const PlutoProg *prog);
+void pluto_prog_invalidate_dep_index(const PlutoProg *prog);
 PlutoProg *scop_to_pluto_prog(osl_scop_p scop, PlutoOptions *options);
 
 int get_coeff_upper_bound(PlutoProg *prog);
@@ -54,6 +56,8 @@ void pluto_add_stmt(PlutoProg *prog,
         PlutoStmtType type
         );
 
+void pluto_add_dep(PlutoProg *prog, Dep *dep);
+
 void pluto_add_stmt_to_end(PlutoProg *prog, 
         const PlutoConstraints *domain,
         char **iterators,
@@ -117,6 +121,7 @@ Stmt *pluto_stmt_dup(const Stmt *stmt);
 PlutoAccess *pluto_access_dup(const PlutoAccess *acc);
 void pluto_dep_free(Dep *dep);
 Dep *pluto_dep_dup(Dep *d);
+void pluto_dep_detect_uniform(Dep *dep, Stmt **stmts);
 void pluto_remove_stmt(PlutoProg *prog, int stmt_id);
 
 int pluto_prog_get_largest_const_in_domains(const PlutoProg *prog);
@@ -1,3 +1,7 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "pluto/libpluto.h"
 #include "isl/union_set.h"
 #include "isl/union_map.h"
@@ -191,6 +195,288 @@ void test6_diamond_tiling_with_scalar_dimension() {
 
     isl_ctx_free(ctx);
 }
+/* A second schedule of the same input should come from the cache and be
+ * the same */
+void test_schedule_cache()
+{
+    long num_lookups, num_hits;
+    size_t size;
+    PlutoScheduleInfo *info1, *info2;
+
+    printf("\n\n*** TEST CASE 7 (schedule cache) ***\n\n");
+    isl_ctx *ctx = isl_ctx_alloc();
+    PlutoScheduleCache *cache = pluto_schedule_cache_alloc(1 << 20);
+
+    isl_union_set *domains = isl_union_set_read_from_str(ctx,
+            " [R, T] -> { S_0[i0, i1] : 0 <= i0 <= T and 0 <= i1 <= R - 1; }");
+    isl_union_map *deps = isl_union_map_read_from_str(ctx,
+        "[R, T] -> {"
+        "S_0[i0, i1] -> S_0[i0 + 1, i1 - 1] : 0 <= i0 <= T - 1 and 1 <= i1 <= R - 2; "
+        "S_0[i0, i1] -> S_0[i0 + 1, i1 + 1] : 0 <= i0 <= T - 1 and 1 <= i1 <= R - 2; }");
+
+    isl_union_map *schedule1 = pluto_schedule_cached(cache, domains, deps,
+            &info1, options);
+    isl_union_map *schedule2 = pluto_schedule_cached(cache, domains, deps,
+            &info2, options);
+
+    pluto_schedule_cache_get_stats(cache, &num_lookups, &num_hits, &size);
+    printf("Lookups: %ld, hits: %ld\n", num_lookups, num_hits);
+    assert(num_lookups == 2 && num_hits == 1);
+    assert(isl_union_map_is_equal(schedule1, schedule2));
+    assert(info1->nbands == info2->nbands);
+    assert(info1->nploops == info2->nploops);
+
+    pluto_schedule_info_free(info1);
+    pluto_schedule_info_free(info2);
+    isl_union_map_free(schedule1);
+    isl_union_map_free(schedule2);
+    isl_union_set_free(domains);
+    isl_union_map_free(deps);
+    pluto_schedule_cache_free(cache);
+
+    isl_ctx_free(ctx);
+}
+
+/* Loop at this depth in info (there's one statement) */
+static const PlutoLoopInfo *loop_info_at_depth(const PlutoScheduleInfo *info,
+        int depth)
+{
+    int i;
+
+    for (i=0; i<info->nloops; i++) {
+        if (info->loops[i].depth == depth) return &info->loops[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * S_0[i, j] with S_0[i, j] -> S_0[i + 1, j], tiled with tile.sizes 16 8:
+ * the hyperplanes are j (parallel) and i, and the tiled schedule is
+ * (tile j, tile i, j, i), a single permutable band. The loops over j are
+ * parallel, and the loops over i, which carry the dependence, pipelined;
+ * none is vectorizable since the innermost loop carries the dependence
+ */
+void test_schedule_info()
+{
+    int d;
+    FILE *fp;
+    PlutoScheduleInfo *info;
+    const PlutoLoopInfo *loop;
+    int intratileopt = options->intratileopt;
+    int lbtile = options->lbtile, partlbtile = options->partlbtile;
+    int exp_parallel[4] = {1, 0, 1, 0};
+    int exp_tile_size[4] = {16, 8, 0, 0};
+
+    printf("\n\n*** TEST CASE 8 (schedule information) ***\n\n");
+    isl_ctx *ctx = isl_ctx_alloc();
+
+    fp = fopen("tile.sizes", "w");
+    assert(fp != NULL);
+    fprintf(fp, "16\n8\n");
+    fclose(fp);
+
+    /* Keep the tile space and intra-tile loops in the order of the
+     * hyperplanes */
+    options->intratileopt = 0;
+    options->lbtile = 0;
+    options->partlbtile = 0;
+
+    isl_union_set *domains = isl_union_set_read_from_str(ctx,
+            "[N] -> { S_0[i, j] : 0 <= i <= N - 1 and 0 <= j <= N - 1 }");
+    isl_union_map *deps = isl_union_map_read_from_str(ctx,
+            "[N] -> { S_0[i, j] -> S_0[i + 1, j] : 0 <= i <= N - 2 and 0 <= j <= N - 1 }");
+
+    isl_union_map *schedule = pluto_schedule_with_info(domains, deps, &info,
+            options);
+    assert(schedule != NULL && info != NULL);
+    pluto_schedule_info_print(stdout, info);
+
+    assert(info->nbands == 1);
+    assert(info->bands[0].depth == 0 && info->bands[0].width == 4);
+    assert(info->nloops == 4);
+
+    for (d=0; d<4; d++) {
+        loop = loop_info_at_depth(info, d);
+        assert(loop != NULL);
+        assert(loop->nstmts == 1 && loop->stmts[0] == 0);
+        assert(loop->band == 0);
+        assert(loop->is_parallel == exp_parallel[d]);
+        assert(loop->is_pipelined == !exp_parallel[d]);
+        assert(loop->is_vectorizable == 0);
+        assert(loop->tile_size == exp_tile_size[d]);
+    }
+
+    remove("tile.sizes");
+    options->intratileopt = intratileopt;
+    options->lbtile = lbtile;
+    options->partlbtile = partlbtile;
+
+    pluto_schedule_info_free(info);
+    isl_union_map_free(schedule);
+    isl_union_set_free(domains);
+    isl_union_map_free(deps);
+
+    isl_ctx_free(ctx);
+}
+
+/* Print a row of a flat constraint system (columns: names[], then the
+ * constant) in isl syntax */
+static void flat_row_print(FILE *fp, const int64 *row, int ncols,
+        char **names)
+{
+    int j;
+
+    fprintf(fp, "0");
+    for (j=0; j<ncols-1; j++) {
+        if (row[1+j] == 0) continue;
+        fprintf(fp, " %c %lld*%s", row[1+j] > 0? '+': '-',
+                row[1+j] > 0? row[1+j]: -row[1+j], names[j]);
+    }
+    fprintf(fp, " + (%lld) %s 0", row[ncols], row[0]? "=": ">=");
+}
+
+/* Schedules of the statements of a flat output (statement i with dim[i]
+ * iterators, parameter N) as an isl union map */
+static isl_union_map *flat_output_to_union_map(isl_ctx *ctx,
+        const int64 *out, const int *dim)
+{
+    int i, j, k, nout, nexist, nrows, ncols;
+    char *str;
+    size_t size;
+    FILE *fp;
+    isl_union_map *umap;
+
+    fp = open_memstream(&str, &size);
+    fprintf(fp, "[N] -> {");
+
+    const int64 *p = out + 4;
+    for (i=0; i<out[2]; i++) {
+        nout = *p++;
+        nexist = *p++;
+        nrows = *p++;
+        ncols = *p++;
+        assert(ncols == nout + nexist + dim[i] + 1 + 1);
+
+        char *names[ncols-1];
+        for (j=0; j<ncols-1; j++) {
+            names[j] = malloc(8);
+            if (j < nout) sprintf(names[j], "t%d", j);
+            else if (j < nout + nexist) sprintf(names[j], "e%d", j - nout);
+            else if (j < ncols - 2) sprintf(names[j], "i%d", j - nout - nexist);
+            else strcpy(names[j], "N");
+        }
+
+        fprintf(fp, " S_%d[", i);
+        for (j=0; j<dim[i]; j++) {
+            fprintf(fp, "%si%d", j? ", ": "", j);
+        }
+        fprintf(fp, "] -> [");
+        for (j=0; j<nout; j++) {
+            fprintf(fp, "%st%d", j? ", ": "", j);
+        }
+        fprintf(fp, "] : ");
+        if (nexist > 0) {
+            fprintf(fp, "exists (");
+            for (j=0; j<nexist; j++) {
+                fprintf(fp, "%se%d", j? ", ": "", j);
+            }
+            fprintf(fp, " : ");
+        }
+        for (k=0; k<nrows; k++) {
+            if (k > 0) fprintf(fp, " and ");
+            flat_row_print(fp, p, ncols, names);
+            p += 1 + ncols;
+        }
+        if (nrows == 0) fprintf(fp, "1 = 1");
+        if (nexist > 0) fprintf(fp, ")");
+        fprintf(fp, ";");
+
+        for (j=0; j<ncols-1; j++) {
+            free(names[j]);
+        }
+
+        /* Skip the remapping */
+        nrows = *p++;
+        ncols = *p++;
+        p += nrows + nrows*ncols;
+    }
+    fprintf(fp, " }");
+    fclose(fp);
+
+    umap = isl_union_map_read_from_str(ctx, str);
+    free(str);
+
+    return umap;
+}
+
+/* S_0[i] : 0 <= i <= N-1 with S_0[i] -> S_0[i+1] through the flat
+ * interface: the schedule should be the one pluto_schedule_str finds for
+ * the same input */
+void test_schedule_flat()
+{
+    int64 *out;
+    int dim[1] = {1};
+    char *schedules_str;
+    char *p_loops[1] = {NULL};
+    Remapping *remapping;
+    int64 input[] = {
+        PLUTO_FLAT_VERSION, 31, 1, 1, 1,
+        /* S_0: dim 1, 1 piece of 2 rows over [i, N, 1] */
+        1, 1, 2, 3,
+        0, 1, 0, 0,
+        0, -1, 1, -1,
+        /* S_0 -> S_0: 2 rows over [i, i', N, 1] */
+        0, 0, 2, 4,
+        1, -1, 1, 0, -1,
+        0, -1, 0, 1, -2
+    };
+
+    printf("\n\n*** TEST CASE 9 (flat interface) ***\n\n");
+    isl_ctx *ctx = isl_ctx_alloc();
+
+    out = pluto_schedule_flat(input, options);
+    assert(out != NULL);
+    assert(out[0] == PLUTO_FLAT_VERSION);
+    /* One statement, one parameter, and at least one schedule dimension */
+    assert(out[2] == 1 && out[3] == 1);
+    assert(out[4] >= 1);
+    printf("Flat output: %lld int64s\n", out[1]);
+
+    pluto_schedule_str("[N] -> { S_0[i] : 0 <= i <= N - 1 }",
+            "[N] -> { S_0[i] -> S_0[i + 1] : 0 <= i <= N - 2 }",
+            &schedules_str, p_loops, &remapping, options);
+
+    isl_union_map *flat_schedule = flat_output_to_union_map(ctx, out, dim);
+    isl_union_map *str_schedule = isl_union_map_read_from_str(ctx,
+            schedules_str);
+    assert(flat_schedule != NULL && str_schedule != NULL);
+    assert(isl_union_map_is_equal(flat_schedule, str_schedule));
+
+    isl_union_map_free(flat_schedule);
+    isl_union_map_free(str_schedule);
+    pluto_schedules_strbuf_free(schedules_str);
+    pluto_remapping_free(remapping);
+    free(p_loops[0]);
+    pluto_flat_free(out);
+
+    /* A truncated buffer should be rejected */
+    input[1] = 20;
+    assert(pluto_schedule_flat(input, options) == NULL);
+    input[1] = 31;
+
+    /* So should counts the buffer can't hold: a huge number of rows, and a
+     * dimensionality that doesn't fit in an int */
+    input[7] = (int64) 1 << 62;
+    assert(pluto_schedule_flat(input, options) == NULL);
+    input[7] = 2;
+    input[5] = ((int64) 1 << 32) + 1;
+    assert(pluto_schedule_flat(input, options) == NULL);
+    input[5] = 1;
+
+    isl_ctx_free(ctx);
+}
+
 int main() 
 {
     options = pluto_options_alloc();
@@ -208,6 +494,9 @@ int main()
     crash_negative_dep_vector();
     test5();
     test6_diamond_tiling_with_scalar_dimension();
+    test_schedule_cache();
+    test_schedule_info();
+    test_schedule_flat();
 
     pluto_options_free(options);
 }
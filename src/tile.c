@@ -41,8 +41,8 @@ static int read_tile_sizes(int *tile_sizes, int *l2_tile_size_ratios,
 
     IF_DEBUG(printf("[pluto] Reading %d tile sizes\n", num_tile_dims););
 
-    if (options->ft >= 0 && options->lt >= 0)   {
-        num_tile_dims = options->lt - options->ft + 1;
+    if (pluto_options->ft >= 0 && pluto_options->lt >= 0)   {
+        num_tile_dims = pluto_options->lt - pluto_options->ft + 1;
     }
 
     for (i=0; i < num_tile_dims && !feof(tsfile); i++)   {
@@ -70,7 +70,7 @@ static int read_tile_sizes(int *tile_sizes, int *l2_tile_size_ratios,
     }
 
     if (i < num_tile_dims)  {
-        if (options->l2tile) printf("WARNING: not enough L2 tile sizes provided; using default\n");
+        if (pluto_options->l2tile) printf("WARNING: not enough L2 tile sizes provided; using default\n");
         for (i=0; i<num_tile_dims; i++) {
             l2_tile_size_ratios[i] = 8;
         }
@@ -215,6 +215,56 @@ void pluto_tile_band(PlutoProg *prog, Band *band, int *tile_sizes)
 
 
 
+/*
+ * Tile size of the loop at row 'level' of stmt's transformation if it's a
+ * tile space loop, i.e., it's a domain supernode zT with
+ *  f(i) - ts*zT >= 0 and -f(i) + ts*zT + ts-1 >= 0
+ * among stmt's domain constraints (added by pluto_tile_band); for an L2 tile
+ * space loop, this is the number of L1 tiles along the L2 tile. Returns 0
+ * if the row isn't a tile space loop
+ */
+int pluto_stmt_get_tile_size(const Stmt *stmt, int level)
+{
+    int r, r2, j, sn;
+    int64 ts;
+    const PlutoConstraints *dom = stmt->domain;
+    int ncols = dom->ncols;
+
+    /* The row should be a unit vector on a domain dimension */
+    sn = -1;
+    for (j=0; j<stmt->trans->ncols; j++) {
+        if (stmt->trans->val[level][j] == 0) continue;
+        if (stmt->trans->val[level][j] != 1 || sn != -1 || j >= stmt->dim) {
+            return 0;
+        }
+        sn = j;
+    }
+    if (sn == -1) return 0;
+
+    for (r=0; r<dom->nrows; r++) {
+        ts = -dom->val[r][sn];
+        if (dom->is_eq[r] || ts < 1) continue;
+        for (j=0; j<ncols-1; j++) {
+            if (j != sn && dom->val[r][j] != 0) break;
+        }
+        if (j == ncols-1) continue;
+
+        for (r2=0; r2<dom->nrows; r2++) {
+            if (dom->is_eq[r2]) continue;
+            for (j=0; j<ncols-1; j++) {
+                if (dom->val[r2][j] != -dom->val[r][j]) break;
+            }
+            if (j == ncols-1
+                    && dom->val[r2][ncols-1] == -dom->val[r][ncols-1] + ts - 1) {
+                return ts;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
 /*
  * Updates statement domains and transformations to represent the new
  * tiled code. A schedule of tiles is created for parallel execution if
@@ -252,18 +302,18 @@ void pluto_tile(PlutoProg *prog)
     pluto_loops_free(loops, nloops);
     
     /* Now, we are ready to tile */
-    if (options->lt >= 0 && options->ft >= 0)   {
+    if (pluto_options->lt >= 0 && pluto_options->ft >= 0)   {
         /* User option specified tiling */
 
-        assert(options->ft <= prog->num_hyperplanes-1);
-        assert(options->lt <= prog->num_hyperplanes-1);
-        assert(options->ft <= options->lt);
+        assert(pluto_options->ft <= prog->num_hyperplanes-1);
+        assert(pluto_options->lt <= prog->num_hyperplanes-1);
+        assert(pluto_options->ft <= pluto_options->lt);
 
         /* L1 tiling */
         pluto_tile_scattering_dims(prog, bands, nbands, 0);
         num_tiled_levels++;
 
-        if (options->l2tile)    {
+        if (pluto_options->l2tile)    {
             pluto_tile_scattering_dims(prog, bands, nbands, 1);
             num_tiled_levels++;
         }
@@ -271,7 +321,7 @@ void pluto_tile(PlutoProg *prog)
         /* L1 tiling */
         pluto_tile_scattering_dims(prog, bands, nbands, 0);
         num_tiled_levels++;
-        if (options->l2tile)    {
+        if (pluto_options->l2tile)    {
             /* L2 tiling */
             pluto_tile_scattering_dims(prog, bands, nbands, 1);
             num_tiled_levels++;
@@ -283,27 +333,27 @@ void pluto_tile(PlutoProg *prog)
     pluto_compute_dep_directions(prog);
     pluto_compute_dep_satisfaction(prog);
 
-    if (!options->silent)  {
+    if (!pluto_options->silent)  {
         fprintf(stdout, "[Pluto] After tiling:\n");
         pluto_transformations_pretty_print(prog);
         /* pluto_print_hyperplane_properties(prog); */
     }
 
-    if (options->lbtile) {
+    if (pluto_options->lbtile) {
         int retval;
         retval = pluto_diamond_tile_reschedule(prog);
 
         if (retval) {
             pluto_compute_dep_directions(prog);
             pluto_compute_dep_satisfaction(prog);
-            if (!options->silent) {
+            if (!pluto_options->silent) {
                 printf("[Pluto] After intra_tile reschedule\n");
                 pluto_transformations_pretty_print(prog);
             }
         }
     }
 
-    if (options->intratileopt) {
+    if (pluto_options->intratileopt) {
         int retval = 0;
         for (i=0; i<nbands; i++) {
             retval |= pluto_intra_tile_optimize_band(bands[i], num_tiled_levels, prog);
@@ -311,7 +361,7 @@ void pluto_tile(PlutoProg *prog)
         if (retval) {
             pluto_compute_dep_directions(prog);
             pluto_compute_dep_satisfaction(prog);
-            if (!options->silent) {
+            if (!pluto_options->silent) {
                 printf("[Pluto] After intra-tile optimize\n");
                 pluto_transformations_pretty_print(prog);
             }
@@ -321,14 +371,14 @@ void pluto_tile(PlutoProg *prog)
 
     /* DEPRECATED: now taken care of in intra_tile_optimize */
 #if 0
-    if (options->prevector) {
+    if (pluto_options->prevector) {
         int retval = 0;
         for (i=0; i<nbands; i++) {
-            int num_tiling_levels = options->tile + options->l2tile;
+            int num_tiling_levels = pluto_options->tile + pluto_options->l2tile;
             retval |= pluto_pre_vectorize_band(bands[i], num_tiling_levels, prog);
         }
         if (retval) pluto_detect_transformation_properties(prog);
-        if (retval && !options->silent) {
+        if (retval && !pluto_options->silent) {
             printf("[Pluto] After pre-vectorize:\n");
             pluto_transformations_pretty_print(prog);
             pluto_print_hyperplane_properties(prog);
@@ -336,9 +386,9 @@ void pluto_tile(PlutoProg *prog)
     }
 #endif
 
-    if (options->parallel) {
+    if (pluto_options->parallel) {
         int retval = pluto_create_tile_schedule(prog, bands, nbands);
-        if (retval && !options->silent) {
+        if (retval && !pluto_options->silent) {
             printf("[Pluto] After tile scheduling:\n");
             pluto_transformations_pretty_print(prog);
         }
@@ -456,7 +506,7 @@ bool pluto_create_tile_schedule_band(PlutoProg *prog, Band *band)
      * become parallel */
     int first = band->loop->depth;
 
-	if (!options->innerpar) {
+	if (!pluto_options->innerpar) {
 		/* Create the wavefront */
 		for (i=0; i<band->loop->nstmts; i++)    {
 			Stmt *stmt = band->loop->stmts[i];
@@ -476,17 +526,18 @@ bool pluto_create_tile_schedule_band(PlutoProg *prog, Band *band)
      * a complete complex dep satisfaction check since we know that the tile
      * schedule will satisfy the dependence satisfied by all the dimensions
      * that is a sum of) */
-    for (i=0; i<prog->ndeps; i++) {
-        Dep *dep = prog->deps[i];
-        /* satvec s should have been computed */
-        if (IS_RAR(dep->type)) continue;
-        if (pluto_stmt_is_member_of(prog->stmts[dep->src]->id, 
-                    band->loop->stmts, band->loop->nstmts) 
-                && pluto_stmt_is_member_of(prog->stmts[dep->dest]->id, 
-                    band->loop->stmts, band->loop->nstmts)) {
-            for (k=1; k<=nip_dims; k++) {
-                dep->satvec[first] |= dep->satvec[loop_depths[k]];
-                dep->satvec[loop_depths[k]] = 0;
+    const PlutoDepIndex *index = pluto_prog_get_dep_index(prog);
+    for (i=0; i<band->loop->nstmts; i++) {
+        int e, s = band->loop->stmts[i]->id;
+        for (e=index->deps.out_start[s]; e<index->deps.out_start[s+1]; e++) {
+            Dep *dep = prog->deps[index->deps.out[e]];
+            /* satvec s should have been computed */
+            if (IS_RAR(dep->type)) continue;
+            if (pluto_loop_has_stmt(band->loop, prog->stmts[dep->dest]->id)) {
+                for (k=1; k<=nip_dims; k++) {
+                    dep->satvec[first] |= dep->satvec[loop_depths[k]];
+                    dep->satvec[loop_depths[k]] = 0;
+                }
             }
         }
     }
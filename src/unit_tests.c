@@ -25,9 +25,11 @@
  *
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #include "constraints.h"
+#include "pluto.h"
 #include "program.h"
 
 
@@ -40,3 +42,219 @@ void test_rank()
     }
 }
 
+
+
+/* A dependence of a 1-d statement (0 <= i <= 10, scheduled by i) on
+ * itself: i' = i + dist */
+static PlutoProg *dep_test_prog(int64 dist)
+{
+    Dep *dep;
+    PlutoProg *prog;
+    PlutoConstraints *dom;
+    PlutoMatrix *trans;
+    char *iters[1] = {"i"};
+
+    prog = pluto_prog_alloc();
+    prog->options = pluto_options;
+
+    dom = pluto_constraints_alloc(2, 2);
+    pluto_constraints_add_lb(dom, 0, 0);
+    pluto_constraints_add_ub(dom, 0, 10);
+    trans = pluto_matrix_alloc(1, 2);
+    trans->val[0][0] = 1;
+    trans->val[0][1] = 0;
+    pluto_add_stmt(prog, dom, trans, iters, "a[i] = a[i-1];", ORIG);
+    pluto_constraints_free(dom);
+    pluto_matrix_free(trans);
+
+    dep = pluto_dep_alloc();
+    dep->src = 0;
+    dep->dest = 0;
+    dep->type = OSL_DEPENDENCE_RAW;
+    /* [i, i', 1] */
+    dep->dpolytope = pluto_constraints_alloc(3, 3);
+    pluto_constraints_add_equality(dep->dpolytope);
+    dep->dpolytope->val[0][0] = -1;
+    dep->dpolytope->val[0][1] = 1;
+    dep->dpolytope->val[0][2] = -dist;
+    pluto_constraints_add_lb(dep->dpolytope, 0, 0);
+    pluto_constraints_add_ub(dep->dpolytope, 0, 10);
+    pluto_add_dep(prog, dep);
+
+    return prog;
+}
+
+
+/* The direction and satisfaction cached on a dependence have to be
+ * recomputed when its polyhedron changes, even if it keeps its shape */
+void test_dep_satisfaction_recompute()
+{
+    Dep *dep;
+    PlutoProg *prog;
+
+    printf("\n*** Dependence satisfaction after a change of the dependence polyhedron ***\n");
+
+    prog = dep_test_prog(1);
+    dep = prog->deps[0];
+
+    assert(get_dep_direction(dep, prog, 0) == DEP_PLUS);
+    assert(dep_satisfaction_test(dep, prog, 0));
+
+    /* Same number of rows and columns: i' = i */
+    dep->dpolytope->val[0][2] = 0;
+    assert(dep_satisfaction_test(dep, prog, 0) == false);
+    assert(get_dep_direction(dep, prog, 0) == DEP_ZERO);
+
+    /* i' = i - 1 */
+    dep->dpolytope->val[0][2] = 1;
+    assert(get_dep_direction(dep, prog, 0) == DEP_MINUS);
+    assert(dep_satisfaction_test(dep, prog, 0) == false);
+
+    /* Back to i' = i + 1 */
+    dep->dpolytope->val[0][2] = -1;
+    assert(dep_satisfaction_test(dep, prog, 0));
+
+    pluto_prog_free(prog);
+}
+
+
+/* Sparse system of nrows rows of 'rows' (each: is_eq, then ncols
+ * coefficients, the last being the constant) */
+static PlutoSparseConstraints *presolve_test_system(const int64 *rows,
+        int nrows, int ncols)
+{
+    int i, j;
+    PlutoSparseConstraints *sc;
+
+    sc = pluto_sparse_constraints_alloc(nrows, nrows*ncols, ncols);
+    for (i=0; i<nrows; i++) {
+        const int64 *row = &rows[i*(ncols+1)];
+        pluto_sparse_constraints_add_constraint(sc, row[0]);
+        for (j=0; j<ncols; j++) {
+            pluto_sparse_constraints_add_coeff(sc, j, row[1+j]);
+        }
+    }
+
+    return sc;
+}
+
+/* Lexmin of sc presolved, solved and postsolved should be the lexmin of sc
+ * itself; returns the presolve info (NULL if sc was found infeasible) */
+static PlutoPresolveInfo *check_presolve_lexmin(const PlutoSparseConstraints *sc)
+{
+    int j;
+    int64 *sol, *rsol, *psol;
+    PlutoPresolveInfo *info;
+    PlutoSparseConstraints *rsc;
+
+    sol = pluto_sparse_constraints_lexmin(sc, DO_NOT_ALLOW_NEGATIVE_COEFF, NULL);
+
+    rsc = pluto_sparse_constraints_presolve(sc, &info);
+    if (rsc == NULL) {
+        assert(sol == NULL && info == NULL);
+        return NULL;
+    }
+
+    if (rsc->ncols == 1) {
+        psol = pluto_presolve_postsolve(NULL, info);
+    }else{
+        rsol = pluto_sparse_constraints_lexmin(rsc, DO_NOT_ALLOW_NEGATIVE_COEFF,
+                NULL);
+        psol = rsol? pluto_presolve_postsolve(rsol, info): NULL;
+        free(rsol);
+    }
+
+    assert((sol == NULL) == (psol == NULL));
+    if (sol != NULL) {
+        for (j=0; j<sc->ncols-1; j++) {
+            assert(psol[j] == sol[j]);
+        }
+    }
+
+    free(sol);
+    free(psol);
+    pluto_sparse_constraints_free(rsc);
+
+    return info;
+}
+
+/* Presolve: fixed columns, singleton rows and duplicate rows */
+void test_presolve_postsolve()
+{
+    PlutoSparseConstraints *sc;
+    PlutoPresolveInfo *info;
+
+    printf("\n*** Lexmin with presolve/postsolve ***\n");
+
+    pluto_options->presolve = 0;
+
+    /* x1 = 3 (fixed column), x2 <= 5 and x3 >= 1 (singleton rows), x0 + x2
+     * >= 2 (duplicated); the lexmin is (0, 3, 2, 3) */
+    int64 rows1[] = {
+        1, 0, 1, 0, 0, -3,
+        0, 1, 0, 1, 0, -2,
+        0, 1, 0, 1, 0, -2,
+        0, 0, 0, -1, 0, 5,
+        0, 0, 0, 0, 1, -1,
+        0, 1, -1, 1, 1, -2,
+        0, 1, 0, -1, 0, 4
+    };
+    sc = presolve_test_system(rows1, 7, 5);
+    info = check_presolve_lexmin(sc);
+    assert(info != NULL && info->colmap[1] == -1 && info->fixval[1] == 3);
+    pluto_presolve_info_free(info);
+    pluto_sparse_constraints_free(sc);
+
+    /* 1 <= x0 <= 1 (bounds that meet), x2 = x0 + 2x1 (substituted), x1 +
+     * x2 >= 4 (duplicated); the lexmin is (1, 1, 3) */
+    int64 rows2[] = {
+        0, 1, 0, 0, -1,
+        0, -1, 0, 0, 1,
+        1, 1, 2, -1, 0,
+        0, 0, 1, 1, -4,
+        0, 0, 1, 1, -4
+    };
+    sc = presolve_test_system(rows2, 5, 4);
+    info = check_presolve_lexmin(sc);
+    assert(info != NULL && info->colmap[0] == -1 && info->colmap[2] == -1);
+    pluto_presolve_info_free(info);
+    pluto_sparse_constraints_free(sc);
+
+    /* x0 = 2, x1 = x0 + 1: nothing is left to solve */
+    int64 rows3[] = {
+        1, 1, 0, -2,
+        1, -1, 1, -1
+    };
+    sc = presolve_test_system(rows3, 2, 3);
+    info = check_presolve_lexmin(sc);
+    assert(info != NULL && info->colmap[2] == 0);
+    pluto_presolve_info_free(info);
+    pluto_sparse_constraints_free(sc);
+
+    /* x0 = 1 and x0 >= 2: infeasible */
+    int64 rows4[] = {
+        1, 1, 0, -1,
+        0, 1, 0, -2
+    };
+    sc = presolve_test_system(rows4, 2, 3);
+    assert(check_presolve_lexmin(sc) == NULL);
+    pluto_sparse_constraints_free(sc);
+}
+
+
+#ifdef UNIT_TESTS_MAIN
+int main()
+{
+    pluto_options = pluto_options_alloc();
+    pluto_options->silent = 1;
+
+    test_dep_satisfaction_recompute();
+    test_presolve_postsolve();
+
+    pluto_options_free(pluto_options);
+
+    printf("\nAll unit tests passed\n");
+
+    return 0;
+}
+#endif